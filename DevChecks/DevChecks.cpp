@@ -0,0 +1,721 @@
+// DevChecks.cpp : Developer checks of the math kernels, not shipped with the editor.
+//
+
+#include <iostream>
+#include <vector>
+#include <cfloat>
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <memory>
+#include <thread>
+
+#include "../Editor/VectorMath.h"
+#include "../Editor/VertexFormat.h"
+#include "../Editor/MeshOptimizer.h"
+#include "../Editor/MeshletBuilder.h"
+#include "../Editor/VertexWeld.h"
+#include "../Editor/MeshSimplifier.h"
+
+#define LINE_STRING "================================"
+
+
+/*
+* NormalizeArray() and NormalizeSoA() at every simd level the cpu has.
+* Fast results must be within 2e-6 of unit length, as VectorMath.h documents,
+* and vectors whose squared length is 0 or overflows must come out zero in both modes.
+*/
+static bool CheckNormalizeBound()
+{
+	//Directions over the sphere times lengths over the whole float range
+	std::vector<Float3> Src;
+	for (int e = -18; e <= 18; e++)
+	{
+		float Scale = powf(10.0f, (float)e);
+		for (int i = 0; i < 64; i++)
+		{
+			float Z = 1.0f - (2.0f * i + 1.0f) / 64.0f;
+			float Radius = sqrtf(MAX(1.0f - Z * Z, 0.0f));
+			float Angle = 2.39996323f * i;
+			Src.push_back(Float3(cosf(Angle) * Radius, sinf(Angle) * Radius, Z) * Scale);
+		}
+	}
+	size_t InRangeNum = Src.size();
+
+	//Zero and overflowing squared lengths
+	Src.push_back(Float3(0.0f));
+	Src.push_back(Float3(1e20f, 0.0f, 0.0f));
+	Src.push_back(Float3(-1e20f, 1e20f, 1e20f));
+	Src.push_back(Float3(FLT_MAX, FLT_MAX, 0.0f));
+
+	bool Passed = true;
+	char Line[512];
+	std::cout << LINE_STRING << std::endl;
+
+	SimdLevel Best = GetSimdLevel();
+	for (int l = (int)SimdLevel::Scalar; l <= (int)Best; l++)
+	{
+		SetSimdLevel((SimdLevel)l);
+
+		std::vector<Float3> Fast(Src.size()), Exact(Src.size());
+		NormalizeArray(Src.data(), Fast.data(), Src.size(), NormalizeMode::Fast);
+		NormalizeArray(Src.data(), Exact.data(), Src.size(), NormalizeMode::Exact);
+
+		std::vector<float> X(Src.size()), Y(Src.size()), Z(Src.size());
+		Float3ToSoA(Src.data(), X.data(), Y.data(), Z.data(), Src.size());
+		NormalizeSoA(X.data(), Y.data(), Z.data(), Src.size(), NormalizeMode::Fast);
+
+		double MaxError = 0.0;
+		size_t Failed = 0;
+		for (size_t i = 0; i < Src.size(); i++)
+		{
+			Float3 SoA(X[i], Y[i], Z[i]);
+			if (i < InRangeNum)
+			{
+				double Length = sqrt((double)Fast[i].x * Fast[i].x + (double)Fast[i].y * Fast[i].y + (double)Fast[i].z * Fast[i].z);
+				double SoALength = sqrt((double)SoA.x * SoA.x + (double)SoA.y * SoA.y + (double)SoA.z * SoA.z);
+				double Error = MAX(fabs(Length - 1.0), fabs(SoALength - 1.0));
+				MaxError = MAX(MaxError, Error);
+				if (!(Error <= 2e-6))
+					Failed++;
+			}
+			else if (Fast[i] != Float3(0.0f) || Exact[i] != Float3(0.0f) || SoA != Float3(0.0f))
+			{
+				Failed++;
+			}
+		}
+
+		snprintf(Line, sizeof(Line), "Normalize %s : max length error %.3g, %zu of %zu failed",
+			GetSimdLevelName((SimdLevel)l), MaxError, Failed, Src.size());
+		std::cout << Line << std::endl;
+		Passed = Passed && Failed == 0;
+	}
+
+	SetSimdLevel(Best);
+	return Passed;
+}
+
+
+//Angle between a source normal and its decoded one, atan2 keeps small angles that acos would round to 0
+static float AngleBetween(const Float3& a, const Float3& b)
+{
+	Float3 Sine = Cross(a, b);
+	return atan2f(sqrtf(Dot(Sine, Sine)), Dot(a, b));
+}
+
+//Best of a few runs, the first one also pays for faulting in the output pages
+template<typename FuncType>
+static double BestMilliseconds(FuncType Func, int RunNum = 5)
+{
+	double Best = DBL_MAX;
+	for (int r = 0; r < RunNum; r++)
+	{
+		auto Start = std::chrono::steady_clock::now();
+		Func();
+		double Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+		Best = MIN(Best, Milliseconds);
+	}
+	return Best;
+}
+
+/*
+* Round trips Num normals spread over the sphere through EncodeNormalsToUint3() and octahedral 2x16
+* at the current simd level, prints the best single and batch encode/decode times and the largest angle error.
+* Batch results must match the single functions bit for bit and octahedral must stay inside its error bound.
+*/
+static bool CheckNormalPacking(size_t Num)
+{
+	//Even pairs for the Uint3 encoding
+	Num = MAX(Num & ~(size_t)1, (size_t)2);
+	size_t Half = Num / 2;
+
+	//Fibonacci sphere, every direction about equally covered
+	std::vector<Float3> Normals(Num);
+	for (size_t i = 0; i < Num; i++)
+	{
+		float Z = 1.0f - (2.0f * i + 1.0f) / Num;
+		float Radius = sqrtf(MAX(1.0f - Z * Z, 0.0f));
+		float Angle = 2.39996323f * i;
+		Normals[i] = Float3(cosf(Angle) * Radius, sinf(Angle) * Radius, Z);
+	}
+
+	bool Passed = true;
+	char Line[512];
+	std::cout << LINE_STRING << std::endl;
+	snprintf(Line, sizeof(Line), "Normal Packing : %zu normals, %s", Num, GetSimdLevelName(GetSimdLevel()));
+	std::cout << Line << std::endl;
+
+	//Uint3 pairs
+	{
+		std::vector<Uint3> Single(Half), Batch(Half);
+		std::vector<Float3> Decoded1(Half), Decoded2(Half), BatchDecoded1(Half), BatchDecoded2(Half);
+		const Float3* N1 = Normals.data();
+		const Float3* N2 = Normals.data() + Half;
+
+		double EncodeSingle = BestMilliseconds([&]()
+			{
+				for (size_t i = 0; i < Half; i++)
+				{
+					Single[i] = EncodeNormalsToUint3(N1[i], N2[i]);
+				}
+			});
+
+		double EncodeBatch = BestMilliseconds([&]()
+			{
+				EncodeNormalsToUint3Array(N1, N2, Batch.data(), Half);
+			});
+
+		double DecodeSingle = BestMilliseconds([&]()
+			{
+				for (size_t i = 0; i < Half; i++)
+				{
+					DecodeUint3ToNormals(Single[i], &Decoded1[i], &Decoded2[i]);
+				}
+			});
+
+		double DecodeBatch = BestMilliseconds([&]()
+			{
+				DecodeUint3ToNormalsArray(Batch.data(), BatchDecoded1.data(), BatchDecoded2.data(), Half);
+			});
+
+		float MaxAngle = 0.0f;
+		size_t Mismatch = 0;
+		for (size_t i = 0; i < Half; i++)
+		{
+			MaxAngle = MAX(MaxAngle, AngleBetween(N1[i], BatchDecoded1[i]));
+			MaxAngle = MAX(MaxAngle, AngleBetween(N2[i], BatchDecoded2[i]));
+			if (memcmp(&Single[i], &Batch[i], sizeof(Uint3)) != 0 || memcmp(&Decoded1[i], &BatchDecoded1[i], sizeof(Float3)) != 0 || memcmp(&Decoded2[i], &BatchDecoded2[i], sizeof(Float3)) != 0)
+				Mismatch++;
+		}
+
+		snprintf(Line, sizeof(Line), "Uint3 Pair (6 bytes) : encode %.2fms -> %.2fms, decode %.2fms -> %.2fms, max error %.6f rad, %zu differ from single",
+			EncodeSingle, EncodeBatch, DecodeSingle, DecodeBatch, MaxAngle, Mismatch);
+		std::cout << Line << std::endl;
+		Passed = Passed && Mismatch == 0;
+	}
+
+	//Octahedral 2x16
+	{
+		std::vector<std::int16_t> Single(Num * 2), Batch(Num * 2);
+		std::vector<Float3> Decoded(Num), BatchDecoded(Num);
+
+		double EncodeSingle = BestMilliseconds([&]()
+			{
+				for (size_t i = 0; i < Num; i++)
+				{
+					EncodeOctahedral(Normals[i], &Single[i * 2]);
+				}
+			});
+
+		double EncodeBatch = BestMilliseconds([&]()
+			{
+				EncodeOctahedralArray(Normals.data(), Batch.data(), Num);
+			});
+
+		double DecodeSingle = BestMilliseconds([&]()
+			{
+				for (size_t i = 0; i < Num; i++)
+				{
+					Decoded[i] = DecodeOctahedral(&Single[i * 2]);
+				}
+			});
+
+		double DecodeBatch = BestMilliseconds([&]()
+			{
+				DecodeOctahedralArray(Batch.data(), BatchDecoded.data(), Num);
+			});
+
+		float MaxAngle = 0.0f;
+		size_t Mismatch = 0;
+		for (size_t i = 0; i < Num; i++)
+		{
+			MaxAngle = MAX(MaxAngle, AngleBetween(Normals[i], BatchDecoded[i]));
+			if (Single[i * 2] != Batch[i * 2] || Single[i * 2 + 1] != Batch[i * 2 + 1] || memcmp(&Decoded[i], &BatchDecoded[i], sizeof(Float3)) != 0)
+				Mismatch++;
+		}
+
+		snprintf(Line, sizeof(Line), "Octahedral (4 bytes) : encode %.2fms -> %.2fms, decode %.2fms -> %.2fms, max error %.6f rad, %zu differ from single",
+			EncodeSingle, EncodeBatch, DecodeSingle, DecodeBatch, MaxAngle, Mismatch);
+		std::cout << Line << std::endl;
+		Passed = Passed && Mismatch == 0 && MaxAngle <= GetErrorBound(VertexQuantization()).NormalAngle;
+	}
+
+	return Passed;
+}
+
+
+/*
+* Random vertices inside a box through EncodeVertex() and EncodeVertices() at every simd level,
+* MeasureError() must stay within GetErrorBound() on position, normal angle and color,
+* and zero, infinite and NaN normals must encode as 0 on the single and the batch path.
+*/
+static bool CheckVertexFormat(size_t Num)
+{
+	BoundingBox Box;
+	Box.SetMinMax(Float3(-3.0f, 10.0f, 250.0f), Float3(4.0f, 10.5f, 290.0f));
+	VertexQuantization Quantization(Box);
+	VertexError Bound = GetErrorBound(Quantization);
+
+	std::mt19937 Random(11);
+	std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+	std::vector<DrawRawVertex> Vertices(Num);
+	for (size_t i = 0; i < Num; i++)
+	{
+		DrawRawVertex& Vertex = Vertices[i];
+		Float3 T(Unit(Random), Unit(Random), Unit(Random));
+		Vertex.pos = Float3(Box.Min.x + T.x * (Box.Max.x - Box.Min.x), Box.Min.y + T.y * (Box.Max.y - Box.Min.y), Box.Min.z + T.z * (Box.Max.z - Box.Min.z));
+
+		//Any direction at any length, the format keeps only the direction
+		float Z = Unit(Random) * 2.0f - 1.0f;
+		float Radius = sqrtf(MAX(1.0f - Z * Z, 0.0f));
+		float Angle = 6.28318531f * Unit(Random);
+		Vertex.normal = Float3(cosf(Angle) * Radius, sinf(Angle) * Radius, Z) * (0.01f + 100.0f * Unit(Random));
+
+		//A little outside 0~1, which is clamped
+		Vertex.color = Float3(Unit(Random), Unit(Random), Unit(Random)) * 1.2f - Float3(0.1f);
+		Vertex.alpha = Unit(Random);
+	}
+
+	const Float3 Invalid[4] = { Float3(0.0f), Float3(INFINITY, 0.0f, 0.0f), Float3(0.0f, -INFINITY, 1.0f), Float3(NAN, 0.0f, 1.0f) };
+
+	bool Passed = true;
+	char Line[512];
+	std::cout << LINE_STRING << std::endl;
+
+	SimdLevel Best = GetSimdLevel();
+	for (int l = (int)SimdLevel::Scalar; l <= (int)Best; l++)
+	{
+		SetSimdLevel((SimdLevel)l);
+
+		std::vector<PackedVertex> Single(Num), Batch(Num);
+		for (size_t i = 0; i < Num; i++)
+		{
+			Single[i] = EncodeVertex(Vertices[i], Quantization);
+		}
+		EncodeVertices(Vertices.data(), Batch.data(), Num, Quantization);
+
+		VertexError SingleError = MeasureError(Vertices.data(), Single.data(), Num, Quantization);
+		VertexError BatchError = MeasureError(Vertices.data(), Batch.data(), Num, Quantization);
+		bool InBound = MAX(SingleError.Position, BatchError.Position) <= Bound.Position &&
+			MAX(SingleError.NormalAngle, BatchError.NormalAngle) <= Bound.NormalAngle &&
+			MAX(SingleError.Color, BatchError.Color) <= Bound.Color;
+
+		std::int16_t SingleInvalid[8], BatchInvalid[8];
+		for (int i = 0; i < 4; i++)
+		{
+			EncodeOctahedral(Invalid[i], &SingleInvalid[i * 2]);
+		}
+		EncodeOctahedralArray(Invalid, BatchInvalid, 4);
+		size_t InvalidNotZero = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			if (SingleInvalid[i] != 0 || BatchInvalid[i] != 0)
+				InvalidNotZero++;
+		}
+
+		snprintf(Line, sizeof(Line), "Vertex Format %s : position %.3g / %.3g, normal %.3g / %.3g rad, color %.3g / %.3g, %zu invalid normal components not 0",
+			GetSimdLevelName((SimdLevel)l), MAX(SingleError.Position, BatchError.Position), Bound.Position,
+			MAX(SingleError.NormalAngle, BatchError.NormalAngle), Bound.NormalAngle, MAX(SingleError.Color, BatchError.Color), Bound.Color, InvalidNotZero);
+		std::cout << Line << std::endl;
+		Passed = Passed && InBound && InvalidNotZero == 0;
+	}
+
+	SetSimdLevel(Best);
+	return Passed;
+}
+
+
+//Context over its own arrays, what an importer would give the passes
+class DevContext : public SourceContext
+{
+public:
+	DevContext(const std::string& InName, int InVertexNum, int InTriangleNum) :
+		VertexNum(InVertexNum),
+		TriangleNum(InTriangleNum)
+	{
+		Name = InName;
+		DrawVertexList = AllocateBuffer<DrawRawVertex>(VertexNum);
+		DrawIndexList = AllocateBuffer<DrawRawIndex>((size_t)TriangleNum * 3);
+	}
+
+	virtual int GetTriangleNum() override {
+		return TriangleNum;
+	}
+	virtual int GetVertexNum() override {
+		return VertexNum;
+	}
+	virtual bool SetVertexNum(int InVertexNum) override {
+		VertexNum = InVertexNum;
+		return true;
+	}
+
+private:
+	int VertexNum;
+	int TriangleNum;
+};
+
+//Rings x Sides torus, major radius 2 and minor radius 1, seams share vertices
+static std::unique_ptr<DevContext> MakeTorus(int Rings, int Sides)
+{
+	std::unique_ptr<DevContext> Context = std::make_unique<DevContext>("torus", Rings * Sides, Rings * Sides * 2);
+	for (int r = 0; r < Rings; r++)
+	{
+		float U = 6.28318531f * r / Rings;
+		for (int s = 0; s < Sides; s++)
+		{
+			float V = 6.28318531f * s / Sides;
+			Float3 Normal(cosf(V) * cosf(U), cosf(V) * sinf(U), sinf(V));
+			Float3 Position = Float3(2.0f * cosf(U), 2.0f * sinf(U), 0.0f) + Normal;
+			Context->DrawVertexList[r * Sides + s] = DrawRawVertex(Position, Normal, Float3(1.0f), 1.0f);
+
+			DrawRawIndex V0 = r * Sides + s;
+			DrawRawIndex V1 = r * Sides + (s + 1) % Sides;
+			DrawRawIndex V2 = ((r + 1) % Rings) * Sides + s;
+			DrawRawIndex V3 = ((r + 1) % Rings) * Sides + (s + 1) % Sides;
+			DrawRawIndex Quad[6] = { V0, V2, V1, V1, V2, V3 };
+			memcpy(&Context->DrawIndexList[(size_t)V0 * 6], Quad, sizeof(Quad));
+		}
+	}
+	return Context;
+}
+
+//Side x Side quads of two triangles each, row by row
+static std::vector<DrawRawIndex> MakeGridIndices(int Side)
+{
+	std::vector<DrawRawIndex> Indices;
+	for (int y = 0; y < Side; y++)
+	{
+		for (int x = 0; x < Side; x++)
+		{
+			DrawRawIndex V0 = y * (Side + 1) + x;
+			DrawRawIndex V1 = V0 + 1;
+			DrawRawIndex V2 = V0 + (Side + 1);
+			DrawRawIndex V3 = V2 + 1;
+			DrawRawIndex Quad[6] = { V0, V2, V1, V1, V2, V3 };
+			Indices.insert(Indices.end(), Quad, Quad + 6);
+		}
+	}
+	return Indices;
+}
+
+//Triangles of an index list as sorted keys, rotations of one triangle give the same key
+static std::vector<std::tuple<DrawRawIndex, DrawRawIndex, DrawRawIndex>> GetTriangleSet(const std::vector<DrawRawIndex>& Indices)
+{
+	std::vector<std::tuple<DrawRawIndex, DrawRawIndex, DrawRawIndex>> Triangles;
+	for (size_t i = 0; i + 2 < Indices.size(); i += 3)
+	{
+		DrawRawIndex a = Indices[i], b = Indices[i + 1], c = Indices[i + 2];
+		if (b < a && b < c)
+			Triangles.emplace_back(b, c, a);
+		else if (c < a && c < b)
+			Triangles.emplace_back(c, a, b);
+		else
+			Triangles.emplace_back(a, b, c);
+	}
+	std::sort(Triangles.begin(), Triangles.end());
+	return Triangles;
+}
+
+/*
+* OptimizeVertexCache() on a grid in row order and in shuffled triangle order.
+* The triangles must stay the same with their winding, ACMR/ATVR must not get worse,
+* and both must come out below 0.7 ACMR, row order alone is about 1.0 on a 16 entry cache.
+*/
+static bool CheckVertexCache()
+{
+	const int Side = 64;
+	const int CacheSize = 16;
+	int VertexNum = (Side + 1) * (Side + 1);
+
+	std::vector<DrawRawIndex> Rows = MakeGridIndices(Side);
+	std::vector<DrawRawIndex> Shuffled(Rows.size());
+	{
+		std::vector<int> Order(Rows.size() / 3);
+		for (int i = 0; i < Order.size(); i++)
+		{
+			Order[i] = i;
+		}
+		std::shuffle(Order.begin(), Order.end(), std::mt19937(7));
+		for (size_t i = 0; i < Order.size(); i++)
+		{
+			memcpy(&Shuffled[i * 3], &Rows[(size_t)Order[i] * 3], sizeof(DrawRawIndex) * 3);
+		}
+	}
+
+	bool Passed = true;
+	char Line[512];
+	std::cout << LINE_STRING << std::endl;
+
+	const char* Names[2] = { "rows", "shuffled" };
+	std::vector<DrawRawIndex>* Meshes[2] = { &Rows, &Shuffled };
+	for (int m = 0; m < 2; m++)
+	{
+		std::vector<DrawRawIndex> Indices = *Meshes[m];
+		VertexCacheStats Before = SimulateVertexCache(Indices.data(), Indices.size(), VertexNum, CacheSize);
+		OptimizeVertexCache(Indices.data(), Indices.size(), VertexNum, CacheSize);
+		VertexCacheStats After = SimulateVertexCache(Indices.data(), Indices.size(), VertexNum, CacheSize);
+
+		bool SameTriangles = GetTriangleSet(Indices) == GetTriangleSet(*Meshes[m]);
+		bool Improved = After.GetACMR() <= Before.GetACMR() && After.GetATVR() <= Before.GetATVR() && After.GetACMR() < 0.7f;
+
+		snprintf(Line, sizeof(Line), "Vertex Cache %dx%d grid %s : ACMR %.3f -> %.3f, ATVR %.3f -> %.3f%s",
+			Side, Side, Names[m], Before.GetACMR(), After.GetACMR(), Before.GetATVR(), After.GetATVR(), SameTriangles ? "" : ", triangles changed");
+		std::cout << Line << std::endl;
+		Passed = Passed && SameTriangles && Improved;
+	}
+
+	return Passed;
+}
+
+
+/*
+* BuildMeshlets() on a torus: every meshlet within the vertex and triangle limits, every source
+* triangle in exactly one meshlet with its winding, the data unchanged through Serialize/Deserialize,
+* and every cone containing the normals of its own triangles.
+*/
+static bool CheckMeshlets()
+{
+	std::unique_ptr<DevContext> Context = MakeTorus(96, 48);
+	std::vector<DrawRawIndex> Source(Context->DrawIndexList, Context->DrawIndexList + (size_t)Context->GetTriangleNum() * 3);
+
+	MeshletOptions Options;
+	MeshletData Data;
+	bool Passed = BuildMeshlets(Context.get(), Data, Options);
+
+	size_t OverLimit = 0;
+	size_t ConeMissed = 0;
+	std::vector<DrawRawIndex> Covered;
+	for (size_t m = 0; m < Data.Meshlets.size(); m++)
+	{
+		const Meshlet& Cluster = Data.Meshlets[m];
+		if (Cluster.VertexNum > (std::uint32_t)Options.MaxVertexNum || Cluster.TriangleNum > (std::uint32_t)Options.MaxTriangleNum ||
+			(size_t)Cluster.VertexOffset + Cluster.VertexNum > Data.VertexList.size() ||
+			((size_t)Cluster.TriangleOffset + Cluster.TriangleNum) * 3 > Data.TriangleList.size())
+		{
+			OverLimit++;
+			continue;
+		}
+
+		//Cosine of the cone half angle, a normal inside has at least this dot with the axis
+		float MinDot = sqrtf(MAX(1.0f - Cluster.ConeCutoff * Cluster.ConeCutoff, 0.0f));
+		for (std::uint32_t t = 0; t < Cluster.TriangleNum; t++)
+		{
+			DrawRawIndex Triangle[3];
+			for (int j = 0; j < 3; j++)
+			{
+				std::uint8_t Local = Data.TriangleList[((size_t)Cluster.TriangleOffset + t) * 3 + j];
+				if (Local >= Cluster.VertexNum)
+					OverLimit++;
+				Triangle[j] = Data.VertexList[Cluster.VertexOffset + MIN((std::uint32_t)Local, Cluster.VertexNum - 1)];
+				Covered.push_back(Triangle[j]);
+			}
+
+			if (Cluster.ConeCutoff >= 1.0f)
+				continue;
+			const Float3& P0 = Context->DrawVertexList[Triangle[0]].pos;
+			Float3 Normal = Cross(Context->DrawVertexList[Triangle[1]].pos - P0, Context->DrawVertexList[Triangle[2]].pos - P0);
+			float Length = sqrtf(Dot(Normal, Normal));
+			if (Length > 0.0f && Dot(Normal / Length, Cluster.ConeAxis) < MinDot - 1e-4f)
+				ConeMissed++;
+		}
+	}
+	bool SameTriangles = GetTriangleSet(Covered) == GetTriangleSet(Source);
+
+	std::vector<Byte> Bytes;
+	MeshletData Loaded;
+	bool RoundTrip = Data.Serialize(Bytes) && Loaded.Deserialize(Bytes) &&
+		Loaded.Meshlets.size() == Data.Meshlets.size() &&
+		memcmp(Loaded.Meshlets.data(), Data.Meshlets.data(), Data.Meshlets.size() * sizeof(Meshlet)) == 0 &&
+		Loaded.VertexList == Data.VertexList && Loaded.TriangleList == Data.TriangleList;
+
+	char Line[512];
+	std::cout << LINE_STRING << std::endl;
+	snprintf(Line, sizeof(Line), "Meshlets : %zu meshlets of %d triangles, %zu over limit, %zu normals outside their cone, triangles %s, round trip %s",
+		Data.Meshlets.size(), Context->GetTriangleNum(), OverLimit, ConeMissed, SameTriangles ? "match" : "differ", RoundTrip ? "matches" : "differs");
+	std::cout << Line << std::endl;
+
+	return Passed && OverLimit == 0 && ConeMissed == 0 && SameTriangles && RoundTrip && !Data.Meshlets.empty();
+}
+
+
+/*
+* Welds a torus split into one vertex per triangle corner, inserted by 4 threads with chunks in reverse order.
+* Every copy of a vertex must collapse onto the copy with the lowest index, which WeldNormal off keeps,
+* the index number must stay and the torus must come back to its own vertex number and triangles.
+*/
+static bool CheckWeld()
+{
+	std::unique_ptr<DevContext> Source = MakeTorus(96, 48);
+	int TriangleNum = Source->GetTriangleNum();
+	size_t IndexNum = (size_t)TriangleNum * 3;
+
+	//Normal x of a copy is its own index, the welded vertex tells which copy won
+	std::unique_ptr<DevContext> Context = std::make_unique<DevContext>("split torus", (int)IndexNum, TriangleNum);
+	std::vector<int> LowestCopy(Source->GetVertexNum(), -1);
+	for (size_t i = 0; i < IndexNum; i++)
+	{
+		DrawRawIndex Vertex = Source->DrawIndexList[i];
+		Context->DrawVertexList[i] = Source->DrawVertexList[Vertex];
+		Context->DrawVertexList[i].normal = Float3((float)i, 0.0f, 0.0f);
+		Context->DrawIndexList[i] = (DrawRawIndex)i;
+		if (LowestCopy[Vertex] < 0)
+			LowestCopy[Vertex] = (int)i;
+	}
+
+	WeldOptions Options;
+	Options.WeldNormal = false;
+	Options.ChunkSize = 1024;
+	VertexWelder Welder(Context.get(), Options);
+	{
+		const int ThreadNum = 4;
+		int ChunkNum = Welder.GetChunkNum();
+		std::vector<std::thread> Threads;
+		for (int t = 0; t < ThreadNum; t++)
+		{
+			Threads.emplace_back([&Welder, &Options, ChunkNum, t]()
+				{
+					for (int c = ChunkNum - 1 - t; c >= 0; c -= ThreadNum)
+					{
+						Welder.InsertRange(c * Options.ChunkSize, (c + 1) * Options.ChunkSize);
+					}
+				});
+		}
+		for (int t = 0; t < ThreadNum; t++)
+		{
+			Threads[t].join();
+		}
+	}
+	int WeldedNum = Welder.Finish();
+
+	//Triangles of the welded mesh must be the source ones, each corner on the lowest copy of its vertex
+	size_t WrongCopy = 0;
+	std::vector<DrawRawIndex> Welded(IndexNum);
+	for (size_t i = 0; i < IndexNum; i++)
+	{
+		DrawRawIndex Vertex = Source->DrawIndexList[i];
+		const DrawRawVertex& Result = Context->DrawVertexList[Context->DrawIndexList[i]];
+		if (Result.pos != Source->DrawVertexList[Vertex].pos || Result.normal.x != (float)LowestCopy[Vertex])
+			WrongCopy++;
+		Welded[i] = (DrawRawIndex)(int)Result.normal.x;
+	}
+	for (size_t i = 0; i < IndexNum; i++)
+	{
+		Welded[i] = Source->DrawIndexList[Welded[i]];
+	}
+	std::vector<DrawRawIndex> SourceIndices(Source->DrawIndexList, Source->DrawIndexList + IndexNum);
+	bool SameTriangles = GetTriangleSet(Welded) == GetTriangleSet(SourceIndices);
+
+	char Line[512];
+	std::cout << LINE_STRING << std::endl;
+	snprintf(Line, sizeof(Line), "Weld : %zu -> %d vertices, torus has %d, %d indices, %zu corners not on the lowest copy, triangles %s",
+		IndexNum, WeldedNum, Source->GetVertexNum(), Context->GetTriangleNum() * 3, WrongCopy, SameTriangles ? "match" : "differ");
+	std::cout << Line << std::endl;
+
+	return WeldedNum == Source->GetVertexNum() && Context->GetVertexNum() == WeldedNum && Context->GetTriangleNum() * 3 == (int)IndexNum &&
+		WrongCopy == 0 && SameTriangles;
+}
+
+
+/*
+* SimplifyMesh() on a wavy open grid cut down the middle by an attribute seam, to a quarter of its triangles.
+* The target must be reached, every border and seam vertex must still be used and
+* no triangle may face down, which every source triangle faces up.
+*/
+static bool CheckSimplifier()
+{
+	const int Side = 64;
+	const int SeamColumn = Side / 2;
+	int RowVertexNum = Side + 2;
+	std::unique_ptr<DevContext> Context = std::make_unique<DevContext>("seamed grid", RowVertexNum * (Side + 1), Side * Side * 2);
+
+	//Column SeamColumn is there twice, the copy at the end of a row has another color and takes the right half
+	auto GetVertex = [RowVertexNum, SeamColumn, Side](int x, int y, bool Right)
+	{
+		return (DrawRawIndex)(y * RowVertexNum + ((x == SeamColumn && Right) ? Side + 1 : x));
+	};
+	std::vector<bool> Kept(Context->GetVertexNum(), false);
+	for (int y = 0; y <= Side; y++)
+	{
+		for (int x = 0; x <= Side + 1; x++)
+		{
+			int Column = (x == Side + 1) ? SeamColumn : x;
+			Float3 Position((float)Column, (float)y, 2.0f * sinf(Column / 8.0f) * cosf(y / 10.0f));
+			Float3 Color = (x == Side + 1) ? Float3(1.0f, 0.0f, 0.0f) : Float3(1.0f);
+			Context->DrawVertexList[y * RowVertexNum + x] = DrawRawVertex(Position, Float3(0.0f, 0.0f, 1.0f), Color, 1.0f);
+			Kept[y * RowVertexNum + x] = Column == 0 || Column == Side || Column == SeamColumn || y == 0 || y == Side;
+		}
+	}
+	for (int y = 0; y < Side; y++)
+	{
+		for (int x = 0; x < Side; x++)
+		{
+			bool Right = x >= SeamColumn;
+			DrawRawIndex V0 = GetVertex(x, y, Right);
+			DrawRawIndex V1 = GetVertex(x + 1, y, Right);
+			DrawRawIndex V2 = GetVertex(x, y + 1, Right);
+			DrawRawIndex V3 = GetVertex(x + 1, y + 1, Right);
+			DrawRawIndex Quad[6] = { V0, V1, V2, V1, V3, V2 };
+			memcpy(&Context->DrawIndexList[((size_t)y * Side + x) * 6], Quad, sizeof(Quad));
+		}
+	}
+
+	size_t IndexNum = (size_t)Context->GetTriangleNum() * 3;
+	size_t TargetIndexNum = IndexNum / 4 / 3 * 3;
+	std::vector<DrawRawIndex> Result(IndexNum);
+	float Error = 0.0f;
+	size_t ResultNum = SimplifyMesh(Result.data(), Context->DrawIndexList, IndexNum, Context->DrawVertexList, TargetIndexNum, FLT_MAX, &Error);
+
+	std::vector<bool> Used(Context->GetVertexNum(), false);
+	size_t FacingDown = 0;
+	for (size_t i = 0; i < ResultNum; i += 3)
+	{
+		const Float3& P0 = Context->DrawVertexList[Result[i]].pos;
+		Float3 Normal = Cross(Context->DrawVertexList[Result[i + 1]].pos - P0, Context->DrawVertexList[Result[i + 2]].pos - P0);
+		if (!(Normal.z > 0.0f))
+			FacingDown++;
+		for (int j = 0; j < 3; j++)
+		{
+			Used[Result[i + j]] = true;
+		}
+	}
+	size_t Lost = 0;
+	for (int i = 0; i < Context->GetVertexNum(); i++)
+	{
+		if (Kept[i] && !Used[i])
+			Lost++;
+	}
+
+	char Line[512];
+	std::cout << LINE_STRING << std::endl;
+	snprintf(Line, sizeof(Line), "Simplifier : %zu -> %zu triangles, target %zu, error %.4f, %zu border or seam vertices lost, %zu triangles facing down",
+		IndexNum / 3, ResultNum / 3, TargetIndexNum / 3, Error, Lost, FacingDown);
+	std::cout << Line << std::endl;
+
+	return ResultNum > 0 && ResultNum <= TargetIndexNum && Lost == 0 && FacingDown == 0;
+}
+
+
+int main(int argc, char** argv)
+{
+	bool Passed = CheckNormalizeBound();
+
+	SimdLevel Best = GetSimdLevel();
+	for (int l = (int)SimdLevel::Scalar; l <= (int)Best; l++)
+	{
+		SetSimdLevel((SimdLevel)l);
+		Passed = CheckNormalPacking(1 << 20) && Passed;
+	}
+	SetSimdLevel(Best);
+
+	Passed = CheckVertexFormat(1 << 16) && Passed;
+	Passed = CheckVertexCache() && Passed;
+	Passed = CheckMeshlets() && Passed;
+	Passed = CheckWeld() && Passed;
+	Passed = CheckSimplifier() && Passed;
+
+	std::cout << LINE_STRING << std::endl;
+	std::cout << (Passed ? "All checks passed" : "Some checks failed") << std::endl;
+	return Passed ? 0 : 1;
+}
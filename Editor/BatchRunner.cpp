@@ -0,0 +1,213 @@
+#include "BatchRunner.h"
+
+#include <chrono>
+#include <iomanip>
+
+#define LINE_STRING "================================"
+
+
+BatchRunner::BatchRunner(Processer* InProcesser) :
+	ExternalProcesser(InProcesser)
+{
+}
+
+
+bool BatchRunner::IsBatchCommandLine(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "-batch")
+			return true;
+	}
+	return false;
+}
+
+
+void BatchRunner::PrintUsage()
+{
+	std::cout << "Usage: TemplateEditor -batch [-o OutputDirectory] [-ext .OutputExtension] [-cache CacheDirectory] [-profile] InputFile..." << std::endl;
+	std::cout << "  -o        Output directory, default is the directory of each input" << std::endl;
+	std::cout << "  -ext      Extension of the exported file, default is .out" << std::endl;
+	std::cout << "  -cache    Reuse pass results stored in this directory, can be shared" << std::endl;
+	std::cout << "  -profile  Print per pass timings and write a chrome trace next to each export" << std::endl;
+}
+
+
+int BatchRunner::Main(Processer* InProcesser, int argc, char** argv)
+{
+	std::vector<std::filesystem::path> InputFiles;
+	std::filesystem::path OutputDirectory;
+	std::string OutputExtension = ".out";
+	std::filesystem::path CacheDirectory;
+	bool Profile = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string Arg = argv[i];
+		if (Arg == "-batch")
+		{
+			continue;
+		}
+		else if (Arg == "-profile")
+		{
+			Profile = true;
+		}
+		else if (Arg == "-o" || Arg == "-ext" || Arg == "-cache")
+		{
+			if (i + 1 >= argc)
+			{
+				std::cout << "Missing value after " << Arg << std::endl;
+				PrintUsage();
+				return (int)BatchExitCode::BadArguments;
+			}
+			if (Arg == "-o")
+				OutputDirectory = argv[++i];
+			else if (Arg == "-cache")
+				CacheDirectory = argv[++i];
+			else
+				OutputExtension = argv[++i];
+		}
+		else if (Arg.size() > 0 && Arg[0] == '-')
+		{
+			std::cout << "Unknown option " << Arg << std::endl;
+			PrintUsage();
+			return (int)BatchExitCode::BadArguments;
+		}
+		else
+		{
+			InputFiles.push_back(Arg);
+		}
+	}
+
+	if (InputFiles.size() == 0 || InProcesser == nullptr)
+	{
+		PrintUsage();
+		return (int)BatchExitCode::BadArguments;
+	}
+
+	if (!CacheDirectory.empty())
+		InProcesser->EnableResultCache(CacheDirectory);
+	if (Profile)
+		InProcesser->EnableProfiling(true);
+
+	BatchRunner Runner(InProcesser);
+	return Runner.Run(InputFiles, OutputDirectory, OutputExtension);
+}
+
+
+int BatchRunner::Run(std::vector<std::filesystem::path>& InputFiles, const std::filesystem::path& OutputDirectory, const std::string& OutputExtension)
+{
+	BatchExitCode Worst = BatchExitCode::Success;
+	int SucceededNum = 0;
+
+	auto BatchStart = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < InputFiles.size(); i++)
+	{
+		std::filesystem::path OutputFile = OutputDirectory.empty() ? InputFiles[i].parent_path() : OutputDirectory;
+		OutputFile /= InputFiles[i].stem();
+		OutputFile += OutputExtension;
+
+		BatchExitCode Result = RunOne(InputFiles[i], OutputFile);
+		if (Result == BatchExitCode::Success)
+			SucceededNum++;
+		else if ((int)Result > (int)Worst)
+			Worst = Result;
+	}
+
+	double BatchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - BatchStart).count();
+
+	std::cout << LINE_STRING << std::endl;
+	std::cout << "Batch Finished : " << SucceededNum << "/" << InputFiles.size() << " succeeded in " << std::fixed << std::setprecision(3) << BatchSeconds << "s" << std::endl;
+	ResultCache* Cache = ExternalProcesser->GetResultCache();
+	if (Cache != nullptr)
+		std::cout << "Result Cache   : " << Cache->GetHitNum() << " hit, " << Cache->GetMissNum() << " miss, " << Cache->GetTotalBytes() / 1024 << "KB in " << Cache->GetDirectory() << std::endl;
+	std::cout << LINE_STRING << std::endl;
+
+	return (int)Worst;
+}
+
+
+BatchExitCode BatchRunner::RunOne(std::filesystem::path& InputFile, std::filesystem::path& OutputFile)
+{
+	LastReport.clear();
+
+	std::cout << LINE_STRING << std::endl;
+	auto ImportStart = std::chrono::steady_clock::now();
+	ExternalProcesser->Clear();
+	if (!ExternalProcesser->Import(&InputFile))
+	{
+		std::cout << "Import Failed : " << InputFile << std::endl;
+		return BatchExitCode::ImportFailed;
+	}
+	double ImportSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ImportStart).count();
+	std::cout << "Import  : " << std::fixed << std::setprecision(3) << ImportSeconds << "s" << std::endl;
+
+	bool PassSuccess = RunPasses();
+
+	Profiler* PassProfiler = ExternalProcesser->GetProfiler();
+	if (PassProfiler != nullptr)
+	{
+		std::filesystem::path TraceFile = OutputFile;
+		TraceFile.replace_extension(".trace.json");
+
+		PassProfiler->PrintReport();
+		if (PassProfiler->ExportChromeTrace(TraceFile))
+			std::cout << "Trace   : " << TraceFile << std::endl;
+	}
+
+	if (!PassSuccess)
+		return BatchExitCode::PassFailed;
+	ExternalProcesser->ClearDirty();
+
+	auto ExportStart = std::chrono::steady_clock::now();
+	if (!ExternalProcesser->Export(&OutputFile))
+	{
+		std::cout << "Export Failed : " << OutputFile << std::endl;
+		return BatchExitCode::ExportFailed;
+	}
+	double ExportSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ExportStart).count();
+	std::cout << "Export  : " << std::fixed << std::setprecision(3) << ExportSeconds << "s" << std::endl;
+
+	return BatchExitCode::Success;
+}
+
+
+bool BatchRunner::RunPasses()
+{
+	PassScheduler Scheduler(ExternalProcesser);
+	Scheduler.CallBackOnPassFinished = [](Processer* InProcesser, int, PassRecord& Record)
+	{
+		std::string& ErrorString = InProcesser->GetErrorString();
+		if (ErrorString.size() > 0)
+		{
+			std::cout << "Something get error, please see error" + std::to_string(Record.PassIndex) + ".log." << std::endl;
+			InProcesser->DumpErrorString(Record.PassIndex);
+		}
+	};
+
+	if (!Scheduler.Start())
+		return true;
+
+	//Independent passes overlap, so the report is printed in pass order once all are done
+	bool Success = Scheduler.RunToEnd();
+
+	const std::vector<PassRecord>& Records = Scheduler.GetRecords();
+	for (int i = 0; i < Records.size(); i++)
+	{
+		if (!Records[i].Started)
+			continue;
+
+		PassReport Report;
+		Report.PassIndex = Records[i].PassIndex;
+		Report.Name = Scheduler.GetPass(i).Name;
+		Report.Success = Records[i].Success;
+		Report.Seconds = Records[i].Seconds;
+		Report.State = Records[i].State;
+		LastReport.push_back(Report);
+
+		std::cout << "Pass " << std::setw(3) << Report.PassIndex << " " << std::left << std::setw(12) << Report.Name << std::right << " : " << std::fixed << std::setprecision(3) << Report.Seconds << "s " << (Report.Success ? "OK " : "FAILED ") << Report.State << std::endl;
+	}
+
+	return Success;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "Processer.h"
+#include "PassScheduler.h"
+
+
+enum class BatchExitCode
+{
+	Success = 0,
+
+	BadArguments,
+
+	ImportFailed,
+
+	PassFailed,
+
+	ExportFailed
+};
+
+
+struct PassReport
+{
+	PassReport() :
+		PassIndex(0),
+		Success(false),
+		Seconds(0.0)
+	{}
+
+	int PassIndex;
+	std::string Name;
+	bool Success;
+	double Seconds;
+	std::string State;
+};
+
+
+/*
+* Headless driver for Processer, no window, no device, no frame loop.
+* Import -> every pass through PassScheduler -> Export, per input file.
+*/
+class BatchRunner
+{
+public:
+	BatchRunner(Processer* InProcesser);
+
+	//Return true if the command line asks for batch mode
+	static bool IsBatchCommandLine(int argc, char** argv);
+
+	//Parse the command line and run, return process exit code
+	static int Main(Processer* InProcesser, int argc, char** argv);
+	static void PrintUsage();
+
+	//Return process exit code of the worst file
+	int Run(std::vector<std::filesystem::path>& InputFiles, const std::filesystem::path& OutputDirectory, const std::string& OutputExtension);
+	BatchExitCode RunOne(std::filesystem::path& InputFile, std::filesystem::path& OutputFile);
+
+	const std::vector<PassReport>& GetLastReport() const
+	{
+		return LastReport;
+	}
+
+private:
+	bool RunPasses();
+
+private:
+	Processer* ExternalProcesser;
+	std::vector<PassReport> LastReport;
+};
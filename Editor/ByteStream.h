@@ -0,0 +1,333 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <type_traits>
+
+#include "Utils.h"
+
+
+/*
+* Cursor based little endian reading and writing.
+* Values are the host layout on little endian hosts, so arrays go through one memcpy,
+* big endian hosts swap every element.
+*/
+
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define BYTE_STREAM_LITTLE_ENDIAN 1
+#endif
+
+
+template<typename T>
+inline T SwapBytes(T Value)
+{
+	Byte* Bytes = (Byte*)&Value;
+	for (size_t i = 0; i < sizeof(T) / 2; i++)
+	{
+		Byte Temp = Bytes[i];
+		Bytes[i] = Bytes[sizeof(T) - 1 - i];
+		Bytes[sizeof(T) - 1 - i] = Temp;
+	}
+	return Value;
+}
+
+
+
+/*
+* Reads from a buffer it doesn't own.
+* A read past the end fails, leaves the output zeroed and makes IsOk() false for good,
+* so a parser can read a whole record and check once.
+*/
+class ByteReader
+{
+public:
+	ByteReader(const Byte* InData, size_t InSize) :
+		Data(InData),
+		Size(InData != nullptr ? InSize : 0),
+		Offset(0),
+		Ok(true)
+	{}
+	ByteReader(const std::vector<Byte>& InData) :
+		ByteReader(InData.data(), InData.size())
+	{}
+
+	size_t GetOffset() const
+	{
+		return Offset;
+	}
+	size_t GetSize() const
+	{
+		return Size;
+	}
+	size_t GetRemaining() const
+	{
+		return Size - Offset;
+	}
+	bool IsOk() const
+	{
+		return Ok;
+	}
+
+	bool Seek(size_t InOffset)
+	{
+		if (InOffset > Size)
+			return Fail();
+		Offset = InOffset;
+		return true;
+	}
+	bool Skip(size_t Num)
+	{
+		return Seek(Num <= GetRemaining() ? Offset + Num : Size + 1);
+	}
+
+	//Num bytes in place, nullptr if there are fewer left
+	const Byte* ReadBytes(size_t Num)
+	{
+		if (!Ok || Num > GetRemaining())
+		{
+			Fail();
+			return nullptr;
+		}
+		const Byte* Result = Data + Offset;
+		Offset += Num;
+		return Result;
+	}
+
+	template<typename T>
+	bool Read(T& Out)
+	{
+		static_assert(std::is_arithmetic<T>::value, "ByteReader::Read takes numbers, use ReadBytes for records");
+		const Byte* Src = ReadBytes(sizeof(T));
+		if (Src == nullptr)
+		{
+			Out = T(0);
+			return false;
+		}
+		memcpy(&Out, Src, sizeof(T));
+#if !defined(BYTE_STREAM_LITTLE_ENDIAN)
+		Out = SwapBytes(Out);
+#endif
+		return true;
+	}
+	template<typename T>
+	T Read()
+	{
+		T Value;
+		Read(Value);
+		return Value;
+	}
+
+	std::uint8_t ReadUint8() { return Read<std::uint8_t>(); }
+	std::uint16_t ReadUint16() { return Read<std::uint16_t>(); }
+	std::uint32_t ReadUint32() { return Read<std::uint32_t>(); }
+	std::uint64_t ReadUint64() { return Read<std::uint64_t>(); }
+	std::int32_t ReadInt32() { return Read<std::int32_t>(); }
+	float ReadFloat() { return Read<float>(); }
+	double ReadDouble() { return Read<double>(); }
+
+	template<typename T>
+	bool ReadArray(T* Dst, size_t Num)
+	{
+		static_assert(std::is_arithmetic<T>::value, "ByteReader::ReadArray takes numbers");
+		const Byte* Src = Num <= GetRemaining() / sizeof(T) ? ReadBytes(Num * sizeof(T)) : ReadBytes(GetRemaining() + 1);
+		if (Src == nullptr)
+		{
+			memset(Dst, 0, Num * sizeof(T));
+			return false;
+		}
+		memcpy(Dst, Src, Num * sizeof(T));
+#if !defined(BYTE_STREAM_LITTLE_ENDIAN)
+		for (size_t i = 0; i < Num; i++)
+		{
+			Dst[i] = SwapBytes(Dst[i]);
+		}
+#endif
+		return true;
+	}
+	//Replaces the content of Dst
+	template<typename T>
+	bool ReadArray(std::vector<T>& Dst, size_t Num)
+	{
+		if (Num > GetRemaining() / sizeof(T))
+		{
+			Dst.clear();
+			return Fail();
+		}
+		Dst.resize(Num);
+		return ReadArray(Dst.data(), Num);
+	}
+
+	//Points into the buffer, valid as long as the buffer is, cut at the first '\0'
+	std::string_view ReadStringView(size_t Length)
+	{
+		const char* Src = (const char*)ReadBytes(Length);
+		if (Src == nullptr)
+			return std::string_view();
+
+		const void* End = memchr(Src, '\0', Length);
+		return std::string_view(Src, End != nullptr ? (const char*)End - Src : Length);
+	}
+	std::string ReadString(size_t Length)
+	{
+		return std::string(ReadStringView(Length));
+	}
+
+private:
+	bool Fail()
+	{
+		Ok = false;
+		return false;
+	}
+
+private:
+	const Byte* Data;
+	size_t Size;
+	size_t Offset;
+	bool Ok;
+};
+
+
+
+/*
+* Appends to a vector that grows as needed, or buffers for a stream
+* and writes the buffer out every FlushSize bytes and on Flush()/destruction.
+*/
+class ByteWriter
+{
+public:
+	ByteWriter(std::vector<Byte>& InTarget) :
+		Target(&InTarget),
+		Stream(nullptr),
+		FlushSize(0),
+		Flushed(0)
+	{}
+	ByteWriter(std::ostream& InStream, size_t InFlushSize = 1 << 20) :
+		Target(&Buffer),
+		Stream(&InStream),
+		FlushSize(InFlushSize),
+		Flushed(0)
+	{
+		Buffer.reserve(FlushSize);
+	}
+	~ByteWriter()
+	{
+		Flush();
+	}
+
+	ByteWriter(const ByteWriter&) = delete;
+	ByteWriter& operator=(const ByteWriter&) = delete;
+
+	//Bytes written so far, flushed ones included
+	size_t GetOffset() const
+	{
+		return Flushed + Target->size();
+	}
+
+	void Reserve(size_t Num)
+	{
+		Target->reserve(Target->size() + Num);
+	}
+
+	//False if the stream failed, always true without one
+	bool Flush()
+	{
+		if (Stream == nullptr)
+			return true;
+
+		if (!Target->empty())
+		{
+			Stream->write((const char*)Target->data(), Target->size());
+			Flushed += Target->size();
+			Target->clear();
+		}
+		return Stream->good();
+	}
+
+	void WriteBytes(const void* Src, size_t Num)
+	{
+		if (Num == 0)
+			return;
+
+		//Big blocks skip the buffer
+		if (Stream != nullptr && Num >= FlushSize)
+		{
+			Flush();
+			Stream->write((const char*)Src, Num);
+			Flushed += Num;
+			return;
+		}
+
+		size_t End = Target->size();
+		Target->resize(End + Num);
+		memcpy(Target->data() + End, Src, Num);
+
+		if (Stream != nullptr && Target->size() >= FlushSize)
+			Flush();
+	}
+
+	template<typename T>
+	void Write(T Value)
+	{
+		static_assert(std::is_arithmetic<T>::value, "ByteWriter::Write takes numbers, use WriteBytes for records");
+#if !defined(BYTE_STREAM_LITTLE_ENDIAN)
+		Value = SwapBytes(Value);
+#endif
+		WriteBytes(&Value, sizeof(T));
+	}
+
+	void WriteUint8(std::uint8_t Value) { Write(Value); }
+	void WriteUint16(std::uint16_t Value) { Write(Value); }
+	void WriteUint32(std::uint32_t Value) { Write(Value); }
+	void WriteUint64(std::uint64_t Value) { Write(Value); }
+	void WriteInt32(std::int32_t Value) { Write(Value); }
+	void WriteFloat(float Value) { Write(Value); }
+	void WriteDouble(double Value) { Write(Value); }
+
+	template<typename T>
+	void WriteArray(const T* Src, size_t Num)
+	{
+		static_assert(std::is_arithmetic<T>::value, "ByteWriter::WriteArray takes numbers");
+#if defined(BYTE_STREAM_LITTLE_ENDIAN)
+		WriteBytes(Src, Num * sizeof(T));
+#else
+		for (size_t i = 0; i < Num; i++)
+		{
+			Write(Src[i]);
+		}
+#endif
+	}
+	template<typename T>
+	void WriteArray(const std::vector<T>& Src)
+	{
+		WriteArray(Src.data(), Src.size());
+	}
+
+	//No terminator, the reader needs the length
+	void WriteString(std::string_view Value)
+	{
+		WriteBytes(Value.data(), Value.size());
+	}
+
+	//Overwrite a value written earlier, such as a size only known at the end, false once it was flushed
+	template<typename T>
+	bool WriteAt(size_t Offset, T Value)
+	{
+		static_assert(std::is_arithmetic<T>::value, "ByteWriter::WriteAt takes numbers");
+		if (Offset < Flushed || Offset - Flushed + sizeof(T) > Target->size())
+			return false;
+#if !defined(BYTE_STREAM_LITTLE_ENDIAN)
+		Value = SwapBytes(Value);
+#endif
+		memcpy(Target->data() + (Offset - Flushed), &Value, sizeof(T));
+		return true;
+	}
+
+private:
+	std::vector<Byte>* Target;
+	std::vector<Byte> Buffer;
+	std::ostream* Stream;
+	size_t FlushSize;
+	size_t Flushed;
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Utils.h"
+
+
+//Vertex and index of the draw arrays, on their own so math code can use them without Processer.h
+struct DrawRawVertex
+{
+	DrawRawVertex() :
+		pos(), normal(), color(), alpha(0.0f)
+	{}
+	DrawRawVertex(Float3 _pos, Float3 _nor, Float3 _col, float _alpha) :
+		pos(_pos), normal(_nor), color(_col), alpha(_alpha)
+	{}
+	Float3 pos;
+	Float3 normal;
+	Float3 color;
+	float alpha;
+};
+typedef unsigned int DrawRawIndex;
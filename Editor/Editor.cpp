@@ -367,6 +367,13 @@ Editor::Editor(Processer* InProcesser)
     Imported = false;
     CurrentPassIndex = 0;
 
+    Scheduler = std::make_unique<PassScheduler>(ExternalProcesser);
+    Scheduler->CallBackOnPassFinished = [this](Processer* InProcesser, int PassIndex, PassRecord& Record)
+    {
+        CurrentPassIndex = Record.PassIndex;
+        OnOneProgressFinished();
+    };
+
     CallBackOnRender = nullptr;
     CallBackOnTick = nullptr;
     CallBackOnLoadModel = nullptr;
@@ -414,7 +421,7 @@ bool Editor::Init(const wchar_t* ApplicationName, int PosX, int PosY, UINT Width
         gD3dSrvDescHeap->GetCPUDescriptorHandleForHeapStart(),
         gD3dSrvDescHeap->GetGPUDescriptorHandleForHeapStart());
 
-    MeshViewer.reset(new MeshRenderer(gD3dDevice, gD3dSrvDescHeap));
+    MeshViewer.reset(new MeshRenderer(gD3dDevice, gD3dSrvDescHeap, ExternalProcesser->GetThreadPool()));
 
     FileTypeList.clear();
 
@@ -574,6 +581,8 @@ void Editor::Render(ID3D12GraphicsCommandList* CommandList)
         ImGui::ProgressBar(GetProgress(), ImVec2(-1.0f, 0.0f));
         ImGui::TextColored(Hint.Color, Hint.Text.c_str());
 
+        ShowProfileUI();
+
         if (CallBackOnInspectorUI != nullptr)
             CallBackOnInspectorUI(ExternalProcesser, &Hint);
 
@@ -591,6 +600,75 @@ void Editor::Render(ID3D12GraphicsCommandList* CommandList)
 }
 
 
+void Editor::ShowProfileUI()
+{
+    if (ExternalProcesser == nullptr) return;
+
+    ImGui::BeginDisabled(Working);
+    bool Profiling = ExternalProcesser->GetProfiler() != nullptr;
+    if (ImGui::Checkbox("Profile Passes", &Profiling))
+        ExternalProcesser->EnableProfiling(Profiling);
+    ImGui::EndDisabled();
+
+    Profiler* PassProfiler = ExternalProcesser->GetProfiler();
+    if (PassProfiler == nullptr || PassProfiler->GetPassList().empty()) return;
+
+    if (ImGui::CollapsingHeader("Pass Profile", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const std::vector<PassProfile>& PassList = PassProfiler->GetPassList();
+
+        ImGuiTableFlags Flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp;
+        if (ImGui::BeginTable("PassProfileTable", 8, Flags))
+        {
+            ImGui::TableSetupColumn("#");
+            ImGui::TableSetupColumn("Pass");
+            ImGui::TableSetupColumn("Wall ms");
+            ImGui::TableSetupColumn("CPU ms");
+            ImGui::TableSetupColumn("Setup ms");
+            ImGui::TableSetupColumn("Items");
+            ImGui::TableSetupColumn("Items/s");
+            ImGui::TableSetupColumn("Util");
+            ImGui::TableHeadersRow();
+
+            for (int i = 0; i < PassList.size(); i++)
+            {
+                const PassProfile& Pass = PassList[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::Text("%d", Pass.PassIndex);
+                ImGui::TableNextColumn();
+                if (Pass.Success)
+                    ImGui::Text("%s", Pass.Name.c_str());
+                else
+                    ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%s", Pass.Name.c_str());
+                ImGui::TableNextColumn(); ImGui::Text("%.2f", Pass.WallSeconds * 1000.0);
+                ImGui::TableNextColumn(); ImGui::Text("%.2f", Pass.CpuSeconds * 1000.0);
+                ImGui::TableNextColumn(); ImGui::Text("%.2f", Pass.SetupSeconds * 1000.0);
+                ImGui::TableNextColumn(); ImGui::Text("%u", Pass.ItemNum);
+                ImGui::TableNextColumn(); ImGui::Text("%.1f", Pass.ItemsPerSecond);
+                ImGui::TableNextColumn(); ImGui::Text("%.1f%%", Pass.Utilization * 100.0);
+            }
+            ImGui::EndTable();
+        }
+
+        ImGui::BeginDisabled(Working);
+        if (ImGui::Button("Export Trace"))
+        {
+            std::filesystem::path TracePath;
+            BrowseFileSave(&TracePath);
+            if (!TracePath.empty())
+            {
+                TracePath.replace_extension(".json");
+                if (PassProfiler->ExportChromeTrace(TracePath))
+                    Hint.Normal("Trace exported, open it in chrome://tracing");
+                else
+                    Hint.Error("Failed to write the trace");
+            }
+        }
+        ImGui::EndDisabled();
+    }
+}
+
+
 void Editor::BrowseFileOpen(std::filesystem::path* OutFilePath)
 {
     IFileOpenDialog* pfd = NULL;
@@ -715,6 +793,9 @@ void Editor::OnLoadButtonClicked()
 {
    BrowseFileOpen(&ImportFilePath);
 
+   if (MeshViewer.get())
+       MeshViewer->CancelNormalLines();
+
    Imported = false;
    bool Success = false;
    if (ExternalProcesser != nullptr)
@@ -762,15 +843,6 @@ void Editor::OnExportButtonClicked()
 
 void Editor::OnOneProgressFinished()
 {
-    // flush working mission
-    while (true)
-    {
-        if (ExternalProcesser->IsWorking())
-            ExternalProcesser->GetProgress();
-        else
-            break;
-    }
-
     std::string& ErrorString = ExternalProcesser->GetErrorString();
     if (ErrorString.size() > 0) {
         std::cout << LINE_STRING << std::endl;
@@ -795,80 +867,56 @@ void Editor::OnAllProgressFinished()
 double Editor::GetProgress()
 {
     if (ExternalProcesser == nullptr) return 0.0;
+    if (!Working) return Progress;
 
-    Progress = ExternalProcesser->GetProgress();
+    // passes are drained and kicked by the scheduler, independent ones run side by side
+    bool Running = Scheduler->Tick();
+    Progress = Scheduler->GetProgress();
 
-    if (!ExternalProcesser->IsWorking() && Working)
-    {
-        if (!PassPool.empty()) 
-        {
-            if (Progress == 1.0)
-                OnOneProgressFinished();
-
-            PassType NextPass = PassPool.front();
-            if (NextPass != nullptr) {
-                ExternalProcesser->Clear();
-                CurrentPassIndex++;
+    if (Scheduler->GetLastState().size() > 0)
+        Hint.Text = Scheduler->GetLastState();
 
-                bool Success = NextPass(ExternalProcesser, Hint.Text);
-                if (!Success)
-                {
-                    Hint.ErrorColor();
-                    ClearPassPool();
-                    Terminated = true;
-                }
-                else {
-                    Hint.NormalColor();
-                    Progress = 0.0;
-                }
-            }
+    if (Scheduler->IsFailed())
+    {
+        Hint.ErrorColor();
+        Terminated = true;
+    }
 
-            if (!PassPool.empty())
-                PassPool.pop();
+    if (!Running)
+    {
+        if (!Terminated) {
+            Hint.Normal("Completed.");
+            OnAllProgressFinished();
+            ExternalProcesser->ClearDirty();
         }
         else
         {
-            if (!Terminated) {
-                Hint.Normal("Completed.");
-                OnAllProgressFinished();
-            }
-            else
-            {
-                Hint.Error("Something Error, Terminated.");
-            }
-            Working = false;
+            Hint.Error("Something Error, Terminated.");
         }
+        Working = false;
     }
 
     return Progress;
 }
 
-void Editor::ClearPassPool()
-{
-    if (!PassPool.empty())
-    {
-        std::queue<PassType> Empty;
-        swap(Empty, PassPool);
-    }
-}
-
 
 void Editor::KickGenerateMission()
 {
     if (ExternalProcesser == nullptr) return;
 
-    ClearPassPool();
+    if (MeshViewer.get())
+        MeshViewer->CancelNormalLines();
 
     Progress = 0.0;
-    Working = true;
     Terminated = false;
     Hint.NormalColor();
     CurrentPassIndex = 0;
 
-    for(int i = 0; i< ExternalProcesser->PassPool.size(); i++)
-        PassPool.push(ExternalProcesser->PassPool[i]);
-  
-
+    // GetProgress() finishes the mission on its next call even if nothing started,
+    // no pass at all completes as before, a graph that can't be built terminates
+    Working = true;
+    if (!Scheduler->Start())
+        Terminated = Scheduler->GetPassNum() > 0;
 }
 
 
@@ -926,6 +974,18 @@ void MeshRenderer::ShowViewerSettingUI(bool ModelIsLoaded, bool GeneratorIsWorki
     ImGui::Checkbox("Show Face Normal", &ShowFaceNormal);
     ImGui::Checkbox("Show Vertex Normal", &ShowVertexNormal);
 
+    //Shown again with the picked level, not while the passes rewrite the contexts
+    ImGui::BeginDisabled(GeneratorIsWorking || PreviewLodNum == 0);
+    if (ImGui::SliderInt("Preview LOD", &PreviewLod, 0, PreviewLodNum) && !MeshList.empty())
+        KickShowModel();
+    ImGui::EndDisabled();
+
+    UpdateNormalLines(!GeneratorIsWorking);
+    if (NormalLineBuilding)
+        ImGui::Text("Building Normal Lines...");
+    else if (GeneratorIsWorking && (ShowFaceNormal || ShowVertexNormal))
+        ImGui::Text("Normal Lines wait for Generate...");
+
     ImGui::Separator();
 
     ImGui::End();
@@ -1032,30 +1092,39 @@ bool MeshRenderer::LoadMeshFromProcesser(Processer* InProcesser)
     std::cout << LINE_STRING << std::endl;
     std::cout << "Begin Loading Mesh Data..." << std::endl;
 
+    PreviewLodNum = 0;
     std::vector<SourceContext*>& SrcList = InProcesser->GetContextList();
     for (int i = 0; i < SrcList.size(); i++)
     {
+        //Levels index the full vertex list, only the indices change
+        std::vector<SourceLod>& LodList = SrcList[i]->LodList;
+        int Lod = MIN(PreviewLod, (int)LodList.size());
+        const DrawRawIndex* IndexList = Lod > 0 ? LodList[Lod - 1].IndexList.data() : SrcList[i]->DrawIndexList;
+        PreviewLodNum = MAX(PreviewLodNum, (int)LodList.size());
 
         Mesh NewMesh;
         NewMesh.Name = SrcList[i]->Name;
-        NewMesh.Triangle.IndexNum = SrcList[i]->GetTriangleNum() * 3;
+        NewMesh.Triangle.IndexNum = Lod > 0 ? (int)LodList[Lod - 1].IndexList.size() : SrcList[i]->GetTriangleNum() * 3;
         NewMesh.Triangle.VertexNum = SrcList[i]->GetVertexNum();
-        NewMesh.FaceNormal.IndexNum = SrcList[i]->GetTriangleNum() * 2;
-        NewMesh.FaceNormal.VertexNum = SrcList[i]->GetTriangleNum() * 2;
-        NewMesh.VertexNormal.IndexNum = SrcList[i]->GetVertexNum() * 2;
-        NewMesh.VertexNormal.VertexNum = SrcList[i]->GetVertexNum() * 2;
-        NewMesh.Bounding = SrcList[i]->Bounding;
+        //Context->Bounding may be the [-1,1] default or stale after a pass moved vertices,
+        //and PackedVertex clamps everything outside the box
+        NewMesh.Bounding = CalculateBounding(SrcList[i]->DrawVertexList, NewMesh.Triangle.VertexNum);
+        NewMesh.Quantization = VertexQuantization(NewMesh.Bounding);
 
         std::cout << "Loading Mesh : " << NewMesh.Name << std::endl;
+        std::cout << "LOD        : " << Lod << std::endl;
         std::cout << "Index Num  : " << NewMesh.Triangle.IndexNum << std::endl;
         std::cout << "Vertex Num : " << NewMesh.Triangle.VertexNum << std::endl;
 
 
         D3D12_RANGE Range;
         {
-            if (!CreateCommittedResource(NewMesh.Triangle.VertexNum * sizeof(DrawRawVertex), D3dDevice, &NewMesh.Triangle.VertexBuffer))
+            UINT VertexStride = UsePackedVertex ? sizeof(PackedVertex) : sizeof(DrawRawVertex);
+            if (!CreateCommittedResource(NewMesh.Triangle.VertexNum * VertexStride, D3dDevice, &NewMesh.Triangle.VertexBuffer))
                 return false;
-            if (!CreateCommittedResource(NewMesh.Triangle.IndexNum * sizeof(DrawRawIndex), D3dDevice, &NewMesh.Triangle.IndexBuffer))
+            bool Index16 = CanUseIndex16(NewMesh.Triangle.VertexNum);
+            UINT IndexStride = Index16 ? sizeof(DrawRawIndex16) : sizeof(DrawRawIndex);
+            if (!CreateCommittedResource(NewMesh.Triangle.IndexNum * IndexStride, D3dDevice, &NewMesh.Triangle.IndexBuffer))
                 return false;
 
             void* VertexResource = nullptr;
@@ -1064,115 +1133,220 @@ bool MeshRenderer::LoadMeshFromProcesser(Processer* InProcesser)
 
             if (NewMesh.Triangle.VertexBuffer->Map(0, &Range, &VertexResource) != S_OK)
                 return false;
-            DrawRawVertex* VertexDest = (DrawRawVertex*)VertexResource;
-            memcpy(VertexDest, SrcList[i]->DrawVertexList, NewMesh.Triangle.VertexNum * sizeof(DrawRawVertex));
+            if (UsePackedVertex)
+            {
+                //Encode straight into the upload heap
+                PackedVertex* VertexDest = (PackedVertex*)VertexResource;
+                EncodeVertices(SrcList[i]->DrawVertexList, VertexDest, NewMesh.Triangle.VertexNum, NewMesh.Quantization);
+            }
+            else
+            {
+                DrawRawVertex* VertexDest = (DrawRawVertex*)VertexResource;
+                memcpy(VertexDest, SrcList[i]->DrawVertexList, NewMesh.Triangle.VertexNum * sizeof(DrawRawVertex));
+            }
             NewMesh.Triangle.VertexBuffer->Unmap(0, &Range);
 
             if (NewMesh.Triangle.IndexBuffer->Map(0, &Range, &IndexResource) != S_OK)
                 return false;
-            DrawRawIndex* IndexDest = (DrawRawIndex*)IndexResource;
-            memcpy(IndexDest, SrcList[i]->DrawIndexList, NewMesh.Triangle.IndexNum * sizeof(DrawRawIndex));
+            if (Index16)
+            {
+                DrawRawIndex16* IndexDest = (DrawRawIndex16*)IndexResource;
+                NarrowIndices(IndexList, IndexDest, NewMesh.Triangle.IndexNum);
+            }
+            else
+            {
+                DrawRawIndex* IndexDest = (DrawRawIndex*)IndexResource;
+                memcpy(IndexDest, IndexList, NewMesh.Triangle.IndexNum * sizeof(DrawRawIndex));
+            }
             NewMesh.Triangle.IndexBuffer->Unmap(0, &Range);
 
             NewMesh.Triangle.VertexBufferView.BufferLocation = NewMesh.Triangle.VertexBuffer->GetGPUVirtualAddress();
-            NewMesh.Triangle.VertexBufferView.StrideInBytes = sizeof(DrawRawVertex);
-            NewMesh.Triangle.VertexBufferView.SizeInBytes = NewMesh.Triangle.VertexNum * sizeof(DrawRawVertex);
+            NewMesh.Triangle.VertexBufferView.StrideInBytes = VertexStride;
+            NewMesh.Triangle.VertexBufferView.SizeInBytes = NewMesh.Triangle.VertexNum * VertexStride;
 
             NewMesh.Triangle.IndexBufferView.BufferLocation = NewMesh.Triangle.IndexBuffer->GetGPUVirtualAddress();
-            NewMesh.Triangle.IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-            NewMesh.Triangle.IndexBufferView.SizeInBytes = NewMesh.Triangle.IndexNum * sizeof(DrawRawIndex);
+            NewMesh.Triangle.IndexBufferView.Format = Index16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+            NewMesh.Triangle.IndexBufferView.SizeInBytes = NewMesh.Triangle.IndexNum * IndexStride;
         }
 
-        {
-            if (!CreateCommittedResource(NewMesh.FaceNormal.VertexNum * sizeof(DrawRawVertex), D3dDevice, &NewMesh.FaceNormal.VertexBuffer))
-                return false;
-            if (!CreateCommittedResource(NewMesh.FaceNormal.IndexNum * sizeof(DrawRawIndex), D3dDevice, &NewMesh.FaceNormal.IndexBuffer))
-                return false;
+        std::cout << "Loading Mesh Finished : " << NewMesh.Name << std::endl;
 
-            void* VertexResource = nullptr;
-            void* IndexResource = nullptr;
-            memset(&Range, 0, sizeof(D3D12_RANGE));
+        MeshList.push_back(NewMesh);
+        TotalBounding.Resize(NewMesh.Bounding);
+    }
 
-            if (NewMesh.FaceNormal.VertexBuffer->Map(0, &Range, &VertexResource) != S_OK)
-                return false;
-            DrawRawVertex* VertexDest = (DrawRawVertex*)VertexResource;
-            memcpy(VertexDest, SrcList[i]->DrawFaceNormalVertexList, NewMesh.FaceNormal.VertexNum * sizeof(DrawRawVertex));
-            NewMesh.FaceNormal.VertexBuffer->Unmap(0, &Range);
+    //Normal lines are built from these once a checkbox asks for them
+    NormalLineSource = SrcList;
 
-            if (NewMesh.FaceNormal.IndexBuffer->Map(0, &Range, &IndexResource) != S_OK)
-                return false;
-            DrawRawIndex* IndexDest = (DrawRawIndex*)IndexResource;
-            memcpy(IndexDest, SrcList[i]->DrawFaceNormalIndexList, NewMesh.FaceNormal.IndexNum * sizeof(DrawRawIndex));
-            NewMesh.FaceNormal.IndexBuffer->Unmap(0, &Range);
+    RenderCamera.Reset(TotalBounding);
+    std::cout << "Loading Mesh Finished." << std::endl;
+    std::cout << LINE_STRING << std::endl;
+
+    return true;
+}
 
-            NewMesh.FaceNormal.VertexBufferView.BufferLocation = NewMesh.FaceNormal.VertexBuffer->GetGPUVirtualAddress();
-            NewMesh.FaceNormal.VertexBufferView.StrideInBytes = sizeof(DrawRawVertex);
-            NewMesh.FaceNormal.VertexBufferView.SizeInBytes = NewMesh.FaceNormal.VertexNum * sizeof(DrawRawVertex);
 
-            NewMesh.FaceNormal.IndexBufferView.BufferLocation = NewMesh.FaceNormal.IndexBuffer->GetGPUVirtualAddress();
-            NewMesh.FaceNormal.IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-            NewMesh.FaceNormal.IndexBufferView.SizeInBytes = NewMesh.FaceNormal.IndexNum * sizeof(DrawRawIndex);
-        }
+void MeshRenderer::ClearResource()
+{
+    //Workers may still write into the mapped line buffers
+    NormalBuilder.Wait();
+    NormalLineBuilding = false;
+    NormalLineReleaseSignal = false;
+    NormalLineSource.clear();
+    for (int i = 0; i < (int)NormalLineType::Num; i++)
+    {
+        NormalLineReady[i] = false;
+    }
 
-        {
-            if (!CreateCommittedResource(NewMesh.VertexNormal.VertexNum * sizeof(DrawRawVertex), D3dDevice, &NewMesh.VertexNormal.VertexBuffer))
-                return false;
-            if (!CreateCommittedResource(NewMesh.VertexNormal.IndexNum * sizeof(DrawRawIndex), D3dDevice, &NewMesh.VertexNormal.IndexBuffer))
-                return false;
+    std::vector<Mesh>::iterator it;
+    for (it = MeshList.begin(); it != MeshList.end(); it++)
+    {
+        it->Clear();
+    }
+    MeshList.clear();
 
-            void* VertexResource = nullptr;
-            void* IndexResource = nullptr;
-            memset(&Range, 0, sizeof(D3D12_RANGE));
+    TotalBounding.Clear();
 
-            if (NewMesh.VertexNormal.VertexBuffer->Map(0, &Range, &VertexResource) != S_OK)
-                return false;
-            DrawRawVertex* VertexDest = (DrawRawVertex*)VertexResource;
-            memcpy(VertexDest, SrcList[i]->DrawVertexNormalVertexList, NewMesh.VertexNormal.VertexNum * sizeof(DrawRawVertex));
-            NewMesh.VertexNormal.VertexBuffer->Unmap(0, &Range);
+}
 
-            if (NewMesh.VertexNormal.IndexBuffer->Map(0, &Range, &IndexResource) != S_OK)
-                return false;
-            DrawRawIndex* IndexDest = (DrawRawIndex*)IndexResource;
-            memcpy(IndexDest, SrcList[i]->DrawVertexNormalIndexList, NewMesh.VertexNormal.IndexNum * sizeof(DrawRawIndex));
-            NewMesh.VertexNormal.IndexBuffer->Unmap(0, &Range);
 
-            NewMesh.VertexNormal.VertexBufferView.BufferLocation = NewMesh.VertexNormal.VertexBuffer->GetGPUVirtualAddress();
-            NewMesh.VertexNormal.VertexBufferView.StrideInBytes = sizeof(DrawRawVertex);
-            NewMesh.VertexNormal.VertexBufferView.SizeInBytes = NewMesh.VertexNormal.VertexNum * sizeof(DrawRawVertex);
+void MeshRenderer::UpdateNormalLines(bool CanKick)
+{
+    if (NormalLineBuilding)
+    {
+        if (NormalBuilder.IsWorking())
+            return;
+        FinishNormalLines();
+    }
 
-            NewMesh.VertexNormal.IndexBufferView.BufferLocation = NewMesh.VertexNormal.IndexBuffer->GetGPUVirtualAddress();
-            NewMesh.VertexNormal.IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-            NewMesh.VertexNormal.IndexBufferView.SizeInBytes = NewMesh.VertexNormal.IndexNum * sizeof(DrawRawIndex);
+    bool Wanted[(int)NormalLineType::Num] = { ShowFaceNormal, ShowVertexNormal };
+
+    //Stop drawing now, the buffers go once the GPU is done with them
+    for (int i = 0; i < (int)NormalLineType::Num; i++)
+    {
+        if (!Wanted[i] && NormalLineReady[i])
+        {
+            NormalLineReady[i] = false;
+            NormalLineReleaseSignal = true;
         }
+    }
 
+    //Can't build from contexts that changed after the model was shown, LoadMeshFromProcesser() sets them again
+    if (!CanKick || NormalLineSource.size() != MeshList.size())
+        return;
 
+    for (int i = 0; i < (int)NormalLineType::Num; i++)
+    {
+        if (Wanted[i] && !NormalLineReady[i])
+        {
+            if (!KickNormalLines((NormalLineType)i))
+                Hint.Error("Build Normal Lines Failed.");
+            break;
+        }
+    }
+}
 
 
-        std::cout << "Loading Mesh Finished : " << NewMesh.Name << std::endl;
+bool MeshRenderer::KickNormalLines(NormalLineType Type)
+{
+    std::vector<NormalLineTarget> Targets;
+    D3D12_RANGE Range;
+    memset(&Range, 0, sizeof(D3D12_RANGE));
 
-        MeshList.push_back(NewMesh);
-        TotalBounding.Resize(NewMesh.Bounding);
+    bool Success = true;
+    for (int i = 0; i < MeshList.size() && Success; i++)
+    {
+        MeshData& Lines = MeshList[i].GetNormalLine(Type);
+        Lines.Clear();
+        Lines.VertexNum = GetNormalLineVertexNum(NormalLineSource[i], Type);
+        if (Lines.VertexNum == 0)
+            continue;
+
+        void* VertexResource = nullptr;
+        if (!CreateCommittedResource(Lines.VertexNum * sizeof(DrawRawVertex), D3dDevice, &Lines.VertexBuffer) ||
+            Lines.VertexBuffer->Map(0, &Range, &VertexResource) != S_OK)
+        {
+            Success = false;
+            break;
+        }
+
+        NormalLineTarget Target;
+        Target.Context = NormalLineSource[i];
+        Target.Length = GetNormalLineLength(MeshList[i].Bounding);
+        //Workers write the lines straight into the upload heap
+        Target.Dst = (DrawRawVertex*)VertexResource;
+        Targets.push_back(Target);
     }
 
-    RenderCamera.Reset(TotalBounding);
-    std::cout << "Loading Mesh Finished." << std::endl;
-    std::cout << LINE_STRING << std::endl;
+    if (Success)
+        Success = NormalBuilder.Kick(Targets, Type);
+
+    if (!Success)
+    {
+        for (int i = 0; i < MeshList.size(); i++)
+        {
+            MeshList[i].GetNormalLine(Type).Clear();
+        }
+        return false;
+    }
 
+    NormalLineBuilding = true;
     return true;
 }
 
 
-void MeshRenderer::ClearResource()
+void MeshRenderer::FinishNormalLines()
 {
-    std::vector<Mesh>::iterator it;
-    for (it = MeshList.begin(); it != MeshList.end(); it++)
+    NormalLineType Type = NormalBuilder.GetType();
+    for (int i = 0; i < MeshList.size(); i++)
     {
-        it->Clear();
+        MeshData& Lines = MeshList[i].GetNormalLine(Type);
+        if (Lines.VertexBuffer == nullptr)
+            continue;
+
+        //Whole buffer written
+        Lines.VertexBuffer->Unmap(0, nullptr);
+
+        Lines.VertexBufferView.BufferLocation = Lines.VertexBuffer->GetGPUVirtualAddress();
+        Lines.VertexBufferView.StrideInBytes = sizeof(DrawRawVertex);
+        Lines.VertexBufferView.SizeInBytes = Lines.VertexNum * sizeof(DrawRawVertex);
     }
-    MeshList.clear();
 
-    TotalBounding.Clear();
+    NormalLineReady[(int)Type] = true;
+    NormalLineBuilding = false;
+}
 
+
+void MeshRenderer::ReleaseNormalLines()
+{
+    for (int i = 0; i < (int)NormalLineType::Num; i++)
+    {
+        if (NormalLineReady[i] || (NormalLineBuilding && NormalBuilder.GetType() == (NormalLineType)i))
+            continue;
+
+        for (int j = 0; j < MeshList.size(); j++)
+        {
+            MeshList[j].GetNormalLine((NormalLineType)i).Clear();
+        }
+    }
+    NormalLineReleaseSignal = false;
+}
+
+
+void MeshRenderer::CancelNormalLines()
+{
+    NormalBuilder.Wait();
+    if (NormalLineBuilding)
+    {
+        //Never drawn, no need to wait for the GPU
+        NormalLineType Type = NormalBuilder.GetType();
+        for (int i = 0; i < MeshList.size(); i++)
+        {
+            MeshList[i].GetNormalLine(Type).Clear();
+        }
+        NormalLineBuilding = false;
+    }
+    NormalLineSource.clear();
 }
 
 
@@ -1189,12 +1363,18 @@ bool MeshRenderer::InitRenderPipeline(D3D12_RASTERIZER_DESC* InRasterizerDesc, D
         DescriptorRange[0].RegisterSpace = 0;
         DescriptorRange[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
-        D3D12_ROOT_PARAMETER RootParameters[1] = {};
+        D3D12_ROOT_PARAMETER RootParameters[2] = {};
         //CBV
         RootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
         RootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
         RootParameters[0].DescriptorTable.NumDescriptorRanges = _countof(DescriptorRange);
         RootParameters[0].DescriptorTable.pDescriptorRanges = &DescriptorRange[0];
+        //Per mesh VertexQuantization
+        RootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        RootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+        RootParameters[1].Constants.ShaderRegister = 1;
+        RootParameters[1].Constants.RegisterSpace = 0;
+        RootParameters[1].Constants.Num32BitValues = sizeof(VertexQuantization) / 4;
 
         D3D12_ROOT_SIGNATURE_DESC RootSignatureDesc = {};
         RootSignatureDesc.NumParameters = _countof(RootParameters);
@@ -1243,8 +1423,9 @@ bool MeshRenderer::InitRenderPipeline(D3D12_RASTERIZER_DESC* InRasterizerDesc, D
 
         
         bool Success = true;
-        D3D_SHADER_MACRO Defines1[] = { {"DRAW_WIREFRAME", "0"} , {"DRAW_NORMAL", "0"} , {NULL, NULL} };
-        D3D_SHADER_MACRO Defines2[] = { {"DRAW_WIREFRAME", "1"} , {"DRAW_NORMAL", "0"} , {NULL, NULL} };
+        const char* PackedVertexDefine = UsePackedVertex ? "1" : "0";
+        D3D_SHADER_MACRO Defines1[] = { {"DRAW_WIREFRAME", "0"} , {"DRAW_NORMAL", "0"} , {"PACKED_VERTEX", PackedVertexDefine} , {NULL, NULL} };
+        D3D_SHADER_MACRO Defines2[] = { {"DRAW_WIREFRAME", "1"} , {"DRAW_NORMAL", "0"} , {"PACKED_VERTEX", PackedVertexDefine} , {NULL, NULL} };
         D3D_SHADER_MACRO Defines3[] = { {"DRAW_WIREFRAME", "0"} , {"DRAW_NORMAL", "1"} , {NULL, NULL} };
 
         //std::cout << "Compile Shader Path : \n" << InternalShader << std::endl;
@@ -1315,10 +1496,19 @@ bool MeshRenderer::InitRenderPipeline(D3D12_RASTERIZER_DESC* InRasterizerDesc, D
             { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
             { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
         };
+        D3D12_INPUT_ELEMENT_DESC PackedInputElementDesc[] =
+        {
+            { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+        };
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC PipelineStateDesc = {};
         memset(&PipelineStateDesc, 0, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
-        PipelineStateDesc.InputLayout = { InputElementDesc, _countof(InputElementDesc) };
+        if (UsePackedVertex)
+            PipelineStateDesc.InputLayout = { PackedInputElementDesc, _countof(PackedInputElementDesc) };
+        else
+            PipelineStateDesc.InputLayout = { InputElementDesc, _countof(InputElementDesc) };
         PipelineStateDesc.pRootSignature = RootSignature;
 
         PipelineStateDesc.VS.pShaderBytecode = BlobVertexShader1->GetBufferPointer();
@@ -1405,6 +1595,8 @@ bool MeshRenderer::InitRenderPipeline(D3D12_RASTERIZER_DESC* InRasterizerDesc, D
             return false;
         }
 
+        //Normal lines stay in DrawRawVertex
+        PipelineStateDesc.InputLayout = { InputElementDesc, _countof(InputElementDesc) };
         PipelineStateDesc.VS.pShaderBytecode = BlobVertexShader3->GetBufferPointer();
         PipelineStateDesc.VS.BytecodeLength = BlobVertexShader3->GetBufferSize();
         PipelineStateDesc.PS.pShaderBytecode = BlobPixelShader3->GetBufferPointer();
@@ -1490,35 +1682,15 @@ void MeshRenderer::UpdateEveryFrameState(const Float3& DisplaySize)
     
     RenderCamera.AspectRatio = DisplaySize.x / DisplaySize.y;
 
-    DirectX::XMVECTOR Forward = DirectX::XMVectorSet(RenderCamera.Forward.x, RenderCamera.Forward.y, RenderCamera.Forward.z, 0.0f);
-    DirectX::XMVECTOR Left = DirectX::XMVectorSet(RenderCamera.Left.x, RenderCamera.Left.y, RenderCamera.Left.z, 0.0f);
-    DirectX::XMVECTOR UpDir= DirectX::XMVectorSet(RenderCamera.Up.x, RenderCamera.Up.y, RenderCamera.Up.z, 0.0f);
-    DirectX::XMVECTOR NegEyePosition = DirectX::XMVectorSet(-RenderCamera.Position.x, -RenderCamera.Position.y, -RenderCamera.Position.z, 1.0f);
-
-    DirectX::XMVECTOR D0 = DirectX::XMVector3Dot(Left, NegEyePosition); 
-    DirectX::XMVECTOR D1 = DirectX::XMVector3Dot(UpDir, NegEyePosition);
-    DirectX::XMVECTOR D2 = DirectX::XMVector3Dot(Forward, NegEyePosition);
-    DirectX::XMMATRIX ViewMatrix;
-    DirectX::XMVECTORU32 Mask = { { { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000 } } };
-    ViewMatrix.r[0] = DirectX::XMVectorSelect(D0, Left, Mask);
-    ViewMatrix.r[1] = DirectX::XMVectorSelect(D1, UpDir, Mask);
-    ViewMatrix.r[2] = DirectX::XMVectorSelect(D2, Forward, Mask);
-    ViewMatrix.r[3] = DirectX::XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-    ViewMatrix = DirectX::XMMatrixTranspose(ViewMatrix);
+    Matrix4x4 ViewMatrix = Matrix4x4::View(RenderCamera.Position, RenderCamera.Left, RenderCamera.Up, RenderCamera.Forward);
 
-    //DirectX::XMVECTOR EyePos = DirectX::XMVectorSet(RenderCamera.Position.x, RenderCamera.Position.y, RenderCamera.Position.z, 1.0);
-    //DirectX::XMVECTOR LookAt = DirectX::XMVectorSet(TotalBounding.Center.x, TotalBounding.Center.y, TotalBounding.Center.z, 1.0);
-    //UpDir = DirectX::XMVectorSet(0.0, 1.0, 0.0, 0.0);
-    //ViewMatrix = DirectX::XMMatrixLookAtLH(EyePos, LookAt, UpDir);
+    //ViewMatrix = Matrix4x4::LookAt(RenderCamera.Position, TotalBounding.Center, Float3(0.0f, 1.0f, 0.0f));
 
-    DirectX::XMMATRIX ProjectionMatrix = DirectX::XMMatrixPerspectiveFovLH(RenderCamera.FovY, RenderCamera.AspectRatio, MAX(0.0000001f, RenderCamera.NearZ), MAX(0.0000001f, RenderCamera.FarZ));
+    Matrix4x4 ProjectionMatrix = Matrix4x4::PerspectiveFov(RenderCamera.FovY, RenderCamera.AspectRatio, MAX(0.0000001f, RenderCamera.NearZ), MAX(0.0000001f, RenderCamera.FarZ));
 
-    DirectX::XMMATRIX MVP = XMMatrixMultiply(ViewMatrix, ProjectionMatrix);
+    Matrix4x4 MVP = ViewMatrix * ProjectionMatrix;
 
-    _mm_storeu_ps(ConstantParams.WorldViewProjection[0], MVP.r[0]);
-    _mm_storeu_ps(ConstantParams.WorldViewProjection[1], MVP.r[1]);
-    _mm_storeu_ps(ConstantParams.WorldViewProjection[2], MVP.r[2]);
-    _mm_storeu_ps(ConstantParams.WorldViewProjection[3], MVP.r[3]);
+    memcpy(ConstantParams.WorldViewProjection, MVP.m, sizeof(MVP.m));
 
 
 }
@@ -1557,6 +1729,7 @@ void MeshRenderer::RenderModel(const Float3& DisplaySize, ID3D12GraphicsCommandL
     CommandList->SetPipelineState(SolidPipelineState);
     for (std::vector<Mesh>::iterator it = MeshList.begin(); it != MeshList.end(); it++)
     {
+        CommandList->SetGraphicsRoot32BitConstants(1, sizeof(VertexQuantization) / 4, &(it->Quantization), 0);
         CommandList->IASetIndexBuffer(&(it->Triangle.IndexBufferView));
         CommandList->IASetVertexBuffers(0, 1, &(it->Triangle.VertexBufferView));
         CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -1569,6 +1742,7 @@ void MeshRenderer::RenderModel(const Float3& DisplaySize, ID3D12GraphicsCommandL
         CommandList->SetPipelineState(WireFramePipelineState);
         for (std::vector<Mesh>::iterator it = MeshList.begin(); it != MeshList.end(); it++)
         {
+            CommandList->SetGraphicsRoot32BitConstants(1, sizeof(VertexQuantization) / 4, &(it->Quantization), 0);
             CommandList->IASetIndexBuffer(&(it->Triangle.IndexBufferView));
             CommandList->IASetVertexBuffers(0, 1, &(it->Triangle.VertexBufferView));
             CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -1576,28 +1750,30 @@ void MeshRenderer::RenderModel(const Float3& DisplaySize, ID3D12GraphicsCommandL
         }
     }
 
-    if (ShowFaceNormal)
+    if (ShowFaceNormal && NormalLineReady[(int)NormalLineType::Face])
     {
         CommandList->SetPipelineState(LinePipelineState);
         for (std::vector<Mesh>::iterator it = MeshList.begin(); it != MeshList.end(); it++)
         {
-            CommandList->IASetIndexBuffer(&(it->FaceNormal.IndexBufferView));
+            if (it->FaceNormal.VertexNum == 0)
+                continue;
             CommandList->IASetVertexBuffers(0, 1, &(it->FaceNormal.VertexBufferView));
             CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
-            CommandList->DrawIndexedInstanced(it->FaceNormal.IndexNum, 1, 0, 0, 0);
+            CommandList->DrawInstanced(it->FaceNormal.VertexNum, 1, 0, 0);
         }
 
     }
 
-    if (ShowVertexNormal)
+    if (ShowVertexNormal && NormalLineReady[(int)NormalLineType::Vertex])
     {
         CommandList->SetPipelineState(LinePipelineState);
         for (std::vector<Mesh>::iterator it = MeshList.begin(); it != MeshList.end(); it++)
         {
-            CommandList->IASetIndexBuffer(&(it->VertexNormal.IndexBufferView));
+            if (it->VertexNormal.VertexNum == 0)
+                continue;
             CommandList->IASetVertexBuffers(0, 1, &(it->VertexNormal.VertexBufferView));
             CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
-            CommandList->DrawIndexedInstanced(it->VertexNormal.IndexNum, 1, 0, 0, 0);
+            CommandList->DrawInstanced(it->VertexNormal.VertexNum, 1, 0, 0);
         }
 
     }
@@ -14,7 +14,6 @@
 #include <windows.h>
 #include <wrl.h>
 #include <d3d12.h>
-#include <DirectXMath.h>
 #include <dxgi1_4.h>
 
 #include "imgui/imgui.h"
@@ -23,6 +22,11 @@
 
 #include "Utils.h"
 #include "Processer.h"
+#include "PassScheduler.h"
+#include "VertexFormat.h"
+#include "IndexFormat.h"
+#include "NormalLines.h"
+#include "MeshBounds.h"
 
 
 
@@ -220,13 +224,20 @@ public:
         VertexNormal.Clear();
     }
 
+    MeshData& GetNormalLine(NormalLineType Type)
+    {
+        return Type == NormalLineType::Face ? FaceNormal : VertexNormal;
+    }
+
 public:
     std::string Name;
     MeshData Triangle;
+    //Line lists without index buffer, only built while shown
     MeshData FaceNormal;
     MeshData VertexNormal;
 
     BoundingBox Bounding;
+    VertexQuantization Quantization;
 };
 
 
@@ -261,7 +272,8 @@ public:
 class MeshRenderer
 {
 public:
-    MeshRenderer(ID3D12Device* device, ID3D12DescriptorHeap* d3dSrcDescHeap):
+    //Normal lines are built on the threads of WorkerPool, which must outlive the renderer
+    MeshRenderer(ID3D12Device* device, ID3D12DescriptorHeap* d3dSrcDescHeap, ThreadPool* WorkerPool = nullptr):
         D3dDevice(device),
         D3dSrcDescriptorHeap(d3dSrcDescHeap),
         RootSignature(nullptr),
@@ -269,13 +281,22 @@ public:
         WireFramePipelineState(nullptr),
         LinePipelineState(nullptr),
         ConstantsBuffer(nullptr),
-        Signal(false)
+        Signal(false),
+        NormalLineBuilding(false),
+        NormalLineReleaseSignal(false),
+        NormalBuilder(65536, WorkerPool),
+        PreviewLodNum(0)
     {
         ShowWireFrame = false;
         ShowFaceNormal = false;
         ShowVertexNormal = false;
+        UsePackedVertex = false;
+        PreviewLod = 0;
 
- 
+        for (int i = 0; i < (int)NormalLineType::Num; i++)
+        {
+            NormalLineReady[i] = false;
+        }
     }
     ~MeshRenderer()
     {
@@ -307,12 +328,21 @@ public:
     }
     bool NeedWaitForLastSumittedFrame()
     {
-        return Signal;
+        return Signal || NormalLineReleaseSignal;
     }
     void KickShowModel()
     {
         Signal = true;
     }
+    void OnLastFrameFinished(Processer* InProcesser)
+    {
+        if (Signal)
+            LoadMesh(InProcesser);
+        if (NormalLineReleaseSignal)
+            ReleaseNormalLines();
+    }
+    //Call before the contexts change, lines already shown stay until the model is shown again
+    void CancelNormalLines();
     
     void RenderModel(const Float3& DisplaySize, ID3D12GraphicsCommandList* CommandList);
     void ShowViewerSettingUI(bool ModelIsLoaded, bool GeneratorIsWorking);
@@ -353,6 +383,13 @@ private:
     void UpdateEveryFrameState(const Float3& DisplaySize);
     bool LoadMeshFromProcesser(Processer* InProcesser);
 
+    //Build the lines of the checked boxes one type at a time, free the unchecked ones
+    //Nothing new is kicked unless CanKick, passes rewrite the contexts while the generator works
+    void UpdateNormalLines(bool CanKick);
+    bool KickNormalLines(NormalLineType Type);
+    void FinishNormalLines();
+    void ReleaseNormalLines();
+
 
 
 
@@ -361,6 +398,10 @@ public:
     bool ShowWireFrame;
     bool ShowFaceNormal;
     bool ShowVertexNormal;
+    //Read by Init(), triangles are uploaded as PackedVertex instead of DrawRawVertex
+    bool UsePackedVertex;
+    //0 uploads the full meshes, N uploads LodList[N - 1] of every mesh that has it and the coarsest level of the rest
+    int PreviewLod;
 
 
 private:
@@ -369,6 +410,15 @@ private:
     Camera RenderCamera;
     BoundingBox TotalBounding;
     bool Signal;
+    //Longest LodList of the meshes shown
+    int PreviewLodNum;
+
+    NormalLineBuilder NormalBuilder;
+    //Contexts MeshList was loaded from, empty once they may have changed
+    std::vector<SourceContext*> NormalLineSource;
+    bool NormalLineReady[(int)NormalLineType::Num];
+    bool NormalLineBuilding;
+    bool NormalLineReleaseSignal;
 
 private:
     ID3D12Device* D3dDevice;
@@ -446,7 +496,7 @@ private:
     void OnLastFrameFinished()
     {
         if (MeshViewer.get() && MeshViewer->NeedWaitForLastSumittedFrame())
-            MeshViewer->LoadMesh(ExternalProcesser);
+            MeshViewer->OnLastFrameFinished(ExternalProcesser);
 
         if (CallBackOnLastFrameFinishedRender != nullptr)
             CallBackOnLastFrameFinishedRender(ExternalProcesser, &Hint);
@@ -460,7 +510,7 @@ private:
     void BrowseFileOpen(std::filesystem::path* OutFilePath);
     void BrowseFileSave(std::filesystem::path* OutFilePath);
     void KickGenerateMission();
-    void ClearPassPool();
+    void ShowProfileUI();
 
 
 private:
@@ -472,7 +522,7 @@ private:
 
 private:
     std::unique_ptr<MeshRenderer> MeshViewer;
-    std::queue<PassType> PassPool;
+    std::unique_ptr<PassScheduler> Scheduler;
     double Progress;
 
     std::filesystem::path ImportFilePath;
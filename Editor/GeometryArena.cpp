@@ -0,0 +1,127 @@
+#include "GeometryArena.h"
+
+#include <utility>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+#define HUGE_PAGE_SIZE (2ull * 1024ull * 1024ull)
+
+
+GeometryArena::GeometryArena(size_t InBlockSize) :
+	BlockSize(InBlockSize),
+	UsedBytes(0),
+	ReservedBytes(0)
+{
+	//Whole huge pages
+	BlockSize = (BlockSize + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+
+GeometryArena::~GeometryArena()
+{
+	Reset();
+}
+
+
+bool GeometryArena::AllocateBlock(size_t MinSize)
+{
+	Block NewBlock;
+	NewBlock.Size = MinSize > BlockSize ? (MinSize + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE : BlockSize;
+	NewBlock.Offset = 0;
+	NewBlock.HugePage = false;
+	NewBlock.Memory = nullptr;
+
+#if defined(_WIN32)
+	NewBlock.Memory = (Byte*)::VirtualAlloc(NULL, NewBlock.Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	//Explicit huge pages first, needs vm.nr_hugepages
+	void* Memory = mmap(NULL, NewBlock.Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (Memory != MAP_FAILED)
+	{
+		NewBlock.HugePage = true;
+	}
+	else
+	{
+		//Otherwise let transparent huge pages back it
+		Memory = mmap(NULL, NewBlock.Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (Memory != MAP_FAILED)
+			madvise(Memory, NewBlock.Size, MADV_HUGEPAGE);
+		else
+			Memory = nullptr;
+	}
+	NewBlock.Memory = (Byte*)Memory;
+#endif
+
+	if (NewBlock.Memory == nullptr)
+	{
+		std::cout << "Geometry Arena: out of memory allocating " << NewBlock.Size << " bytes" << std::endl;
+		return false;
+	}
+
+	Blocks.push_back(NewBlock);
+	ReservedBytes += NewBlock.Size;
+	return true;
+}
+
+
+void GeometryArena::FreeBlock(Block& InBlock)
+{
+#if defined(_WIN32)
+	::VirtualFree(InBlock.Memory, 0, MEM_RELEASE);
+#else
+	munmap(InBlock.Memory, InBlock.Size);
+#endif
+	InBlock.Memory = nullptr;
+}
+
+
+void* GeometryArena::Allocate(size_t Size, size_t Alignment)
+{
+	if (Size == 0)
+		Size = 1;
+
+	LockGuard<PlatformCriticalSection> Lock(ArenaLock);
+
+	//Only the last block is bumped, the rest are full or were oversized
+	if (!Blocks.empty())
+	{
+		Block& Current = Blocks.back();
+		size_t Offset = (Current.Offset + Alignment - 1) / Alignment * Alignment;
+		if (Offset + Size <= Current.Size)
+		{
+			Current.Offset = Offset + Size;
+			UsedBytes += Size;
+			return Current.Memory + Offset;
+		}
+	}
+
+	//Blocks come page aligned, so a fresh one always fits from offset 0
+	if (!AllocateBlock(Size))
+		return nullptr;
+
+	Block& NewBlock = Blocks.back();
+	NewBlock.Offset = Size;
+	UsedBytes += Size;
+	Byte* Memory = NewBlock.Memory;
+
+	//A big buffer gets a block of its own, keep bumping the one before it
+	if (Size > BlockSize / 4 && Blocks.size() >= 2)
+		std::swap(Blocks[Blocks.size() - 1], Blocks[Blocks.size() - 2]);
+
+	return Memory;
+}
+
+
+void GeometryArena::Reset()
+{
+	LockGuard<PlatformCriticalSection> Lock(ArenaLock);
+	for (int i = 0; i < Blocks.size(); i++)
+	{
+		FreeBlock(Blocks[i]);
+	}
+	Blocks.clear();
+	UsedBytes = 0;
+	ReservedBytes = 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <new>
+
+#include "Utils.h"
+#include "ThreadProcesser.h"
+
+
+/*
+* Bump allocator for the geometry of one import.
+* Blocks come straight from the OS (huge pages on Linux when available),
+* nothing is freed one by one, Reset() hands every block back at once.
+*/
+class GeometryArena
+{
+public:
+	GeometryArena(size_t InBlockSize = 64ull * 1024ull * 1024ull);
+	~GeometryArena();
+
+	GeometryArena(const GeometryArena& Other) = delete;
+	GeometryArena& operator=(const GeometryArena& Other) = delete;
+
+	/****Call in Any Thread****/
+	//Return nullptr when the OS has no block left
+	void* Allocate(size_t Size, size_t Alignment = 64);
+
+	//Return nullptr and construct nothing when out of memory
+	template<typename T>
+	T* AllocateArray(size_t Num)
+	{
+		T* Array = (T*)Allocate(sizeof(T) * Num, alignof(T) > 64 ? alignof(T) : 64);
+		if (Array == nullptr)
+			return nullptr;
+
+		for (size_t i = 0; i < Num; i++)
+		{
+			new (Array + i) T();
+		}
+		return Array;
+	}
+
+	/****Call in Client****/
+	//Free everything, no destructor runs for what was allocated
+	void Reset();
+
+	size_t GetUsedBytes() const
+	{
+		return UsedBytes;
+	}
+	size_t GetReservedBytes() const
+	{
+		return ReservedBytes;
+	}
+
+private:
+	struct Block
+	{
+		Byte* Memory;
+		size_t Size;
+		size_t Offset;
+		bool HugePage;
+	};
+
+	bool AllocateBlock(size_t MinSize);
+	static void FreeBlock(Block& InBlock);
+
+private:
+	PlatformCriticalSection ArenaLock;
+	std::vector<Block> Blocks;
+	size_t BlockSize;
+	size_t UsedBytes;
+	size_t ReservedBytes;
+};
@@ -0,0 +1,72 @@
+#include "IndexFormat.h"
+#include "MeshBounds.h"
+
+
+using namespace std;
+
+
+void NarrowIndices(const DrawRawIndex* Src, DrawRawIndex16* Dst, size_t Num)
+{
+	for (size_t i = 0; i < Num; i++)
+	{
+		Dst[i] = (DrawRawIndex16)Src[i];
+	}
+}
+
+
+int SplitMeshForIndex16(SourceContext* Context, std::vector<MeshChunk16>& OutChunks, int MaxVertexNum)
+{
+	OutChunks.clear();
+	if (Context == nullptr || Context->DrawIndexList == nullptr || Context->DrawVertexList == nullptr)
+		return 0;
+
+	MaxVertexNum = MIN(MAX(MaxVertexNum, 3), INDEX16_MAX_VERTEX_NUM);
+
+	int VertexNum = Context->GetVertexNum();
+	int TriangleNum = Context->GetTriangleNum();
+
+	//Local index of every source vertex in the current chunk, valid when its stamp matches the chunk
+	std::vector<int> LocalIndex(VertexNum, 0);
+	std::vector<int> Stamp(VertexNum, -1);
+
+	MeshChunk16* Chunk = nullptr;
+	int ChunkIndex = -1;
+	for (int i = 0; i < TriangleNum; i++)
+	{
+		const DrawRawIndex* Triangle = Context->DrawIndexList + (size_t)i * 3;
+
+		int NewVertexNum = 0;
+		for (int j = 0; j < 3; j++)
+		{
+			if (Stamp[Triangle[j]] != ChunkIndex)
+				NewVertexNum++;
+		}
+		//Repeated corners of a degenerate triangle are counted twice, harmless
+		if (Chunk == nullptr || Chunk->Vertices.size() + NewVertexNum > MaxVertexNum)
+		{
+			OutChunks.emplace_back();
+			Chunk = &OutChunks.back();
+			ChunkIndex++;
+		}
+
+		for (int j = 0; j < 3; j++)
+		{
+			DrawRawIndex Index = Triangle[j];
+			if (Stamp[Index] != ChunkIndex)
+			{
+				Stamp[Index] = ChunkIndex;
+				LocalIndex[Index] = (int)Chunk->Vertices.size();
+				Chunk->Vertices.push_back(Context->DrawVertexList[Index]);
+			}
+			Chunk->Indices.push_back((DrawRawIndex16)LocalIndex[Index]);
+		}
+	}
+
+	//One pass over each chunk's own vertices once they are all gathered
+	for (MeshChunk16& Each : OutChunks)
+	{
+		Each.Bounding = CalculateBounding(Each.Vertices.data(), Each.Vertices.size());
+	}
+
+	return (int)OutChunks.size();
+}
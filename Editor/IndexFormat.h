@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include "Utils.h"
+#include "Processer.h"
+
+
+typedef std::uint16_t DrawRawIndex16;
+
+//Triangle lists have no strip cut value, so all 65536 vertices are addressable
+#define INDEX16_MAX_VERTEX_NUM 65536
+
+
+inline bool CanUseIndex16(int VertexNum)
+{
+	return VertexNum <= INDEX16_MAX_VERTEX_NUM;
+}
+
+//Dst must hold Num indices, every Src index must be below 65536
+void NarrowIndices(const DrawRawIndex* Src, DrawRawIndex16* Dst, size_t Num);
+
+
+/*
+* Part of a SourceContext that fits 16 bit indices.
+* Vertices are copied out, Indices are local to the chunk.
+*/
+struct MeshChunk16
+{
+	std::vector<DrawRawVertex> Vertices;
+	std::vector<DrawRawIndex16> Indices;
+	BoundingBox Bounding;
+};
+
+/*
+* Walks DrawIndexList in order and starts a new chunk whenever the next triangle
+* would need more than MaxVertexNum vertices, so triangle order is kept.
+* Return the number of chunks.
+*/
+int SplitMeshForIndex16(SourceContext* Context, std::vector<MeshChunk16>& OutChunks, int MaxVertexNum = INDEX16_MAX_VERTEX_NUM);
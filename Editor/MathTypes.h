@@ -0,0 +1,388 @@
+#pragma once
+
+#include <cmath>
+
+
+/*
+* Header only vector, matrix and quaternion types.
+* Scalars are float only and everything that needs no sqrt or trig is constexpr,
+* so hot loops inline to plain float math in any translation unit.
+* Components are separate members, so operator[] selects one instead of indexing past x.
+* Matrices are row major and transform row vectors, v * M, the way the shaders read them.
+*/
+
+
+struct Float2
+{
+	constexpr Float2() :
+		x(0.0f), y(0.0f) {}
+	constexpr Float2(float a) :
+		x(a), y(a) {}
+	constexpr Float2(float _x, float _y) :
+		x(_x), y(_y) {}
+
+	float x;
+	float y;
+
+	constexpr float& operator[](unsigned int i)
+	{
+		return (i == 0 ? x : y);
+	}
+	constexpr float& operator[](int i)
+	{
+		return (i == 0 ? x : y);
+	}
+	constexpr const float& operator[](unsigned int i) const
+	{
+		return (i == 0 ? x : y);
+	}
+	constexpr const float& operator[](int i) const
+	{
+		return (i == 0 ? x : y);
+	}
+
+	constexpr Float2& operator+=(const Float2& b) { x += b.x; y += b.y; return *this; }
+	constexpr Float2& operator-=(const Float2& b) { x -= b.x; y -= b.y; return *this; }
+	constexpr Float2& operator*=(float b) { x *= b; y *= b; return *this; }
+};
+
+constexpr Float2 operator-(const Float2& a) { return Float2(-a.x, -a.y); }
+constexpr Float2 operator-(const Float2& a, const Float2& b) { return Float2(a.x - b.x, a.y - b.y); }
+constexpr Float2 operator+(const Float2& a, const Float2& b) { return Float2(a.x + b.x, a.y + b.y); }
+constexpr Float2 operator*(const Float2& a, float b) { return Float2(a.x * b, a.y * b); }
+constexpr Float2 operator*(float a, const Float2& b) { return Float2(a * b.x, a * b.y); }
+constexpr Float2 operator*(const Float2& a, const Float2& b) { return Float2(a.x * b.x, a.y * b.y); }
+constexpr Float2 operator/(const Float2& a, float b) { return Float2(a.x / b, a.y / b); }
+constexpr bool operator==(const Float2& a, const Float2& b) { return a.x == b.x && a.y == b.y; }
+constexpr bool operator!=(const Float2& a, const Float2& b) { return !(a == b); }
+
+constexpr float Dot(const Float2& a, const Float2& b)
+{
+	return a.x * b.x + a.y * b.y;
+}
+//Never below 1e-6, so Normalize() of a zero vector stays zero
+inline float Length(const Float2& a)
+{
+	float Value = sqrtf(Dot(a, a));
+	return Value > 0.000001f ? Value : 0.000001f;
+}
+inline Float2 Normalize(const Float2& a)
+{
+	return a * (1.0f / Length(a));
+}
+
+
+
+struct Float3
+{
+	constexpr Float3() :
+		x(0.0f), y(0.0f), z(0.0f) {}
+	constexpr Float3(float a) :
+		x(a), y(a), z(a) {}
+	constexpr Float3(float _x, float _y, float _z) :
+		x(_x), y(_y), z(_z) {}
+
+	float x;
+	float y;
+	float z;
+
+	constexpr float& operator[](unsigned int i)
+	{
+		return (i == 0 ? x : (i == 1 ? y : z));
+	}
+	constexpr float& operator[](int i)
+	{
+		return (i == 0 ? x : (i == 1 ? y : z));
+	}
+	constexpr const float& operator[](unsigned int i) const
+	{
+		return (i == 0 ? x : (i == 1 ? y : z));
+	}
+	constexpr const float& operator[](int i) const
+	{
+		return (i == 0 ? x : (i == 1 ? y : z));
+	}
+
+	constexpr Float3& operator+=(const Float3& b) { x += b.x; y += b.y; z += b.z; return *this; }
+	constexpr Float3& operator-=(const Float3& b) { x -= b.x; y -= b.y; z -= b.z; return *this; }
+	constexpr Float3& operator*=(float b) { x *= b; y *= b; z *= b; return *this; }
+};
+
+constexpr Float3 operator-(const Float3& a) { return Float3(-a.x, -a.y, -a.z); }
+constexpr Float3 operator-(const Float3& a, const Float3& b) { return Float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+constexpr Float3 operator+(const Float3& a, const Float3& b) { return Float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+constexpr Float3 operator*(const Float3& a, float b) { return Float3(a.x * b, a.y * b, a.z * b); }
+constexpr Float3 operator*(float a, const Float3& b) { return Float3(a * b.x, a * b.y, a * b.z); }
+constexpr Float3 operator*(const Float3& a, const Float3& b) { return Float3(a.x * b.x, a.y * b.y, a.z * b.z); }
+constexpr Float3 operator/(const Float3& a, float b) { return Float3(a.x / b, a.y / b, a.z / b); }
+constexpr bool operator==(const Float3& a, const Float3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+constexpr bool operator!=(const Float3& a, const Float3& b) { return !(a == b); }
+
+constexpr float Dot(const Float3& a, const Float3& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+constexpr Float3 Cross(const Float3& a, const Float3& b)
+{
+	return Float3(
+		a.y * b.z - a.z * b.y,
+		a.z * b.x - a.x * b.z,
+		a.x * b.y - a.y * b.x
+	);
+}
+//Never below 1e-6, so Normalize() of a zero vector stays zero
+inline float Length(const Float3& a)
+{
+	float Value = sqrtf(Dot(a, a));
+	return Value > 0.000001f ? Value : 0.000001f;
+}
+inline Float3 Normalize(const Float3& a)
+{
+	return a * (1.0f / Length(a));
+}
+
+//Unit normal of the triangle x y z
+inline Float3 CalculateNormal(const Float3& x, const Float3& y, const Float3& z)
+{
+	return Normalize(Cross(y - x, z - x));
+}
+
+
+
+struct Float4
+{
+	constexpr Float4() :
+		x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+	constexpr Float4(float a) :
+		x(a), y(a), z(a), w(a) {}
+	constexpr Float4(float _x, float _y, float _z, float _w) :
+		x(_x), y(_y), z(_z), w(_w) {}
+	constexpr Float4(const Float3& a, float _w) :
+		x(a.x), y(a.y), z(a.z), w(_w) {}
+
+	float x;
+	float y;
+	float z;
+	float w;
+
+	constexpr float& operator[](unsigned int i)
+	{
+		return (i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)));
+	}
+	constexpr float& operator[](int i)
+	{
+		return (i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)));
+	}
+	constexpr const float& operator[](unsigned int i) const
+	{
+		return (i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)));
+	}
+	constexpr const float& operator[](int i) const
+	{
+		return (i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)));
+	}
+
+	constexpr Float3 XYZ() const { return Float3(x, y, z); }
+};
+
+constexpr Float4 operator+(const Float4& a, const Float4& b) { return Float4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+constexpr Float4 operator*(const Float4& a, float b) { return Float4(a.x * b, a.y * b, a.z * b, a.w * b); }
+constexpr float Dot(const Float4& a, const Float4& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+
+
+struct Matrix4x4
+{
+	constexpr Matrix4x4() :
+		m{ { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } }
+	{}
+	constexpr Matrix4x4(const Float4& r0, const Float4& r1, const Float4& r2, const Float4& r3) :
+		m{ { r0.x, r0.y, r0.z, r0.w }, { r1.x, r1.y, r1.z, r1.w }, { r2.x, r2.y, r2.z, r2.w }, { r3.x, r3.y, r3.z, r3.w } }
+	{}
+
+	float m[4][4];
+
+	float* operator[](int Row)
+	{
+		return m[Row];
+	}
+	const float* operator[](int Row) const
+	{
+		return m[Row];
+	}
+
+	constexpr Float4 GetRow(int Row) const
+	{
+		return Float4(m[Row][0], m[Row][1], m[Row][2], m[Row][3]);
+	}
+
+	static constexpr Matrix4x4 Identity()
+	{
+		return Matrix4x4();
+	}
+
+	static constexpr Matrix4x4 Translation(const Float3& t)
+	{
+		return Matrix4x4(Float4(1.0f, 0.0f, 0.0f, 0.0f), Float4(0.0f, 1.0f, 0.0f, 0.0f), Float4(0.0f, 0.0f, 1.0f, 0.0f), Float4(t, 1.0f));
+	}
+
+	static constexpr Matrix4x4 Scale(const Float3& s)
+	{
+		return Matrix4x4(Float4(s.x, 0.0f, 0.0f, 0.0f), Float4(0.0f, s.y, 0.0f, 0.0f), Float4(0.0f, 0.0f, s.z, 0.0f), Float4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+	/*
+	* World to view from an orthonormal camera basis, left handed, +z is Forward.
+	* Same as XMMatrixLookToLH with Right = Cross(Up, Forward)
+	*/
+	static constexpr Matrix4x4 View(const Float3& Position, const Float3& Right, const Float3& Up, const Float3& Forward)
+	{
+		return Matrix4x4(
+			Float4(Right.x, Up.x, Forward.x, 0.0f),
+			Float4(Right.y, Up.y, Forward.y, 0.0f),
+			Float4(Right.z, Up.z, Forward.z, 0.0f),
+			Float4(-Dot(Right, Position), -Dot(Up, Position), -Dot(Forward, Position), 1.0f));
+	}
+
+	static inline Matrix4x4 LookAt(const Float3& Position, const Float3& Target, const Float3& UpDirection)
+	{
+		Float3 Forward = Normalize(Target - Position);
+		Float3 Right = Normalize(Cross(UpDirection, Forward));
+		return View(Position, Right, Cross(Forward, Right), Forward);
+	}
+
+	//Left handed, depth 0 at NearZ and 1 at FarZ, same as XMMatrixPerspectiveFovLH
+	static inline Matrix4x4 PerspectiveFov(float FovY, float AspectRatio, float NearZ, float FarZ)
+	{
+		float Height = 1.0f / tanf(0.5f * FovY);
+		float Width = Height / AspectRatio;
+		float Range = FarZ / (FarZ - NearZ);
+		return Matrix4x4(
+			Float4(Width, 0.0f, 0.0f, 0.0f),
+			Float4(0.0f, Height, 0.0f, 0.0f),
+			Float4(0.0f, 0.0f, Range, 1.0f),
+			Float4(0.0f, 0.0f, -Range * NearZ, 0.0f));
+	}
+
+	constexpr Matrix4x4 Transpose() const
+	{
+		return Matrix4x4(
+			Float4(m[0][0], m[1][0], m[2][0], m[3][0]),
+			Float4(m[0][1], m[1][1], m[2][1], m[3][1]),
+			Float4(m[0][2], m[1][2], m[2][2], m[3][2]),
+			Float4(m[0][3], m[1][3], m[2][3], m[3][3]));
+	}
+
+	//Row vector times matrix
+	constexpr Float4 Transform(const Float4& v) const
+	{
+		return GetRow(0) * v.x + GetRow(1) * v.y + GetRow(2) * v.z + GetRow(3) * v.w;
+	}
+	constexpr Float3 TransformPoint(const Float3& p) const
+	{
+		return Transform(Float4(p, 1.0f)).XYZ();
+	}
+	constexpr Float3 TransformDirection(const Float3& d) const
+	{
+		return Transform(Float4(d, 0.0f)).XYZ();
+	}
+};
+
+//a then b
+constexpr Matrix4x4 operator*(const Matrix4x4& a, const Matrix4x4& b)
+{
+	return Matrix4x4(b.Transform(a.GetRow(0)), b.Transform(a.GetRow(1)), b.Transform(a.GetRow(2)), b.Transform(a.GetRow(3)));
+}
+
+
+
+struct Quaternion
+{
+	constexpr Quaternion() :
+		x(0.0f), y(0.0f), z(0.0f), w(1.0f) {}
+	constexpr Quaternion(float _x, float _y, float _z, float _w) :
+		x(_x), y(_y), z(_z), w(_w) {}
+
+	float x;
+	float y;
+	float z;
+	float w;
+
+	//Axis must be unit length, Angle in radians
+	static inline Quaternion FromAxisAngle(const Float3& Axis, float Angle)
+	{
+		float s = sinf(0.5f * Angle);
+		return Quaternion(Axis.x * s, Axis.y * s, Axis.z * s, cosf(0.5f * Angle));
+	}
+
+	constexpr Quaternion Conjugate() const
+	{
+		return Quaternion(-x, -y, -z, w);
+	}
+
+	constexpr Float3 Vector() const
+	{
+		return Float3(x, y, z);
+	}
+
+	//Rotate v by a unit quaternion
+	constexpr Float3 Rotate(const Float3& v) const
+	{
+		Float3 t = Cross(Vector(), v) * 2.0f;
+		return v + t * w + Cross(Vector(), t);
+	}
+
+	//Same rotation as Rotate(), as a matrix for row vectors
+	constexpr Matrix4x4 ToMatrix() const
+	{
+		return Matrix4x4(
+			Float4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f),
+			Float4(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f),
+			Float4(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f),
+			Float4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+};
+
+//Rotate by b, then by a
+constexpr Quaternion operator*(const Quaternion& a, const Quaternion& b)
+{
+	return Quaternion(
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+}
+
+constexpr float Dot(const Quaternion& a, const Quaternion& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+inline Quaternion Normalize(const Quaternion& a)
+{
+	float Value = sqrtf(Dot(a, a));
+	float Inv = Value > 0.000001f ? 1.0f / Value : 0.0f;
+	return Quaternion(a.x * Inv, a.y * Inv, a.z * Inv, a.w * Inv);
+}
+
+//Shortest arc, falls back to a normalized lerp when a and b are close
+inline Quaternion Slerp(const Quaternion& a, const Quaternion& b, float t)
+{
+	float CosAngle = Dot(a, b);
+	Quaternion End = CosAngle < 0.0f ? Quaternion(-b.x, -b.y, -b.z, -b.w) : b;
+	CosAngle = fabsf(CosAngle);
+
+	float Wa = 1.0f - t;
+	float Wb = t;
+	if (CosAngle < 0.9995f)
+	{
+		float Angle = acosf(CosAngle);
+		float InvSin = 1.0f / sinf(Angle);
+		Wa = sinf(Wa * Angle) * InvSin;
+		Wb = sinf(Wb * Angle) * InvSin;
+	}
+	return Normalize(Quaternion(a.x * Wa + End.x * Wb, a.y * Wa + End.y * Wb, a.z * Wa + End.z * Wb, a.w * Wa + End.w * Wb));
+}
@@ -0,0 +1,228 @@
+#include "MeshBounds.h"
+#include "VectorMath.h"
+#include "ByteStream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <cstdio>
+
+
+using namespace std;
+
+static PlatformCriticalSection PrintLock;
+
+
+BoundingBox CalculateBounding(const DrawRawVertex* VertexList, size_t Num)
+{
+	BoundingBox Box;
+	Float3 Min, Max;
+	if (VertexList != nullptr && MinMaxVertices(VertexList, Num, Min, Max))
+		Box.SetMinMax(Min, Max);
+	return Box;
+}
+
+
+BoundingSphere CalculateBoundingSphere(const DrawRawVertex* VertexList, size_t Num, const BoundingBox& Box)
+{
+	BoundingSphere Sphere;
+	Sphere.Center = Box.Center;
+	if (VertexList != nullptr)
+		Sphere.Radius = MaxDistanceVertices(VertexList, Num, Box.Center);
+	return Sphere;
+}
+
+
+
+//Partial results of one context, one slot per chunk
+struct BoundsJob
+{
+	BoundsJob(SourceContext* InContext, const ResultKey& InKey, int InChunkNum) :
+		Context(InContext),
+		Key(InKey),
+		ChunkMin(InChunkNum),
+		ChunkMax(InChunkNum),
+		ChunkRadius(InChunkNum, 0.0f),
+		RemainingChunks(InChunkNum)
+	{}
+
+	SourceContext* Context;
+	//Result cache key, invalid if not cached
+	ResultKey Key;
+	std::vector<Float3> ChunkMin;
+	std::vector<Float3> ChunkMax;
+	std::vector<float> ChunkRadius;
+	std::atomic<int> RemainingChunks;
+};
+
+
+/*
+* ChunkFunc(Job, Chunk, First, Num) on every chunk of every dirty context ReadFunc didn't restore from the result cache,
+* FinishFunc(Job) once all chunks of its context are done
+*/
+template<typename ReadFuncType, typename ChunkFuncType, typename FinishFuncType>
+static bool KickVertexChunks(Processer* InProcesser, int ChunkSize, size_t ParamHash, ReadFuncType ReadFunc, ChunkFuncType ChunkFunc, FinishFuncType FinishFunc)
+{
+	ChunkSize = MAX(ChunkSize, 1);
+
+	std::vector<SourceContext*> Contexts;
+	std::vector<ResultKey> Keys;
+	InProcesser->FindUncachedContexts(ParamHash, ReadFunc, Contexts, Keys);
+
+	std::shared_ptr<std::vector<std::unique_ptr<BoundsJob>>> Jobs = std::make_shared<std::vector<std::unique_ptr<BoundsJob>>>();
+	//First chunk of every job, plus the total at the end
+	std::vector<int> ChunkOffset(1, 0);
+
+	for (int i = 0; i < Contexts.size(); i++)
+	{
+		SourceContext* Context = Contexts[i];
+		int VertexNum = Context->GetVertexNum();
+		if (Context->DrawVertexList == nullptr || VertexNum <= 0)
+			continue;
+
+		int ChunkNum = (VertexNum + ChunkSize - 1) / ChunkSize;
+		ChunkOffset.push_back(ChunkOffset.back() + ChunkNum);
+		Jobs->push_back(std::unique_ptr<BoundsJob>(new BoundsJob(Context, Keys[i], ChunkNum)));
+	}
+
+	return InProcesser->KickRange(ChunkOffset.back(), [InProcesser, Jobs, ChunkOffset, ChunkSize, ChunkFunc, FinishFunc](int Begin, int End)
+		{
+			for (int Chunk = Begin; Chunk < End; Chunk++)
+			{
+				int Index = (int)(std::upper_bound(ChunkOffset.begin(), ChunkOffset.end(), Chunk) - ChunkOffset.begin()) - 1;
+				BoundsJob* Job = (*Jobs)[Index].get();
+
+				int LocalChunk = Chunk - ChunkOffset[Index];
+				int First = LocalChunk * ChunkSize;
+				int Num = MIN(ChunkSize, Job->Context->GetVertexNum() - First);
+				ChunkFunc(Job, LocalChunk, First, Num);
+
+				if (Job->RemainingChunks.fetch_sub(1) == 1)
+				{
+					std::vector<Byte> Data;
+					FinishFunc(Job, Data);
+					InProcesser->StorePassResult(Job->Key, Data);
+				}
+			}
+		}, 1);
+}
+
+
+//Bump the tags whenever the result of a pass changes, the chunk size doesn't change it
+static size_t GetBoundingParamHash()
+{
+	return HashFinalize(HashBytes("Bounding1", 9));
+}
+
+static size_t GetBoundingSphereParamHash()
+{
+	return HashFinalize(HashBytes("BoundingSphere1", 15));
+}
+
+
+static void PrintBounding(SourceContext* Context, const char* Suffix)
+{
+	const BoundingBox& Box = Context->Bounding;
+	char Line[512];
+	snprintf(Line, sizeof(Line), "Bounds : %s center (%.4f, %.4f, %.4f) half length (%.4f, %.4f, %.4f)%s", Context->Name.c_str(),
+		Box.Center.x, Box.Center.y, Box.Center.z, Box.HalfLength.x, Box.HalfLength.y, Box.HalfLength.z, Suffix);
+	LockGuard<PlatformCriticalSection> Lock(PrintLock);
+	std::cout << Line << std::endl;
+}
+
+static void PrintBoundingSphere(SourceContext* Context, const char* Suffix)
+{
+	const BoundingSphere& Sphere = Context->Sphere;
+	char Line[512];
+	snprintf(Line, sizeof(Line), "Bounding Sphere : %s center (%.4f, %.4f, %.4f) radius %.4f%s", Context->Name.c_str(),
+		Sphere.Center.x, Sphere.Center.y, Sphere.Center.z, Sphere.Radius, Suffix);
+	LockGuard<PlatformCriticalSection> Lock(PrintLock);
+	std::cout << Line << std::endl;
+}
+
+
+PassType MakeBoundingPass(int ChunkSize)
+{
+	return [ChunkSize](Processer* InProcesser, std::string& State) -> bool
+	{
+		State = "Calculating Bounds";
+
+		return KickVertexChunks(InProcesser, ChunkSize, GetBoundingParamHash(),
+			[](SourceContext* Context, const std::vector<Byte>& Data)
+			{
+				//Min then max
+				Float3 MinMax[2];
+				ByteReader Reader(Data);
+				Reader.ReadArray(&MinMax[0].x, 3);
+				Reader.ReadArray(&MinMax[1].x, 3);
+				if (!Reader.IsOk() || Reader.GetRemaining() != 0)
+					return false;
+
+				Context->Bounding.SetMinMax(MinMax[0], MinMax[1]);
+				PrintBounding(Context, " cached");
+				return true;
+			},
+			[](BoundsJob* Job, int Chunk, int First, int Num)
+			{
+				MinMaxVertices(Job->Context->DrawVertexList + First, Num, Job->ChunkMin[Chunk], Job->ChunkMax[Chunk]);
+			},
+			[](BoundsJob* Job, std::vector<Byte>& OutData)
+			{
+				Float3 Min = Job->ChunkMin[0];
+				Float3 Max = Job->ChunkMax[0];
+				for (int i = 1; i < Job->ChunkMin.size(); i++)
+				{
+					const Float3& ChunkMin = Job->ChunkMin[i];
+					const Float3& ChunkMax = Job->ChunkMax[i];
+					Min = Float3(MIN(Min.x, ChunkMin.x), MIN(Min.y, ChunkMin.y), MIN(Min.z, ChunkMin.z));
+					Max = Float3(MAX(Max.x, ChunkMax.x), MAX(Max.y, ChunkMax.y), MAX(Max.z, ChunkMax.z));
+				}
+				Job->Context->Bounding.SetMinMax(Min, Max);
+
+				ByteWriter Writer(OutData);
+				Writer.WriteArray(&Min.x, 3);
+				Writer.WriteArray(&Max.x, 3);
+				PrintBounding(Job->Context, "");
+			});
+	};
+}
+
+
+PassType MakeBoundingSpherePass(int ChunkSize)
+{
+	return [ChunkSize](Processer* InProcesser, std::string& State) -> bool
+	{
+		State = "Calculating Bounding Spheres";
+
+		return KickVertexChunks(InProcesser, ChunkSize, GetBoundingSphereParamHash(),
+			[](SourceContext* Context, const std::vector<Byte>& Data)
+			{
+				//Center then radius
+				BoundingSphere Sphere;
+				ByteReader Reader(Data);
+				Reader.ReadArray(&Sphere.Center.x, 3);
+				Sphere.Radius = Reader.ReadFloat();
+				if (!Reader.IsOk() || Reader.GetRemaining() != 0)
+					return false;
+
+				Context->Sphere = Sphere;
+				PrintBoundingSphere(Context, " cached");
+				return true;
+			},
+			[](BoundsJob* Job, int Chunk, int First, int Num)
+			{
+				Job->ChunkRadius[Chunk] = MaxDistanceVertices(Job->Context->DrawVertexList + First, Num, Job->Context->Bounding.Center);
+			},
+			[](BoundsJob* Job, std::vector<Byte>& OutData)
+			{
+				Job->Context->Sphere.Center = Job->Context->Bounding.Center;
+				Job->Context->Sphere.Radius = *std::max_element(Job->ChunkRadius.begin(), Job->ChunkRadius.end());
+
+				const BoundingSphere& Sphere = Job->Context->Sphere;
+				ByteWriter Writer(OutData);
+				Writer.WriteArray(&Sphere.Center.x, 3);
+				Writer.WriteFloat(Sphere.Radius);
+				PrintBoundingSphere(Job->Context, "");
+			});
+	};
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Utils.h"
+#include "Processer.h"
+
+
+//Box of the vertex positions with SIMD min/max, center and extent derived once at the end
+BoundingBox CalculateBounding(const DrawRawVertex* VertexList, size_t Num);
+
+//Centered on the box, radius to the farthest vertex
+BoundingSphere CalculateBoundingSphere(const DrawRawVertex* VertexList, size_t Num, const BoundingBox& Box);
+
+
+/*
+* Pass that sets Context->Bounding of every dirty context from its vertices.
+* Vertices of all contexts are cut into chunks of ChunkSize that go through the lane together,
+* the thread finishing the last chunk of a context merges its partial boxes.
+*/
+PassType MakeBoundingPass(int ChunkSize = 1 << 18);
+
+//Same for Context->Sphere, reads Context->Bounding so it goes after MakeBoundingPass()
+PassType MakeBoundingSpherePass(int ChunkSize = 1 << 18);
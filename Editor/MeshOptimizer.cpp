@@ -0,0 +1,296 @@
+#include "MeshOptimizer.h"
+#include "ByteStream.h"
+
+#include <cstdio>
+
+
+using namespace std;
+
+#define LINE_STRING "================================"
+
+static PlatformCriticalSection PrintLock;
+
+
+VertexCacheStats SimulateVertexCache(const DrawRawIndex* IndexList, size_t IndexNum, int VertexNum, int CacheSize)
+{
+	VertexCacheStats Stats;
+	Stats.TriangleNum = IndexNum / 3;
+	if (IndexList == nullptr || VertexNum <= 0)
+		return Stats;
+
+	//A vertex is in the cache while fewer than CacheSize misses came after its own
+	std::vector<size_t> MissStamp(VertexNum, 0);
+	std::vector<bool> Referenced(VertexNum, false);
+	for (size_t i = 0; i < IndexNum; i++)
+	{
+		DrawRawIndex Index = IndexList[i];
+		if (MissStamp[Index] == 0 || Stats.MissNum - MissStamp[Index] >= (size_t)CacheSize)
+		{
+			Stats.MissNum++;
+			MissStamp[Index] = Stats.MissNum;
+		}
+		if (!Referenced[Index])
+		{
+			Referenced[Index] = true;
+			Stats.VertexNum++;
+		}
+	}
+
+	return Stats;
+}
+
+
+void OptimizeVertexCache(DrawRawIndex* IndexList, size_t IndexNum, int VertexNum, int CacheSize)
+{
+	int TriangleNum = (int)(IndexNum / 3);
+	if (IndexList == nullptr || TriangleNum < 2 || VertexNum <= 0)
+		return;
+
+	//Triangles around every vertex
+	std::vector<int> LiveNum(VertexNum, 0);
+	for (size_t i = 0; i < (size_t)TriangleNum * 3; i++)
+	{
+		LiveNum[IndexList[i]]++;
+	}
+	std::vector<int> AdjacencyOffset(size_t(VertexNum) + 1, 0);
+	for (int i = 0; i < VertexNum; i++)
+	{
+		AdjacencyOffset[i + 1] = AdjacencyOffset[i] + LiveNum[i];
+	}
+	std::vector<int> Adjacency(AdjacencyOffset[VertexNum]);
+	{
+		std::vector<int> Cursor(AdjacencyOffset.begin(), AdjacencyOffset.end() - 1);
+		for (int i = 0; i < TriangleNum; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				Adjacency[Cursor[IndexList[i * 3 + j]]++] = i;
+			}
+		}
+	}
+
+	std::vector<int> CacheTime(VertexNum, 0);
+	std::vector<bool> Emitted(TriangleNum, false);
+	std::vector<int> DeadEnd;
+	std::vector<int> Candidates;
+	std::vector<DrawRawIndex> Result;
+	Result.reserve((size_t)TriangleNum * 3);
+
+	int Fanning = 0;
+	int Time = CacheSize + 1;
+	int Cursor = 0;
+	while (Fanning >= 0)
+	{
+		Candidates.clear();
+		for (int a = AdjacencyOffset[Fanning]; a < AdjacencyOffset[Fanning + 1]; a++)
+		{
+			int Triangle = Adjacency[a];
+			if (Emitted[Triangle])
+				continue;
+
+			for (int j = 0; j < 3; j++)
+			{
+				DrawRawIndex Vertex = IndexList[Triangle * 3 + j];
+				Result.push_back(Vertex);
+				DeadEnd.push_back(Vertex);
+				Candidates.push_back(Vertex);
+				LiveNum[Vertex]--;
+				if (Time - CacheTime[Vertex] > CacheSize)
+				{
+					CacheTime[Vertex] = Time;
+					Time++;
+				}
+			}
+			Emitted[Triangle] = true;
+		}
+
+		//Next fanning vertex, the oldest candidate that would still be in the cache after its own triangles,
+		//candidates that would not are left to the dead end stack
+		int Best = -1;
+		int BestPriority = 0;
+		for (int i = 0; i < Candidates.size(); i++)
+		{
+			int Vertex = Candidates[i];
+			if (LiveNum[Vertex] <= 0)
+				continue;
+
+			int Priority = 0;
+			if (Time - CacheTime[Vertex] + 2 * LiveNum[Vertex] <= CacheSize)
+				Priority = Time - CacheTime[Vertex];
+			if (Priority > BestPriority)
+			{
+				BestPriority = Priority;
+				Best = Vertex;
+			}
+		}
+
+		//Dead end, go back through recently used vertices then scan forward
+		while (Best < 0 && !DeadEnd.empty())
+		{
+			int Vertex = DeadEnd.back();
+			DeadEnd.pop_back();
+			if (LiveNum[Vertex] > 0)
+				Best = Vertex;
+		}
+		while (Best < 0 && Cursor < VertexNum)
+		{
+			if (LiveNum[Cursor] > 0)
+				Best = Cursor;
+			Cursor++;
+		}
+
+		Fanning = Best;
+	}
+
+	memcpy(IndexList, Result.data(), Result.size() * sizeof(DrawRawIndex));
+}
+
+
+int OptimizeVertexFetch(DrawRawVertex* VertexList, DrawRawIndex* IndexList, size_t IndexNum, int VertexNum)
+{
+	if (VertexList == nullptr || IndexList == nullptr || VertexNum <= 0)
+		return 0;
+
+	const DrawRawIndex Unused = ~DrawRawIndex(0);
+	std::vector<DrawRawIndex> Remap(VertexNum, Unused);
+
+	DrawRawIndex Next = 0;
+	for (size_t i = 0; i < IndexNum; i++)
+	{
+		DrawRawIndex& Index = IndexList[i];
+		if (Remap[Index] == Unused)
+			Remap[Index] = Next++;
+		Index = Remap[Index];
+	}
+	int ReferencedNum = (int)Next;
+
+	for (int i = 0; i < VertexNum; i++)
+	{
+		if (Remap[i] == Unused)
+			Remap[i] = Next++;
+	}
+
+	std::vector<DrawRawVertex> Reordered(VertexNum);
+	for (int i = 0; i < VertexNum; i++)
+	{
+		Reordered[Remap[i]] = VertexList[i];
+	}
+	memcpy(VertexList, Reordered.data(), VertexNum * sizeof(DrawRawVertex));
+
+	return ReferencedNum;
+}
+
+
+void VertexCacheReport::Print()
+{
+	LockGuard<PlatformCriticalSection> Lock(ReportLock);
+
+	char Line[256];
+	std::cout << LINE_STRING << std::endl;
+	std::cout << "Vertex Cache Report" << std::endl;
+	snprintf(Line, sizeof(Line), "Triangles : %zu, Vertices : %zu", After.TriangleNum, After.VertexNum);
+	std::cout << Line << std::endl;
+	snprintf(Line, sizeof(Line), "ACMR : %.3f -> %.3f", Before.GetACMR(), After.GetACMR());
+	std::cout << Line << std::endl;
+	snprintf(Line, sizeof(Line), "ATVR : %.3f -> %.3f", Before.GetATVR(), After.GetATVR());
+	std::cout << Line << std::endl;
+	std::cout << LINE_STRING << std::endl;
+}
+
+
+void WriteGeometry(SourceContext* Context, std::vector<Byte>& OutData)
+{
+	static_assert(sizeof(DrawRawVertex) == sizeof(float) * 10, "DrawRawVertex is written as 10 floats");
+
+	int VertexNum = MAX(Context->GetVertexNum(), 0);
+	size_t IndexNum = (size_t)Context->GetTriangleNum() * 3;
+
+	OutData.clear();
+	ByteWriter Writer(OutData);
+	Writer.Reserve(12 + (size_t)VertexNum * sizeof(DrawRawVertex) + IndexNum * sizeof(DrawRawIndex));
+	Writer.WriteUint32((std::uint32_t)VertexNum);
+	Writer.WriteUint64((std::uint64_t)IndexNum);
+	Writer.WriteArray((const float*)Context->DrawVertexList, (size_t)VertexNum * 10);
+	Writer.WriteArray(Context->DrawIndexList, IndexNum);
+}
+
+
+bool ReadGeometry(SourceContext* Context, const std::vector<Byte>& InData)
+{
+	if (Context->DrawVertexList == nullptr || Context->DrawIndexList == nullptr)
+		return false;
+
+	ByteReader Reader(InData);
+	size_t VertexNum = Reader.ReadUint32();
+	size_t IndexNum = (size_t)Reader.ReadUint64();
+
+	//Nothing is touched unless all of it fits
+	if (!Reader.IsOk()
+		|| VertexNum > (size_t)MAX(Context->GetVertexNum(), 0)
+		|| IndexNum != (size_t)Context->GetTriangleNum() * 3
+		|| Reader.GetRemaining() != VertexNum * sizeof(DrawRawVertex) + IndexNum * sizeof(DrawRawIndex))
+		return false;
+
+	Reader.ReadArray((float*)Context->DrawVertexList, VertexNum * 10);
+	Reader.ReadArray(Context->DrawIndexList, IndexNum);
+	if (VertexNum < (size_t)Context->GetVertexNum())
+		Context->SetVertexNum((int)VertexNum);
+
+	return Reader.IsOk();
+}
+
+
+//Bump the tag whenever the result of the pass changes
+static size_t GetVertexCacheParamHash(int CacheSize)
+{
+	size_t Hash = HashBytes("VertexCache1", 12);
+	Hash = HashCombine2(Hash, (size_t)CacheSize);
+	return HashFinalize(Hash);
+}
+
+
+PassType MakeVertexCachePass(int CacheSize, VertexCacheReport* Report)
+{
+	return [CacheSize, Report](Processer* InProcesser, std::string& State) -> bool
+	{
+		State = "Optimizing Vertex Cache";
+
+		std::vector<SourceContext*> Contexts;
+		std::vector<ResultKey> Keys;
+		InProcesser->FindUncachedContexts(GetVertexCacheParamHash(CacheSize), [](SourceContext* Context, const std::vector<Byte>& Data)
+			{
+				if (!ReadGeometry(Context, Data))
+					return false;
+				LockGuard<PlatformCriticalSection> Lock(PrintLock);
+				std::cout << "Vertex Cache : " << Context->Name << " cached" << std::endl;
+				return true;
+			}, Contexts, Keys);
+
+		return InProcesser->KickContexts(std::move(Contexts), [InProcesser, Keys = std::move(Keys), CacheSize, Report](SourceContext* Context, int i)
+			{
+				size_t IndexNum = (size_t)Context->GetTriangleNum() * 3;
+				int VertexNum = Context->GetVertexNum();
+
+				VertexCacheStats Before = SimulateVertexCache(Context->DrawIndexList, IndexNum, VertexNum, CacheSize);
+				OptimizeVertexCache(Context->DrawIndexList, IndexNum, VertexNum, CacheSize);
+				OptimizeVertexFetch(Context->DrawVertexList, Context->DrawIndexList, IndexNum, VertexNum);
+				VertexCacheStats After = SimulateVertexCache(Context->DrawIndexList, IndexNum, VertexNum, CacheSize);
+
+				if (Keys[i].IsValid())
+				{
+					std::vector<Byte> Data;
+					WriteGeometry(Context, Data);
+					InProcesser->StorePassResult(Keys[i], Data);
+				}
+
+				if (Report != nullptr)
+					Report->Add(Before, After);
+
+				char Line[512];
+				snprintf(Line, sizeof(Line), "Vertex Cache : %s ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+					Context->Name.c_str(), Before.GetACMR(), After.GetACMR(), Before.GetATVR(), After.GetATVR());
+				LockGuard<PlatformCriticalSection> Lock(PrintLock);
+				std::cout << Line << std::endl;
+			}, 1);
+	};
+}
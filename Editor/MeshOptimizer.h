@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Utils.h"
+#include "ThreadProcesser.h"
+#include "Processer.h"
+
+
+/*
+* ACMR : post-transform cache misses per triangle, 0.5 is the best a regular grid gets
+* ATVR : misses per referenced vertex, 1.0 is perfect
+*/
+struct VertexCacheStats
+{
+	VertexCacheStats() :
+		TriangleNum(0),
+		VertexNum(0),
+		MissNum(0)
+	{}
+
+	float GetACMR() const
+	{
+		return TriangleNum > 0 ? float(MissNum) / float(TriangleNum) : 0.0f;
+	}
+	float GetATVR() const
+	{
+		return VertexNum > 0 ? float(MissNum) / float(VertexNum) : 0.0f;
+	}
+
+	void Add(const VertexCacheStats& Other)
+	{
+		TriangleNum += Other.TriangleNum;
+		VertexNum += Other.VertexNum;
+		MissNum += Other.MissNum;
+	}
+
+	size_t TriangleNum;
+	//Only the vertices the index list references
+	size_t VertexNum;
+	size_t MissNum;
+};
+
+
+/*
+* FIFO post-transform cache of CacheSize entries, what most GPUs behave like closely enough
+*/
+VertexCacheStats SimulateVertexCache(const DrawRawIndex* IndexList, size_t IndexNum, int VertexNum, int CacheSize = 16);
+
+/*
+* Tipsify (Sander et al. 2007), reorders triangles in place for the post-transform cache.
+* Linear time, the cache size only shapes the heuristic.
+*/
+void OptimizeVertexCache(DrawRawIndex* IndexList, size_t IndexNum, int VertexNum, int CacheSize = 16);
+
+/*
+* Reorders vertices by first use in IndexList and rewrites the indices.
+* Vertices no triangle references are moved to the end.
+* Return the number of referenced vertices.
+*/
+int OptimizeVertexFetch(DrawRawVertex* VertexList, DrawRawIndex* IndexList, size_t IndexNum, int VertexNum);
+
+/*
+* Vertex and index arrays of a context, for the result cache of passes that reorder or compact them.
+* ReadGeometry() takes only data of the same triangle number and at most as many vertices,
+* and shrinks the context with SetVertexNum() like the passes do.
+*/
+void WriteGeometry(SourceContext* Context, std::vector<Byte>& OutData);
+bool ReadGeometry(SourceContext* Context, const std::vector<Byte>& InData);
+
+
+//Totals over every context a vertex cache pass went through
+class VertexCacheReport
+{
+public:
+	VertexCacheReport() {}
+
+	void Add(const VertexCacheStats& InBefore, const VertexCacheStats& InAfter)
+	{
+		LockGuard<PlatformCriticalSection> Lock(ReportLock);
+		Before.Add(InBefore);
+		After.Add(InAfter);
+	}
+	void Reset()
+	{
+		LockGuard<PlatformCriticalSection> Lock(ReportLock);
+		Before = VertexCacheStats();
+		After = VertexCacheStats();
+	}
+	void Print();
+
+private:
+	PlatformCriticalSection ReportLock;
+	VertexCacheStats Before;
+	VertexCacheStats After;
+};
+
+
+/*
+* Pass that runs OptimizeVertexCache then OptimizeVertexFetch on every dirty context in parallel.
+* ACMR/ATVR before and after are printed per context and summed into Report if given,
+* contexts restored from the result cache are left out of Report.
+* Report must outlive the pass.
+*/
+PassType MakeVertexCachePass(int CacheSize = 16, VertexCacheReport* Report = nullptr);
@@ -0,0 +1,642 @@
+#include "MeshSimplifier.h"
+#include "MeshBounds.h"
+#include "ByteStream.h"
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <cstdio>
+
+
+using namespace std;
+
+static PlatformCriticalSection PrintLock;
+
+
+//Sum of area weighted squared plane distances
+struct Quadric
+{
+	Quadric() :
+		A2(0.0), AB(0.0), AC(0.0), AD(0.0), B2(0.0), BC(0.0), BD(0.0), C2(0.0), CD(0.0), D2(0.0), Weight(0.0)
+	{}
+
+	void AddPlane(double A, double B, double C, double D, double InWeight)
+	{
+		A2 += InWeight * A * A; AB += InWeight * A * B; AC += InWeight * A * C; AD += InWeight * A * D;
+		B2 += InWeight * B * B; BC += InWeight * B * C; BD += InWeight * B * D;
+		C2 += InWeight * C * C; CD += InWeight * C * D;
+		D2 += InWeight * D * D;
+		Weight += InWeight;
+	}
+
+	void Add(const Quadric& Other)
+	{
+		A2 += Other.A2; AB += Other.AB; AC += Other.AC; AD += Other.AD;
+		B2 += Other.B2; BC += Other.BC; BD += Other.BD;
+		C2 += Other.C2; CD += Other.CD;
+		D2 += Other.D2;
+		Weight += Other.Weight;
+	}
+
+	//Root mean square distance of P to the planes
+	double Evaluate(const Float3& P) const
+	{
+		double X = P.x, Y = P.y, Z = P.z;
+		double Value = A2 * X * X + 2.0 * AB * X * Y + 2.0 * AC * X * Z + 2.0 * AD * X
+			+ B2 * Y * Y + 2.0 * BC * Y * Z + 2.0 * BD * Y
+			+ C2 * Z * Z + 2.0 * CD * Z
+			+ D2;
+		return Weight > 0.0 ? sqrt(MAX(Value, 0.0) / Weight) : 0.0;
+	}
+
+	double A2, AB, AC, AD, B2, BC, BD, C2, CD, D2;
+	double Weight;
+};
+
+
+struct Collapse
+{
+	float Error;
+	int From;
+	int To;
+	unsigned int FromVersion;
+	unsigned int ToVersion;
+
+	bool operator>(const Collapse& Other) const
+	{
+		return Error > Other.Error;
+	}
+};
+
+
+size_t SimplifyMesh(DrawRawIndex* Dst, const DrawRawIndex* IndexList, size_t IndexNum, const DrawRawVertex* VertexList,
+	size_t TargetIndexNum, float MaxError, float* OutError, const std::vector<bool>* Locked)
+{
+	if (OutError != nullptr)
+		*OutError = 0.0f;
+
+	int TriangleNum = (int)(IndexNum / 3);
+	if (IndexList == nullptr || VertexList == nullptr || TriangleNum == 0)
+		return 0;
+
+	//Local vertices, only what IndexList references
+	std::vector<DrawRawIndex> GlobalIndex(IndexList, IndexList + (size_t)TriangleNum * 3);
+	std::sort(GlobalIndex.begin(), GlobalIndex.end());
+	GlobalIndex.erase(std::unique(GlobalIndex.begin(), GlobalIndex.end()), GlobalIndex.end());
+	int VertexNum = (int)GlobalIndex.size();
+
+	std::vector<int> Triangles((size_t)TriangleNum * 3);
+	for (size_t i = 0; i < Triangles.size(); i++)
+	{
+		Triangles[i] = (int)(std::lower_bound(GlobalIndex.begin(), GlobalIndex.end(), IndexList[i]) - GlobalIndex.begin());
+	}
+
+	std::vector<Float3> Position(VertexNum);
+	std::vector<bool> Fixed(VertexNum, false);
+	for (int i = 0; i < VertexNum; i++)
+	{
+		Position[i] = VertexList[GlobalIndex[i]].pos;
+		if (Locked != nullptr && (*Locked)[GlobalIndex[i]])
+			Fixed[i] = true;
+	}
+
+	//Attribute seams, two vertices at the same place
+	{
+		std::vector<int> Order(VertexNum);
+		for (int i = 0; i < VertexNum; i++)
+		{
+			Order[i] = i;
+		}
+		auto Less = [&Position](int A, int B)
+		{
+			const Float3& PA = Position[A];
+			const Float3& PB = Position[B];
+			if (PA.x != PB.x) return PA.x < PB.x;
+			if (PA.y != PB.y) return PA.y < PB.y;
+			return PA.z < PB.z;
+		};
+		std::sort(Order.begin(), Order.end(), Less);
+		for (int i = 1; i < VertexNum; i++)
+		{
+			if (!Less(Order[i - 1], Order[i]))
+			{
+				Fixed[Order[i - 1]] = true;
+				Fixed[Order[i]] = true;
+			}
+		}
+	}
+
+	//Open borders, edges with one triangle
+	{
+		std::unordered_map<uint64_t, int> EdgeCount;
+		EdgeCount.reserve((size_t)TriangleNum * 3);
+		for (int t = 0; t < TriangleNum; t++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				uint64_t A = (uint64_t)Triangles[t * 3 + j];
+				uint64_t B = (uint64_t)Triangles[t * 3 + (j + 1) % 3];
+				EdgeCount[A < B ? (A << 32 | B) : (B << 32 | A)]++;
+			}
+		}
+		for (auto& Edge : EdgeCount)
+		{
+			if (Edge.second == 1)
+			{
+				Fixed[(int)(Edge.first >> 32)] = true;
+				Fixed[(int)(Edge.first & 0xffffffff)] = true;
+			}
+		}
+	}
+
+	std::vector<Quadric> Quadrics(VertexNum);
+	std::vector<std::vector<int>> VertexTriangles(VertexNum);
+	for (int t = 0; t < TriangleNum; t++)
+	{
+		const Float3& P0 = Position[Triangles[t * 3]];
+		const Float3& P1 = Position[Triangles[t * 3 + 1]];
+		const Float3& P2 = Position[Triangles[t * 3 + 2]];
+		Float3 Normal = Cross(P1 - P0, P2 - P0);
+		double Area = sqrt((double)Dot(Normal, Normal));
+		if (Area > 0.0)
+		{
+			double A = Normal.x / Area, B = Normal.y / Area, C = Normal.z / Area;
+			double D = -(A * P0.x + B * P0.y + C * P0.z);
+			for (int j = 0; j < 3; j++)
+			{
+				Quadrics[Triangles[t * 3 + j]].AddPlane(A, B, C, D, Area * 0.5);
+			}
+		}
+		for (int j = 0; j < 3; j++)
+		{
+			VertexTriangles[Triangles[t * 3 + j]].push_back(t);
+		}
+	}
+
+	std::vector<bool> TriangleAlive(TriangleNum, true);
+	std::vector<bool> VertexAlive(VertexNum, true);
+	std::vector<unsigned int> Version(VertexNum, 0);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> Heap;
+
+	//Cheaper direction of the edge, nothing if both ends are fixed
+	auto PushEdge = [&](int A, int B)
+	{
+		Quadric Sum = Quadrics[A];
+		Sum.Add(Quadrics[B]);
+
+		Collapse Candidate;
+		Candidate.Error = FLT_MAX;
+		if (!Fixed[A])
+		{
+			Candidate.Error = (float)Sum.Evaluate(Position[B]);
+			Candidate.From = A;
+			Candidate.To = B;
+		}
+		if (!Fixed[B])
+		{
+			float Error = (float)Sum.Evaluate(Position[A]);
+			if (Error < Candidate.Error)
+			{
+				Candidate.Error = Error;
+				Candidate.From = B;
+				Candidate.To = A;
+			}
+		}
+		if (Candidate.Error == FLT_MAX)
+			return;
+
+		Candidate.FromVersion = Version[Candidate.From];
+		Candidate.ToVersion = Version[Candidate.To];
+		Heap.push(Candidate);
+	};
+
+	for (int t = 0; t < TriangleNum; t++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			int A = Triangles[t * 3 + j];
+			int B = Triangles[t * 3 + (j + 1) % 3];
+			//Each interior edge shows up twice, keep one
+			if (A < B)
+				PushEdge(A, B);
+		}
+	}
+
+	size_t LiveIndexNum = (size_t)TriangleNum * 3;
+	float ResultError = 0.0f;
+	while (LiveIndexNum > TargetIndexNum && !Heap.empty())
+	{
+		Collapse Top = Heap.top();
+		Heap.pop();
+
+		if (Top.Error > MaxError)
+			break;
+		if (!VertexAlive[Top.From] || !VertexAlive[Top.To] || Version[Top.From] != Top.FromVersion || Version[Top.To] != Top.ToVersion)
+			continue;
+
+		//Moving From onto To must not flip any triangle that stays, or turn it on its edge,
+		//a cosine under 0.25 lets a few collapses in a row stand a triangle up along a border
+		bool Flipped = false;
+		for (int i = 0; i < VertexTriangles[Top.From].size() && !Flipped; i++)
+		{
+			int t = VertexTriangles[Top.From][i];
+			if (!TriangleAlive[t])
+				continue;
+
+			int* Corner = &Triangles[(size_t)t * 3];
+			if (Corner[0] == Top.To || Corner[1] == Top.To || Corner[2] == Top.To)
+				continue;
+
+			Float3 Old[3] = { Position[Corner[0]], Position[Corner[1]], Position[Corner[2]] };
+			Float3 New[3] = { Old[0], Old[1], Old[2] };
+			for (int j = 0; j < 3; j++)
+			{
+				if (Corner[j] == Top.From)
+					New[j] = Position[Top.To];
+			}
+			Float3 OldNormal = Cross(Old[1] - Old[0], Old[2] - Old[0]);
+			Float3 NewNormal = Cross(New[1] - New[0], New[2] - New[0]);
+			if (Dot(OldNormal, NewNormal) <= 0.25f * sqrtf(Dot(OldNormal, OldNormal) * Dot(NewNormal, NewNormal)))
+				Flipped = true;
+		}
+		if (Flipped)
+			continue;
+
+		for (int i = 0; i < VertexTriangles[Top.From].size(); i++)
+		{
+			int t = VertexTriangles[Top.From][i];
+			if (!TriangleAlive[t])
+				continue;
+
+			int* Corner = &Triangles[(size_t)t * 3];
+			if (Corner[0] == Top.To || Corner[1] == Top.To || Corner[2] == Top.To)
+			{
+				TriangleAlive[t] = false;
+				LiveIndexNum -= 3;
+				continue;
+			}
+			for (int j = 0; j < 3; j++)
+			{
+				if (Corner[j] == Top.From)
+					Corner[j] = Top.To;
+			}
+			VertexTriangles[Top.To].push_back(t);
+		}
+
+		VertexAlive[Top.From] = false;
+		VertexTriangles[Top.From].clear();
+		Quadrics[Top.To].Add(Quadrics[Top.From]);
+		Version[Top.From]++;
+		Version[Top.To]++;
+		ResultError = MAX(ResultError, Top.Error);
+
+		//Costs of the edges of To changed, drop dead triangles from its list on the way
+		std::vector<int>& Around = VertexTriangles[Top.To];
+		int Kept = 0;
+		for (int i = 0; i < Around.size(); i++)
+		{
+			if (TriangleAlive[Around[i]])
+				Around[Kept++] = Around[i];
+		}
+		Around.resize(Kept);
+		for (int i = 0; i < Around.size(); i++)
+		{
+			int t = Around[i];
+			for (int j = 0; j < 3; j++)
+			{
+				int A = Triangles[(size_t)t * 3 + j];
+				int B = Triangles[(size_t)t * 3 + (j + 1) % 3];
+				if (A == Top.To || B == Top.To)
+					PushEdge(A, B);
+			}
+		}
+	}
+
+	size_t Written = 0;
+	for (int t = 0; t < TriangleNum; t++)
+	{
+		if (!TriangleAlive[t])
+			continue;
+
+		for (int j = 0; j < 3; j++)
+		{
+			Dst[Written++] = GlobalIndex[Triangles[(size_t)t * 3 + j]];
+		}
+	}
+
+	if (OutError != nullptr)
+		*OutError = ResultError;
+	return Written;
+}
+
+
+
+static inline uint32_t SpreadBits10(uint32_t Value)
+{
+	Value &= 0x3ff;
+	Value = (Value | (Value << 16)) & 0x030000ff;
+	Value = (Value | (Value << 8)) & 0x0300f00f;
+	Value = (Value | (Value << 4)) & 0x030c30c3;
+	Value = (Value | (Value << 2)) & 0x09249249;
+	return Value;
+}
+
+
+LodBuilder::LodBuilder(SourceContext* InContext, const LodOptions& InOptions) :
+	Context(InContext),
+	Options(InOptions),
+	RemainingPartitions(0)
+{
+	PartitionOffset.push_back(0);
+	if (Context == nullptr || Context->DrawIndexList == nullptr || Context->DrawVertexList == nullptr)
+		return;
+
+	int TriangleNum = Context->GetTriangleNum();
+	int VertexNum = Context->GetVertexNum();
+	if (TriangleNum <= 0 || Options.LodNum <= 0)
+		return;
+
+	int PartitionSize = MAX(Options.PartitionTriangleNum, 1);
+	if (TriangleNum <= PartitionSize)
+	{
+		SortedIndexList.assign(Context->DrawIndexList, Context->DrawIndexList + (size_t)TriangleNum * 3);
+		PartitionOffset.push_back(TriangleNum);
+	}
+	else
+	{
+		//Morton order of the triangle centers keeps every partition compact
+		//Unreferenced vertices only loosen the box, the order stays valid
+		BoundingBox Box = CalculateBounding(Context->DrawVertexList, VertexNum);
+		Float3 Size = Box.Max - Box.Min;
+
+		std::vector<std::pair<uint32_t, int>> Codes(TriangleNum);
+		for (int t = 0; t < TriangleNum; t++)
+		{
+			Float3 Center = (Context->DrawVertexList[Context->DrawIndexList[t * 3]].pos
+				+ Context->DrawVertexList[Context->DrawIndexList[t * 3 + 1]].pos
+				+ Context->DrawVertexList[Context->DrawIndexList[t * 3 + 2]].pos) / 3.0;
+			uint32_t Cell[3];
+			for (int j = 0; j < 3; j++)
+			{
+				float Unit = Size[j] > 0.0f ? (Center[j] - Box.Min[j]) / Size[j] : 0.0f;
+				Cell[j] = (uint32_t)MIN(MAX(Unit * 1023.0f, 0.0f), 1023.0f);
+			}
+			Codes[t] = std::make_pair(SpreadBits10(Cell[0]) | SpreadBits10(Cell[1]) << 1 | SpreadBits10(Cell[2]) << 2, t);
+		}
+		std::sort(Codes.begin(), Codes.end());
+
+		SortedIndexList.resize((size_t)TriangleNum * 3);
+		for (int t = 0; t < TriangleNum; t++)
+		{
+			memcpy(&SortedIndexList[(size_t)t * 3], &Context->DrawIndexList[(size_t)Codes[t].second * 3], sizeof(DrawRawIndex) * 3);
+		}
+
+		for (int Begin = PartitionSize; Begin < TriangleNum; Begin += PartitionSize)
+		{
+			PartitionOffset.push_back(Begin);
+		}
+		PartitionOffset.push_back(TriangleNum);
+
+		//Vertices used by more than one partition
+		std::vector<int> Owner(VertexNum, -1);
+		SharedVertex.assign(VertexNum, false);
+		for (int p = 0; p < GetPartitionNum(); p++)
+		{
+			for (size_t i = (size_t)PartitionOffset[p] * 3; i < (size_t)PartitionOffset[p + 1] * 3; i++)
+			{
+				DrawRawIndex Vertex = SortedIndexList[i];
+				if (Owner[Vertex] < 0)
+					Owner[Vertex] = p;
+				else if (Owner[Vertex] != p)
+					SharedVertex[Vertex] = true;
+			}
+		}
+	}
+
+	PartitionResult.resize(GetPartitionNum());
+	PartitionError.assign(GetPartitionNum(), 0.0f);
+	RemainingPartitions.store(GetPartitionNum());
+}
+
+
+int LodBuilder::GetTargetTriangleNum(int Lod, int PrevTriangleNum) const
+{
+	if (Lod < Options.TargetTriangleNum.size())
+		return Options.TargetTriangleNum[Lod];
+	return (int)(PrevTriangleNum * Options.Ratio);
+}
+
+
+void LodBuilder::SimplifyPartition(int Partition)
+{
+	size_t Begin = (size_t)PartitionOffset[Partition] * 3;
+	size_t IndexNum = (size_t)PartitionOffset[Partition + 1] * 3 - Begin;
+
+	//Every partition gets its share of the first level
+	int TriangleNum = Context->GetTriangleNum();
+	int Target = GetTargetTriangleNum(0, TriangleNum);
+	size_t TargetIndexNum = (size_t)((double)IndexNum * Target / MAX(TriangleNum, 1)) / 3 * 3;
+
+	std::vector<DrawRawIndex>& Result = PartitionResult[Partition];
+	Result.resize(IndexNum);
+	Result.resize(SimplifyMesh(Result.data(), SortedIndexList.data() + Begin, IndexNum, Context->DrawVertexList,
+		TargetIndexNum, Options.MaxError, &PartitionError[Partition], SharedVertex.empty() ? nullptr : &SharedVertex));
+}
+
+
+void LodBuilder::Finish()
+{
+	Context->LodList.clear();
+	if (GetPartitionNum() == 0)
+		return;
+
+	int SourceTriangleNum = Context->GetTriangleNum();
+
+	SourceLod First;
+	for (int p = 0; p < GetPartitionNum(); p++)
+	{
+		First.IndexList.insert(First.IndexList.end(), PartitionResult[p].begin(), PartitionResult[p].end());
+		First.Error = MAX(First.Error, PartitionError[p]);
+	}
+	PartitionResult.clear();
+	SortedIndexList.clear();
+	SortedIndexList.shrink_to_fit();
+
+	//Partition borders were held, give them a pass now that the mesh is smaller
+	int Target = GetTargetTriangleNum(0, SourceTriangleNum);
+	if (GetPartitionNum() > 1 && First.IndexList.size() > (size_t)Target * 3)
+	{
+		float Error = 0.0f;
+		std::vector<DrawRawIndex> Reduced(First.IndexList.size());
+		Reduced.resize(SimplifyMesh(Reduced.data(), First.IndexList.data(), First.IndexList.size(), Context->DrawVertexList,
+			(size_t)Target * 3, Options.MaxError, &Error));
+		First.IndexList.swap(Reduced);
+		First.Error = MAX(First.Error, Error);
+	}
+	if (First.IndexList.size() >= (size_t)SourceTriangleNum * 3)
+		return;
+	Context->LodList.push_back(std::move(First));
+
+	for (int Lod = 1; Lod < Options.LodNum; Lod++)
+	{
+		const SourceLod& Prev = Context->LodList.back();
+		int PrevTriangleNum = (int)(Prev.IndexList.size() / 3);
+		if (PrevTriangleNum <= Options.MinTriangleNum || Prev.Error >= Options.MaxError)
+			break;
+
+		Target = MAX(GetTargetTriangleNum(Lod, PrevTriangleNum), Options.MinTriangleNum);
+
+		//Errors of chained levels add up
+		SourceLod Next;
+		float Error = 0.0f;
+		Next.IndexList.resize(Prev.IndexList.size());
+		Next.IndexList.resize(SimplifyMesh(Next.IndexList.data(), Prev.IndexList.data(), Prev.IndexList.size(), Context->DrawVertexList,
+			(size_t)Target * 3, Options.MaxError - Prev.Error, &Error));
+		Next.Error = Prev.Error + Error;
+
+		//Stuck, everything left is locked
+		if (Next.IndexList.size() >= Prev.IndexList.size())
+			break;
+		Context->LodList.push_back(std::move(Next));
+	}
+}
+
+
+void BuildLodChain(SourceContext* Context, const LodOptions& Options)
+{
+	LodBuilder Builder(Context, Options);
+	for (int i = 0; i < Builder.GetPartitionNum(); i++)
+	{
+		Builder.SimplifyPartition(i);
+	}
+	Builder.Finish();
+}
+
+
+//Level number, then error, index number and indices of every level
+static void WriteLodList(const std::vector<SourceLod>& LodList, std::vector<Byte>& OutData)
+{
+	ByteWriter Writer(OutData);
+	Writer.WriteUint32((std::uint32_t)LodList.size());
+	for (int i = 0; i < LodList.size(); i++)
+	{
+		Writer.WriteFloat(LodList[i].Error);
+		Writer.WriteUint64((std::uint64_t)LodList[i].IndexList.size());
+		Writer.WriteArray(LodList[i].IndexList);
+	}
+}
+
+
+static bool ReadLodList(SourceContext* Context, const std::vector<Byte>& InData)
+{
+	ByteReader Reader(InData);
+	size_t LevelNum = Reader.ReadUint32();
+	//A level takes at least 12 bytes, don't trust a count the data can't hold
+	if (LevelNum > Reader.GetRemaining() / 12)
+		return false;
+
+	std::vector<SourceLod> LodList(LevelNum);
+	for (int i = 0; i < LodList.size(); i++)
+	{
+		LodList[i].Error = Reader.ReadFloat();
+		Reader.ReadArray(LodList[i].IndexList, (size_t)Reader.ReadUint64());
+	}
+	if (!Reader.IsOk() || Reader.GetRemaining() != 0)
+		return false;
+
+	Context->LodList.swap(LodList);
+	return true;
+}
+
+
+static void PrintLodChain(SourceContext* Context, const char* Suffix)
+{
+	std::string Line = "Lod : " + Context->Name + " " + std::to_string(Context->GetTriangleNum());
+	for (int i = 0; i < Context->LodList.size(); i++)
+	{
+		char Level[64];
+		snprintf(Level, sizeof(Level), " -> %d (%.4g)", (int)(Context->LodList[i].IndexList.size() / 3), Context->LodList[i].Error);
+		Line += Level;
+	}
+	Line += Suffix;
+	LockGuard<PlatformCriticalSection> Lock(PrintLock);
+	std::cout << Line << std::endl;
+}
+
+
+//Bump the tag whenever the result of the pass changes
+static size_t GetLodParamHash(const LodOptions& Options)
+{
+	size_t Hash = HashBytes("Lod2", 4);
+	Hash = HashCombine2(Hash, (size_t)Options.LodNum);
+	Hash = HashBytes(&Options.Ratio, sizeof(float), Hash);
+	Hash = HashCombine2(Hash, Options.TargetTriangleNum.size());
+	Hash = HashBytes(Options.TargetTriangleNum.data(), Options.TargetTriangleNum.size() * sizeof(int), Hash);
+	Hash = HashCombine2(Hash, (size_t)Options.MinTriangleNum);
+	Hash = HashBytes(&Options.MaxError, sizeof(float), Hash);
+	Hash = HashCombine2(Hash, (size_t)Options.PartitionTriangleNum);
+	return HashFinalize(Hash);
+}
+
+
+PassType MakeLodPass(const LodOptions& Options)
+{
+	return [Options](Processer* InProcesser, std::string& State) -> bool
+	{
+		State = "Building LODs";
+
+		std::vector<SourceContext*> Contexts;
+		std::vector<ResultKey> ContextKeys;
+		InProcesser->FindUncachedContexts(GetLodParamHash(Options), [](SourceContext* Context, const std::vector<Byte>& Data)
+			{
+				if (!ReadLodList(Context, Data))
+					return false;
+				PrintLodChain(Context, " cached");
+				return true;
+			}, Contexts, ContextKeys);
+
+		std::shared_ptr<std::vector<std::unique_ptr<LodBuilder>>> Builders = std::make_shared<std::vector<std::unique_ptr<LodBuilder>>>();
+		//Result cache key of every builder
+		std::vector<ResultKey> Keys;
+		//First partition of every builder, plus the total at the end
+		std::vector<int> PartitionOffset(1, 0);
+
+		for (int i = 0; i < Contexts.size(); i++)
+		{
+			std::unique_ptr<LodBuilder> Builder(new LodBuilder(Contexts[i], Options));
+			if (Builder->GetPartitionNum() == 0)
+			{
+				Contexts[i]->LodList.clear();
+				continue;
+			}
+
+			PartitionOffset.push_back(PartitionOffset.back() + Builder->GetPartitionNum());
+			Builders->push_back(std::move(Builder));
+			Keys.push_back(ContextKeys[i]);
+		}
+
+		return InProcesser->KickRange(PartitionOffset.back(), [InProcesser, Builders, Keys, PartitionOffset](int Begin, int End)
+			{
+				for (int Partition = Begin; Partition < End; Partition++)
+				{
+					int Index = (int)(std::upper_bound(PartitionOffset.begin(), PartitionOffset.end(), Partition) - PartitionOffset.begin()) - 1;
+					LodBuilder* Builder = (*Builders)[Index].get();
+
+					Builder->SimplifyPartition(Partition - PartitionOffset[Index]);
+					if (!Builder->FinishPartition())
+						continue;
+
+					Builder->Finish();
+
+					SourceContext* Context = Builder->GetContext();
+					if (Keys[Index].IsValid())
+					{
+						std::vector<Byte> Data;
+						WriteLodList(Context->LodList, Data);
+						InProcesser->StorePassResult(Keys[Index], Data);
+					}
+					PrintLodChain(Context, "");
+				}
+			}, 1);
+	};
+}
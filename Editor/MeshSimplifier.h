@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cfloat>
+
+#include "Utils.h"
+#include "Processer.h"
+
+
+/*
+* Quadric error edge collapse, vertices only ever collapse onto an existing neighbour,
+* so every level keeps indexing the source vertex list.
+* Vertices in Locked, on open borders and on attribute seams never move.
+* Stops at TargetIndexNum or once the next collapse costs more than MaxError.
+* Return the index number written to Dst, OutError gets the largest error of the collapses done.
+*/
+size_t SimplifyMesh(DrawRawIndex* Dst, const DrawRawIndex* IndexList, size_t IndexNum, const DrawRawVertex* VertexList,
+	size_t TargetIndexNum, float MaxError = FLT_MAX, float* OutError = nullptr, const std::vector<bool>* Locked = nullptr);
+
+
+struct LodOptions
+{
+	LodOptions() :
+		LodNum(4),
+		Ratio(0.5f),
+		MinTriangleNum(64),
+		MaxError(FLT_MAX),
+		PartitionTriangleNum(65536)
+	{}
+
+	int LodNum;
+	//Triangles of a level over the level before it
+	float Ratio;
+	//Triangle number per level, overrides Ratio when set
+	std::vector<int> TargetTriangleNum;
+	//The chain stops at the first level that can't get below this
+	int MinTriangleNum;
+	//Per level, the chain stops when a level reaches it
+	float MaxError;
+	//Meshes above this are cut into pieces that are reduced on their own for the first level
+	int PartitionTriangleNum;
+};
+
+
+/*
+* Builds the LOD chain of one context.
+* The first level is reduced per partition, pieces are cut along a Morton curve and vertices
+* shared by two pieces stay put, then the whole mesh is reduced once more to the level target.
+* Later levels are small and are reduced in one go.
+*/
+class LodBuilder
+{
+public:
+	LodBuilder(SourceContext* InContext, const LodOptions& InOptions);
+
+	int GetPartitionNum() const
+	{
+		return (int)PartitionOffset.size() - 1;
+	}
+
+	/****Call in Any Thread****/
+	void SimplifyPartition(int Partition);
+	//True for the caller that finished the last partition
+	bool FinishPartition()
+	{
+		return RemainingPartitions.fetch_sub(1) == 1;
+	}
+
+	/****Call once every partition is done****/
+	//Fill Context->LodList
+	void Finish();
+
+	SourceContext* GetContext()
+	{
+		return Context;
+	}
+
+private:
+	int GetTargetTriangleNum(int Lod, int PrevTriangleNum) const;
+
+private:
+	SourceContext* Context;
+	LodOptions Options;
+
+	//Triangles of the source in Morton order, partitions are runs of it
+	std::vector<DrawRawIndex> SortedIndexList;
+	std::vector<int> PartitionOffset;
+	std::vector<bool> SharedVertex;
+	std::vector<std::vector<DrawRawIndex>> PartitionResult;
+	std::vector<float> PartitionError;
+	std::atomic<int> RemainingPartitions;
+};
+
+
+//Synchronous LOD chain of one context
+void BuildLodChain(SourceContext* Context, const LodOptions& Options = LodOptions());
+
+/*
+* Pass that builds the LOD chain of every dirty context.
+* Partitions of all contexts go through the lane together, the thread finishing
+* the last partition of a context builds the rest of its chain.
+*/
+PassType MakeLodPass(const LodOptions& Options = LodOptions());
@@ -0,0 +1,401 @@
+#include "MeshletBuilder.h"
+#include "ByteStream.h"
+
+#include <cstdio>
+#include <climits>
+
+
+using namespace std;
+
+#define LINE_STRING "================================"
+#define MESHLET_MAGIC 0x4C48534D
+#define MESHLET_VERSION 1
+
+static PlatformCriticalSection PrintLock;
+
+
+//Sphere and normal cone of a finished meshlet
+static void ComputeBounds(Meshlet& Cluster, const MeshletData& Data, const DrawRawVertex* VertexList)
+{
+	const DrawRawIndex* Vertices = Data.VertexList.data() + Cluster.VertexOffset;
+	const std::uint8_t* Triangles = Data.TriangleList.data() + (size_t)Cluster.TriangleOffset * 3;
+
+	Float3 Min = VertexList[Vertices[0]].pos;
+	Float3 Max = Min;
+	for (int i = 1; i < Cluster.VertexNum; i++)
+	{
+		const Float3& P = VertexList[Vertices[i]].pos;
+		Min = Float3(MIN(Min.x, P.x), MIN(Min.y, P.y), MIN(Min.z, P.z));
+		Max = Float3(MAX(Max.x, P.x), MAX(Max.y, P.y), MAX(Max.z, P.z));
+	}
+	Cluster.Center = (Min + Max) * 0.5;
+	Cluster.Radius = 0.0f;
+	for (int i = 0; i < Cluster.VertexNum; i++)
+	{
+		Float3 Delta = VertexList[Vertices[i]].pos - Cluster.Center;
+		Cluster.Radius = MAX(Cluster.Radius, sqrtf(Dot(Delta, Delta)));
+	}
+
+	std::vector<Float3> Normals;
+	Normals.reserve(Cluster.TriangleNum);
+	Float3 Sum(0.0f);
+	for (int t = 0; t < Cluster.TriangleNum; t++)
+	{
+		const Float3& P0 = VertexList[Vertices[Triangles[t * 3]]].pos;
+		const Float3& P1 = VertexList[Vertices[Triangles[t * 3 + 1]]].pos;
+		const Float3& P2 = VertexList[Vertices[Triangles[t * 3 + 2]]].pos;
+		Float3 Normal = Cross(P1 - P0, P2 - P0);
+		float Length = sqrtf(Dot(Normal, Normal));
+		if (!(Length > 0.0f))
+			continue;
+
+		Normal = Normal / Length;
+		Normals.push_back(Normal);
+		Sum = Sum + Normal;
+	}
+
+	Cluster.ConeAxis = Float3(0.0f, 0.0f, 1.0f);
+	Cluster.ConeCutoff = 1.0f;
+	float SumLength = sqrtf(Dot(Sum, Sum));
+	if (Normals.empty() || !(SumLength > 0.0f))
+		return;
+
+	Cluster.ConeAxis = Sum / SumLength;
+	float MinDot = 1.0f;
+	for (int i = 0; i < Normals.size(); i++)
+	{
+		MinDot = MIN(MinDot, Dot(Normals[i], Cluster.ConeAxis));
+	}
+
+	//Normals spread over more than a half sphere can never all face away
+	if (MinDot <= 0.1f)
+		return;
+	Cluster.ConeCutoff = sqrtf(1.0f - MinDot * MinDot);
+}
+
+
+bool BuildMeshlets(SourceContext* Context, MeshletData& OutData, const MeshletOptions& Options)
+{
+	OutData.Clear();
+	if (Context == nullptr || Context->DrawIndexList == nullptr || Context->DrawVertexList == nullptr)
+		return false;
+
+	int MaxVertexNum = MIN(MAX(Options.MaxVertexNum, 3), 256);
+	int MaxTriangleNum = MAX(Options.MaxTriangleNum, 1);
+	int TriangleNum = Context->GetTriangleNum();
+	int VertexNum = Context->GetVertexNum();
+	const DrawRawIndex* IndexList = Context->DrawIndexList;
+	if (TriangleNum <= 0 || VertexNum <= 0)
+		return true;
+
+	//Triangles around every vertex, and how many of them are still free
+	std::vector<int> LiveNum(VertexNum, 0);
+	for (size_t i = 0; i < (size_t)TriangleNum * 3; i++)
+	{
+		LiveNum[IndexList[i]]++;
+	}
+	std::vector<int> AdjacencyOffset(size_t(VertexNum) + 1, 0);
+	for (int i = 0; i < VertexNum; i++)
+	{
+		AdjacencyOffset[i + 1] = AdjacencyOffset[i] + LiveNum[i];
+	}
+	std::vector<int> Adjacency(AdjacencyOffset[VertexNum]);
+	{
+		std::vector<int> Cursor(AdjacencyOffset.begin(), AdjacencyOffset.end() - 1);
+		for (int t = 0; t < TriangleNum; t++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				Adjacency[Cursor[IndexList[t * 3 + j]]++] = t;
+			}
+		}
+	}
+
+	std::vector<bool> Emitted(TriangleNum, false);
+	//Local index of a vertex in the current meshlet, valid while its stamp is the meshlet index
+	std::vector<std::uint8_t> LocalIndex(VertexNum, 0);
+	std::vector<int> Stamp(VertexNum, -1);
+	std::vector<int> Candidates;
+
+	Meshlet Current;
+	int Cursor = 0;
+	int EmittedNum = 0;
+	while (EmittedNum < TriangleNum)
+	{
+		int MeshletIndex = (int)OutData.Meshlets.size();
+
+		//Best free triangle next to the meshlet, fewest new vertices then fewest free neighbours
+		int Best = -1;
+		int BestNewNum = 4;
+		int BestLive = INT_MAX;
+		int Kept = 0;
+		for (int i = 0; i < Candidates.size(); i++)
+		{
+			int t = Candidates[i];
+			if (Emitted[t])
+				continue;
+			Candidates[Kept++] = t;
+
+			int NewNum = 0;
+			int Live = 0;
+			for (int j = 0; j < 3; j++)
+			{
+				DrawRawIndex Vertex = IndexList[t * 3 + j];
+				if (Stamp[Vertex] != MeshletIndex)
+					NewNum++;
+				Live += LiveNum[Vertex];
+			}
+			if (NewNum < BestNewNum || (NewNum == BestNewNum && Live < BestLive))
+			{
+				Best = t;
+				BestNewNum = NewNum;
+				BestLive = Live;
+			}
+		}
+		Candidates.resize(Kept);
+
+		//Disconnected, continue in index order
+		if (Best < 0)
+		{
+			while (Emitted[Cursor])
+			{
+				Cursor++;
+			}
+			Best = Cursor;
+			BestNewNum = 0;
+			for (int j = 0; j < 3; j++)
+			{
+				if (Stamp[IndexList[Best * 3 + j]] != MeshletIndex)
+					BestNewNum++;
+			}
+		}
+
+		//Full, close it and look again from an empty meshlet
+		if (Current.VertexNum + BestNewNum > MaxVertexNum || Current.TriangleNum + 1 > MaxTriangleNum)
+		{
+			ComputeBounds(Current, OutData, Context->DrawVertexList);
+			OutData.Meshlets.push_back(Current);
+
+			Current = Meshlet();
+			Current.VertexOffset = (std::uint32_t)OutData.VertexList.size();
+			Current.TriangleOffset = (std::uint32_t)(OutData.TriangleList.size() / 3);
+			Candidates.clear();
+			continue;
+		}
+
+		for (int j = 0; j < 3; j++)
+		{
+			DrawRawIndex Vertex = IndexList[Best * 3 + j];
+			if (Stamp[Vertex] != MeshletIndex)
+			{
+				Stamp[Vertex] = MeshletIndex;
+				LocalIndex[Vertex] = (std::uint8_t)Current.VertexNum;
+				OutData.VertexList.push_back(Vertex);
+				Current.VertexNum++;
+
+				for (int a = AdjacencyOffset[Vertex]; a < AdjacencyOffset[Vertex + 1]; a++)
+				{
+					if (!Emitted[Adjacency[a]])
+						Candidates.push_back(Adjacency[a]);
+				}
+			}
+			OutData.TriangleList.push_back(LocalIndex[Vertex]);
+			LiveNum[Vertex]--;
+		}
+		Current.TriangleNum++;
+		Emitted[Best] = true;
+		EmittedNum++;
+	}
+
+	if (Current.TriangleNum > 0)
+	{
+		ComputeBounds(Current, OutData, Context->DrawVertexList);
+		OutData.Meshlets.push_back(Current);
+	}
+
+	return true;
+}
+
+
+MeshletStats GetMeshletStats(const MeshletData& Data, SourceContext* Context)
+{
+	MeshletStats Stats;
+	Stats.MeshletNum = Data.Meshlets.size();
+	for (int i = 0; i < Data.Meshlets.size(); i++)
+	{
+		const Meshlet& Cluster = Data.Meshlets[i];
+		Stats.VertexNum += Cluster.VertexNum;
+		Stats.TriangleNum += Cluster.TriangleNum;
+		Stats.RadiusSum += Cluster.Radius;
+		if (Cluster.ConeCutoff < 1.0f)
+		{
+			Stats.CullableNum++;
+			Stats.ConeAngleSum += asin((double)Cluster.ConeCutoff);
+		}
+	}
+
+	if (Context != nullptr && Context->GetVertexNum() > 0)
+	{
+		std::vector<bool> Referenced(Context->GetVertexNum(), false);
+		for (int i = 0; i < Data.VertexList.size(); i++)
+		{
+			if (!Referenced[Data.VertexList[i]])
+			{
+				Referenced[Data.VertexList[i]] = true;
+				Stats.SourceVertexNum++;
+			}
+		}
+	}
+
+	return Stats;
+}
+
+
+void MeshletStats::Print(const std::string& Name, const MeshletOptions& Options) const
+{
+	double Num = MAX((double)MeshletNum, 1.0);
+
+	char Line[256];
+	std::cout << LINE_STRING << std::endl;
+	std::cout << "Meshlets : " << Name << std::endl;
+	snprintf(Line, sizeof(Line), "Count : %zu, Triangles : %zu", MeshletNum, TriangleNum);
+	std::cout << Line << std::endl;
+	snprintf(Line, sizeof(Line), "Vertex Fill : %.1f / %d, Triangle Fill : %.1f / %d",
+		VertexNum / Num, Options.MaxVertexNum, TriangleNum / Num, Options.MaxTriangleNum);
+	std::cout << Line << std::endl;
+	snprintf(Line, sizeof(Line), "Vertex Duplication : %.3f", SourceVertexNum > 0 ? double(VertexNum) / double(SourceVertexNum) : 0.0);
+	std::cout << Line << std::endl;
+	snprintf(Line, sizeof(Line), "Cullable Cones : %.1f%%, Average Cone : %.1f deg, Average Radius : %.4g",
+		100.0 * CullableNum / Num, CullableNum > 0 ? ConeAngleSum / CullableNum * 57.29578 : 0.0, RadiusSum / Num);
+	std::cout << Line << std::endl;
+	std::cout << LINE_STRING << std::endl;
+}
+
+
+bool MeshletData::Serialize(std::vector<Byte>& OutData) const
+{
+	OutData.clear();
+	ByteWriter Writer(OutData);
+	Writer.Reserve(4 * 5 + Meshlets.size() * sizeof(Meshlet) + VertexList.size() * 4 + TriangleList.size());
+
+	Writer.WriteUint32(MESHLET_MAGIC);
+	Writer.WriteUint32(MESHLET_VERSION);
+	Writer.WriteUint32((uint)Meshlets.size());
+	Writer.WriteUint32((uint)VertexList.size());
+	Writer.WriteUint32((uint)TriangleList.size());
+
+	for (int i = 0; i < Meshlets.size(); i++)
+	{
+		const Meshlet& Cluster = Meshlets[i];
+		Writer.WriteUint32(Cluster.VertexOffset);
+		Writer.WriteUint32(Cluster.TriangleOffset);
+		Writer.WriteUint32(Cluster.VertexNum);
+		Writer.WriteUint32(Cluster.TriangleNum);
+		Writer.WriteArray(&Cluster.Center.x, 3);
+		Writer.WriteFloat(Cluster.Radius);
+		Writer.WriteArray(&Cluster.ConeAxis.x, 3);
+		Writer.WriteFloat(Cluster.ConeCutoff);
+	}
+	Writer.WriteArray(VertexList);
+	Writer.WriteArray(TriangleList);
+
+	return true;
+}
+
+bool MeshletData::Deserialize(const std::vector<Byte>& InData)
+{
+	Clear();
+	ByteReader Reader(InData);
+
+	std::uint32_t Magic = Reader.ReadUint32();
+	std::uint32_t Version = Reader.ReadUint32();
+	if (!Reader.IsOk() || Magic != MESHLET_MAGIC || Version != MESHLET_VERSION)
+	{
+		std::cout << "Meshlet data: unknown format" << std::endl;
+		return false;
+	}
+
+	size_t MeshletNum = Reader.ReadUint32();
+	size_t VertexNum = Reader.ReadUint32();
+	size_t TriangleIndexNum = Reader.ReadUint32();
+	if (!Reader.IsOk() || Reader.GetRemaining() != MeshletNum * sizeof(Meshlet) + VertexNum * 4 + TriangleIndexNum)
+	{
+		std::cout << "Meshlet data: size mismatch" << std::endl;
+		return false;
+	}
+
+	Meshlets.resize(MeshletNum);
+	for (int i = 0; i < MeshletNum; i++)
+	{
+		Meshlet& Cluster = Meshlets[i];
+		Cluster.VertexOffset = Reader.ReadUint32();
+		Cluster.TriangleOffset = Reader.ReadUint32();
+		Cluster.VertexNum = Reader.ReadUint32();
+		Cluster.TriangleNum = Reader.ReadUint32();
+		Reader.ReadArray(&Cluster.Center.x, 3);
+		Cluster.Radius = Reader.ReadFloat();
+		Reader.ReadArray(&Cluster.ConeAxis.x, 3);
+		Cluster.ConeCutoff = Reader.ReadFloat();
+	}
+	Reader.ReadArray(VertexList, VertexNum);
+	Reader.ReadArray(TriangleList, TriangleIndexNum);
+
+	return Reader.IsOk();
+}
+
+
+//Bump the tag whenever the result of the pass changes
+static size_t GetMeshletParamHash(const MeshletOptions& Options)
+{
+	size_t Hash = HashBytes("Meshlet1", 8);
+	Hash = HashCombine2(Hash, (size_t)Options.MaxVertexNum);
+	Hash = HashCombine2(Hash, (size_t)Options.MaxTriangleNum);
+	return HashFinalize(Hash);
+}
+
+
+PassType MakeMeshletPass(const MeshletOptions& Options, MeshletStats* Total)
+{
+	return [Options, Total](Processer* InProcesser, std::string& State) -> bool
+	{
+		State = "Building Meshlets";
+
+		std::vector<SourceContext*> Contexts;
+		std::vector<ResultKey> Keys;
+		InProcesser->FindUncachedContexts(GetMeshletParamHash(Options), [Options, Total](SourceContext* Context, const std::vector<Byte>& Data)
+			{
+				std::shared_ptr<MeshletData> Cached = std::make_shared<MeshletData>();
+				if (!Cached->Deserialize(Data))
+					return false;
+				Context->Meshlets = Cached;
+
+				MeshletStats Stats = GetMeshletStats(*Cached, Context);
+				LockGuard<PlatformCriticalSection> Lock(PrintLock);
+				if (Total != nullptr)
+					Total->Add(Stats);
+				Stats.Print(Context->Name + " cached", Options);
+				return true;
+			}, Contexts, Keys);
+
+		return InProcesser->KickContexts(std::move(Contexts), [InProcesser, Keys = std::move(Keys), Options, Total](SourceContext* Context, int i)
+			{
+				std::shared_ptr<MeshletData> Data = std::make_shared<MeshletData>();
+				if (!BuildMeshlets(Context, *Data, Options))
+				{
+					Context->Meshlets.reset();
+					return;
+				}
+				Context->Meshlets = Data;
+
+				std::vector<Byte> Output;
+				if (Keys[i].IsValid() && Data->Serialize(Output))
+					InProcesser->StorePassResult(Keys[i], Output);
+
+				MeshletStats Stats = GetMeshletStats(*Data, Context);
+				LockGuard<PlatformCriticalSection> Lock(PrintLock);
+				if (Total != nullptr)
+					Total->Add(Stats);
+				Stats.Print(Context->Name, Options);
+			}, 1);
+	};
+}
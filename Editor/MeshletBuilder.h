@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vector>
+
+#include "Utils.h"
+#include "Processer.h"
+
+
+/*
+* One cluster, 48 bytes.
+* Cull the whole cluster when
+* dot(normalize(Center - CameraPosition), ConeAxis) >= ConeCutoff + Radius / length(Center - CameraPosition)
+*/
+struct Meshlet
+{
+	Meshlet() :
+		VertexOffset(0), TriangleOffset(0), VertexNum(0), TriangleNum(0),
+		Center(0.0f), Radius(0.0f), ConeAxis(0.0f, 0.0f, 1.0f), ConeCutoff(1.0f)
+	{}
+
+	//Into MeshletData::VertexList
+	std::uint32_t VertexOffset;
+	//Into MeshletData::TriangleList, in triangles
+	std::uint32_t TriangleOffset;
+	std::uint32_t VertexNum;
+	std::uint32_t TriangleNum;
+
+	Float3 Center;
+	float Radius;
+	Float3 ConeAxis;
+	//Sine of the normal spread, 1 means the cone can't cull
+	float ConeCutoff;
+};
+static_assert(sizeof(Meshlet) == 48, "Meshlet layout changed");
+
+
+/*
+* Meshlets of one context in three flat arrays, ready to upload as they are
+*/
+struct MeshletData
+{
+	std::vector<Meshlet> Meshlets;
+	//Global vertex index of every meshlet vertex
+	std::vector<DrawRawIndex> VertexList;
+	//3 local vertex indices per triangle
+	std::vector<std::uint8_t> TriangleList;
+
+	void Clear()
+	{
+		Meshlets.clear();
+		VertexList.clear();
+		TriangleList.clear();
+	}
+
+	bool Serialize(std::vector<Byte>& OutData) const;
+	bool Deserialize(const std::vector<Byte>& InData);
+};
+
+
+struct MeshletOptions
+{
+	MeshletOptions() :
+		MaxVertexNum(64),
+		MaxTriangleNum(124)
+	{}
+
+	//At most 256, local indices are a byte
+	int MaxVertexNum;
+	int MaxTriangleNum;
+};
+
+
+struct MeshletStats
+{
+	MeshletStats() :
+		MeshletNum(0),
+		VertexNum(0),
+		TriangleNum(0),
+		SourceVertexNum(0),
+		CullableNum(0),
+		RadiusSum(0.0),
+		ConeAngleSum(0.0)
+	{}
+
+	void Add(const MeshletStats& Other)
+	{
+		MeshletNum += Other.MeshletNum;
+		VertexNum += Other.VertexNum;
+		TriangleNum += Other.TriangleNum;
+		SourceVertexNum += Other.SourceVertexNum;
+		CullableNum += Other.CullableNum;
+		RadiusSum += Other.RadiusSum;
+		ConeAngleSum += Other.ConeAngleSum;
+	}
+	void Print(const std::string& Name, const MeshletOptions& Options) const;
+
+	size_t MeshletNum;
+	//Summed over meshlets, vertices on meshlet borders count once per meshlet
+	size_t VertexNum;
+	size_t TriangleNum;
+	//Distinct vertices referenced by the source
+	size_t SourceVertexNum;
+	//Meshlets whose cone can cull them
+	size_t CullableNum;
+	double RadiusSum;
+	//Half angle in radians, cullable meshlets only
+	double ConeAngleSum;
+};
+
+
+/*
+* Greedy clustering, a meshlet grows through the triangles next to its vertices,
+* preferring ones that add no vertex, then ones that finish off a vertex.
+* Run the vertex cache pass first, a disconnected meshlet continues in index order.
+*/
+bool BuildMeshlets(SourceContext* Context, MeshletData& OutData, const MeshletOptions& Options = MeshletOptions());
+
+MeshletStats GetMeshletStats(const MeshletData& Data, SourceContext* Context);
+
+/*
+* Pass that builds Context->Meshlets for every dirty context in parallel and prints their stats.
+* Summed into Total if given, Total must outlive the pass.
+*/
+PassType MakeMeshletPass(const MeshletOptions& Options = MeshletOptions(), MeshletStats* Total = nullptr);
@@ -0,0 +1,134 @@
+#include "NormalLines.h"
+#include "VectorMath.h"
+
+#include <algorithm>
+
+
+using namespace std;
+
+
+
+int GetNormalLineVertexNum(SourceContext* Context, NormalLineType Type)
+{
+	if (Context == nullptr)
+		return 0;
+
+	int PrimitiveNum = Type == NormalLineType::Face ? Context->GetTriangleNum() : Context->GetVertexNum();
+	return MAX(PrimitiveNum, 0) * 2;
+}
+
+
+float GetNormalLineLength(const BoundingBox& Bounding, float Scale)
+{
+	return Length(Bounding.HalfLength) * 2.0f * Scale;
+}
+
+
+void BuildNormalLines(SourceContext* Context, NormalLineType Type, float Length, DrawRawVertex* Dst, int Begin, int End)
+{
+	const DrawRawVertex* VertexList = Context->DrawVertexList;
+	const DrawRawIndex* IndexList = Context->DrawIndexList;
+
+	if (Type == NormalLineType::Face)
+	{
+		End = MIN(End, Context->GetTriangleNum());
+
+		//Normals a block at a time through the batch kernel
+		const int BlockSize = 256;
+		Float3 Normals[BlockSize];
+		for (int Block = Begin; Block < End; Block += BlockSize)
+		{
+			int Num = MIN(BlockSize, End - Block);
+			CalculateFaceNormals(VertexList, IndexList + (size_t)Block * 3, Num, Normals, NormalizeMode::Fast);
+
+			for (int j = 0; j < Num; j++)
+			{
+				int i = Block + j;
+				const Float3& P0 = VertexList[IndexList[i * 3]].pos;
+				const Float3& P1 = VertexList[IndexList[i * 3 + 1]].pos;
+				const Float3& P2 = VertexList[IndexList[i * 3 + 2]].pos;
+
+				Float3 Center = (P0 + P1 + P2) * (1.0f / 3.0f);
+
+				Dst[i * 2] = DrawRawVertex(Center, Normals[j], Float3(0.0f), 1.0f);
+				Dst[i * 2 + 1] = DrawRawVertex(Center + Normals[j] * Length, Normals[j], Float3(0.0f), 1.0f);
+			}
+		}
+	}
+	else
+	{
+		End = MIN(End, Context->GetVertexNum());
+		for (int i = Begin; i < End; i++)
+		{
+			const DrawRawVertex& Vertex = VertexList[i];
+
+			Dst[i * 2] = DrawRawVertex(Vertex.pos, Vertex.normal, Float3(0.0f), 1.0f);
+			Dst[i * 2 + 1] = DrawRawVertex(Vertex.pos + Vertex.normal * Length, Vertex.normal, Float3(0.0f), 1.0f);
+		}
+	}
+}
+
+
+
+NormalLineBuilder::NormalLineBuilder(int InChunkSize, ThreadPool* SharedPool) :
+	Worker(SharedPool != nullptr ? new ThreadProcesser(SharedPool) : new ThreadProcesser()),
+	Type(NormalLineType::Face),
+	ChunkSize(MAX(InChunkSize, 1))
+{
+}
+
+NormalLineBuilder::~NormalLineBuilder()
+{
+	Wait();
+}
+
+
+bool NormalLineBuilder::Kick(const std::vector<NormalLineTarget>& Targets, NormalLineType InType)
+{
+	if (IsWorking())
+		return false;
+
+	Type = InType;
+
+	//First chunk of every target, plus the total at the end
+	std::vector<NormalLineTarget> TargetList;
+	std::vector<int> ChunkOffset(1, 0);
+	for (int i = 0; i < Targets.size(); i++)
+	{
+		int PrimitiveNum = GetNormalLineVertexNum(Targets[i].Context, Type) / 2;
+		if (PrimitiveNum == 0 || Targets[i].Dst == nullptr)
+			continue;
+
+		TargetList.push_back(Targets[i]);
+		ChunkOffset.push_back(ChunkOffset.back() + (PrimitiveNum + ChunkSize - 1) / ChunkSize);
+	}
+
+	NormalLineType LineType = Type;
+	int LineChunkSize = ChunkSize;
+	return Worker->KickRange(ChunkOffset.back(), [TargetList, ChunkOffset, LineType, LineChunkSize](int Begin, int End)
+		{
+			for (int Chunk = Begin; Chunk < End; Chunk++)
+			{
+				int Index = (int)(std::upper_bound(ChunkOffset.begin(), ChunkOffset.end(), Chunk) - ChunkOffset.begin()) - 1;
+				const NormalLineTarget& Target = TargetList[Index];
+
+				int First = (Chunk - ChunkOffset[Index]) * LineChunkSize;
+				BuildNormalLines(Target.Context, LineType, Target.Length, Target.Dst, First, First + LineChunkSize);
+			}
+		}, 1);
+}
+
+
+bool NormalLineBuilder::IsWorking()
+{
+	return Worker->IsWorking();
+}
+
+
+void NormalLineBuilder::Wait()
+{
+	while (IsWorking())
+	{
+		Worker->WaitForComplete();
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "Utils.h"
+#include "Processer.h"
+
+
+enum class NormalLineType
+{
+	Face,
+	Vertex,
+	Num
+};
+
+
+//2 line vertices per triangle for face normals, per vertex for vertex normals
+int GetNormalLineVertexNum(SourceContext* Context, NormalLineType Type);
+
+//Lines are this fraction of the bounding box diagonal long
+float GetNormalLineLength(const BoundingBox& Bounding, float Scale = 0.01f);
+
+/*
+* Write the lines of triangles or vertices [Begin, End) to Dst, 2 vertices each,
+* Dst points at the first line of the context, not at Begin.
+* Face normals start at the triangle center.
+*/
+void BuildNormalLines(SourceContext* Context, NormalLineType Type, float Length, DrawRawVertex* Dst, int Begin, int End);
+
+
+struct NormalLineTarget
+{
+	SourceContext* Context;
+	float Length;
+	//GetNormalLineVertexNum() vertices, may be a mapped upload heap
+	DrawRawVertex* Dst;
+};
+
+
+/*
+* Builds the debug lines of several contexts on the threads of SharedPool, or on its own threads without one,
+* so they are only derived from the triangles when someone wants to look at them.
+* The contexts must not change until the lines are done.
+*/
+class NormalLineBuilder
+{
+public:
+	NormalLineBuilder(int InChunkSize = 65536, ThreadPool* SharedPool = nullptr);
+	~NormalLineBuilder();
+
+	/****Call in Client****/
+	bool Kick(const std::vector<NormalLineTarget>& Targets, NormalLineType Type);
+	bool IsWorking();
+	//Block until the lines being built are done
+	void Wait();
+
+	NormalLineType GetType() const
+	{
+		return Type;
+	}
+
+private:
+	std::unique_ptr<ThreadProcesser> Worker;
+	NormalLineType Type;
+	int ChunkSize;
+};
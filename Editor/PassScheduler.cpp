@@ -0,0 +1,328 @@
+#include "PassScheduler.h"
+
+#include <algorithm>
+#include <iostream>
+
+
+static bool HasCommonName(const std::vector<std::string>& A, const std::vector<std::string>& B)
+{
+	for (int i = 0; i < A.size(); i++)
+	{
+		if (std::find(B.begin(), B.end(), A[i]) != B.end())
+			return true;
+	}
+	return false;
+}
+
+
+
+PassScheduler::PassScheduler(Processer* InProcesser, int InMaxParallelPasses) :
+	ExternalProcesser(InProcesser),
+	MaxParallelPasses(MAX(1, InMaxParallelPasses)),
+	FinishedNum(0),
+	Running(false),
+	Failed(false),
+	LastState("")
+{
+}
+
+
+bool PassScheduler::Start()
+{
+	Reset();
+	if (ExternalProcesser == nullptr)
+		return false;
+
+	ExternalProcesser->GetPassList(PassList);
+	if (PassList.size() == 0)
+		return false;
+	if (PassList[0].IsStream())
+	{
+		std::cout << "Stream pass " << PassList[0].Name << " has no pass to stream from." << std::endl;
+		return false;
+	}
+
+	if (ExternalProcesser->GetProfiler() != nullptr)
+		ExternalProcesser->GetProfiler()->Reset();
+
+	Records.resize(PassList.size());
+	for (int i = 0; i < Records.size(); i++)
+	{
+		Records[i].PassIndex = i + 1;
+		Records[i].Head = PassList[i].IsStream() ? Records[i - 1].Head : i;
+	}
+	BuildDependency();
+
+	LaneOwner.assign(MaxParallelPasses, -1);
+	Running = true;
+
+	return true;
+}
+
+
+void PassScheduler::Reset()
+{
+	if (ExternalProcesser != nullptr)
+	{
+		for (int Lane = 0; Lane < LaneOwner.size(); Lane++)
+		{
+			if (LaneOwner[Lane] < 0) continue;
+			ExternalProcesser->SelectLane(Lane);
+			ExternalProcesser->Clear();
+		}
+		ExternalProcesser->SelectLane(0);
+	}
+
+	PassList.clear();
+	Records.clear();
+	LaneOwner.clear();
+	FinishedNum = 0;
+	Running = false;
+	Failed = false;
+	LastState = "";
+}
+
+
+void PassScheduler::BuildDependency()
+{
+	for (int j = 0; j < PassList.size(); j++)
+	{
+		const PassDesc& Later = PassList[j];
+		for (int i = 0; i < j; i++)
+		{
+			const PassDesc& Earlier = PassList[i];
+
+			bool Depend = Earlier.IsBarrier() || Later.IsBarrier();
+			//Read after write, write after write
+			Depend = Depend || HasCommonName(Earlier.Outputs, Later.Inputs) || HasCommonName(Earlier.Outputs, Later.Outputs);
+			//Write after read
+			Depend = Depend || HasCommonName(Earlier.Inputs, Later.Outputs);
+
+			if (Depend)
+				Records[j].DependOn.push_back(i);
+		}
+	}
+
+	//A stream pass starts with its head, so the head has to wait for whatever the stream pass waits for
+	for (int j = 0; j < PassList.size(); j++)
+	{
+		int Head = Records[j].Head;
+		if (Head == j)
+			continue;
+
+		std::vector<int>& HeadDependOn = Records[Head].DependOn;
+		for (int k = 0; k < Records[j].DependOn.size(); k++)
+		{
+			int DependIndex = Records[j].DependOn[k];
+			if (DependIndex < Head && std::find(HeadDependOn.begin(), HeadDependOn.end(), DependIndex) == HeadDependOn.end())
+				HeadDependOn.push_back(DependIndex);
+		}
+	}
+}
+
+
+bool PassScheduler::IsReady(int PassIndex)
+{
+	PassRecord& Record = Records[PassIndex];
+	if (Record.Started || Record.Head != PassIndex)
+		return false;
+
+	for (int i = 0; i < Record.DependOn.size(); i++)
+	{
+		if (!Records[Record.DependOn[i]].Finished)
+			return false;
+	}
+	return true;
+}
+
+
+bool PassScheduler::LaunchPass(int PassIndex, int Lane)
+{
+	PassRecord& Record = Records[PassIndex];
+	Record.Started = true;
+	Record.Lane = Lane;
+	Record.StartTime = PlatformTime::Seconds();
+	LaneOwner[Lane] = PassIndex;
+
+	//The lane starts without the results and errors of the pass it ran before
+	ExternalProcesser->SelectLane(Lane);
+	ExternalProcesser->Clear();
+	ExternalProcesser->ClearStreamFunc();
+
+	//Chain the stream passes behind this one before it kicks
+	for (int i = PassIndex + 1; i < PassList.size() && Records[i].Head == PassIndex; i++)
+	{
+		Records[i].Started = true;
+		Records[i].Lane = Lane;
+		Records[i].StartTime = Record.StartTime;
+		Records[i].State = "Streamed from " + PassList[PassIndex].Name;
+		ExternalProcesser->ChainStreamFunc(PassList[i].StreamFunc, PassList[i].BufferSize);
+	}
+
+	double SetupCpuTime = PlatformTime::ThreadCpuSeconds();
+	PassType& Func = PassList[PassIndex].Func;
+	Record.Success = (Func == nullptr) || Func(ExternalProcesser, Record.State);
+	Record.SetupSeconds = PlatformTime::Seconds() - Record.StartTime;
+	Record.SetupCpuSeconds = PlatformTime::ThreadCpuSeconds() - SetupCpuTime;
+	if (Record.State.size() > 0)
+		LastState = Record.State;
+
+	if (!Record.Success)
+	{
+		Failed = true;
+		RetirePass(PassIndex);
+	}
+
+	return Record.Success;
+}
+
+
+void PassScheduler::FinishPass(int PassIndex, double EndTime)
+{
+	PassRecord& Record = Records[PassIndex];
+	Record.Finished = true;
+	Record.Seconds = EndTime - Record.StartTime;
+	FinishedNum++;
+
+	Profiler* PassProfiler = ExternalProcesser->GetProfiler();
+	if (PassProfiler != nullptr)
+	{
+		PassProfile Profile;
+		Profile.Name = PassList[PassIndex].Name;
+		Profile.PassIndex = Record.PassIndex;
+		Profile.Lane = Record.Lane;
+		Profile.Begin = Record.StartTime;
+		Profile.WallSeconds = Record.Seconds;
+		Profile.SetupSeconds = Record.SetupSeconds;
+		Profile.SetupCpuSeconds = Record.SetupCpuSeconds;
+		Profile.Success = Record.Success;
+
+		//The lane of this pass is selected, a stream pass reads its stage of the same lane
+		const ThreadProcesser* Lane = Records[Record.Head].Success ? ExternalProcesser->GetSelectedLane() : nullptr;
+		PassProfiler->AddPass(Profile, Lane, PassIndex - Record.Head);
+	}
+
+	if (CallBackOnPassFinished != nullptr)
+		CallBackOnPassFinished(ExternalProcesser, PassIndex, Record);
+}
+
+
+void PassScheduler::RetirePass(int PassIndex)
+{
+	LaneOwner[Records[PassIndex].Lane] = -1;
+
+	//Stream passes end with their head
+	double EndTime = PlatformTime::Seconds();
+	FinishPass(PassIndex, EndTime);
+
+	bool HeadSuccess = Records[PassIndex].Success;
+	for (int i = PassIndex + 1; i < PassList.size() && Records[i].Head == PassIndex; i++)
+	{
+		Records[i].Success = HeadSuccess;
+		FinishPass(i, EndTime);
+	}
+
+	//Every callback of the pass has seen them, the next pass on this lane starts empty
+	ExternalProcesser->ClearDrainedResults();
+}
+
+
+bool PassScheduler::Tick()
+{
+	if (!Running)
+		return false;
+
+	//Retire
+	for (int Lane = 0; Lane < LaneOwner.size(); Lane++)
+	{
+		int PassIndex = LaneOwner[Lane];
+		if (PassIndex < 0) continue;
+
+		ExternalProcesser->SelectLane(Lane);
+		if (ExternalProcesser->Join(0))
+			RetirePass(PassIndex);
+	}
+
+	//Launch, stop feeding new passes once something failed
+	for (int PassIndex = 0; !Failed && PassIndex < PassList.size(); PassIndex++)
+	{
+		if (!IsReady(PassIndex))
+			continue;
+
+		int FreeLane = -1;
+		for (int Lane = 0; Lane < LaneOwner.size(); Lane++)
+		{
+			if (LaneOwner[Lane] < 0)
+			{
+				FreeLane = Lane;
+				break;
+			}
+		}
+		if (FreeLane < 0)
+			break;
+
+		LaunchPass(PassIndex, FreeLane);
+	}
+
+	bool AnyRunning = false;
+	for (int Lane = 0; Lane < LaneOwner.size(); Lane++)
+	{
+		AnyRunning = AnyRunning || LaneOwner[Lane] >= 0;
+	}
+
+	Running = AnyRunning || (!Failed && FinishedNum < PassList.size());
+	if (!Running)
+		ExternalProcesser->SelectLane(0);
+
+	return Running;
+}
+
+
+bool PassScheduler::RunToEnd()
+{
+	while (Tick())
+	{
+		int OldestLane = -1;
+		int RunningNum = 0;
+		for (int Lane = 0; Lane < LaneOwner.size(); Lane++)
+		{
+			if (LaneOwner[Lane] < 0) continue;
+
+			RunningNum++;
+			if (OldestLane < 0 || LaneOwner[Lane] < LaneOwner[OldestLane])
+				OldestLane = Lane;
+		}
+
+		//A single pass in flight can be slept on, with several wake up now and then to catch whichever ends first
+		if (OldestLane >= 0)
+		{
+			ExternalProcesser->SelectLane(OldestLane);
+			ExternalProcesser->Join(RunningNum == 1 ? INFINITE : 5);
+		}
+	}
+
+	return !Failed;
+}
+
+
+double PassScheduler::GetProgress()
+{
+	if (PassList.size() == 0)
+		return 0.0;
+
+	double Done = 0.0;
+	for (int i = 0; i < Records.size(); i++)
+	{
+		if (Records[i].Finished)
+		{
+			Done += 1.0;
+		}
+		else if (Records[i].Started)
+		{
+			ExternalProcesser->SelectLane(Records[i].Lane);
+			Done += MIN(1.0, ExternalProcesser->GetProgress());
+		}
+	}
+
+	return Done / (double)PassList.size();
+}
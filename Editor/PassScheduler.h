@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "Processer.h"
+
+
+struct PassRecord
+{
+	PassRecord() :
+		PassIndex(0),
+		Head(0),
+		Lane(-1),
+		Started(false),
+		Finished(false),
+		Success(false),
+		Seconds(0.0),
+		StartTime(0.0),
+		SetupSeconds(0.0),
+		SetupCpuSeconds(0.0)
+	{}
+
+	int PassIndex;
+	//Pass that launches this one, itself unless this is a stream pass
+	int Head;
+	int Lane;
+	bool Started;
+	bool Finished;
+	bool Success;
+	double Seconds;
+	std::string State;
+	//PlatformTime::Seconds()
+	double StartTime;
+	//Time spent in the pass function itself
+	double SetupSeconds;
+	double SetupCpuSeconds;
+
+	//Indices of the passes this one has to wait for
+	std::vector<int> DependOn;
+};
+
+
+/*
+* Runs the passes of a Processer as a dependency graph.
+* A pass waits for every earlier pass that writes what it reads or writes,
+* or reads what it writes. Independent passes run at the same time, each on
+* its own Processer lane. A stream pass rides on the lane of the pass before
+* it and is started and retired together with it.
+* Pass functions themselves are always called on the thread that calls Tick().
+*/
+class PassScheduler
+{
+public:
+	PassScheduler(Processer* InProcesser, int InMaxParallelPasses = 4);
+
+	//Build the graph from the Processer, return false if nothing to run
+	bool Start();
+	//Kick ready passes and retire finished ones, never blocks
+	//Return false once every pass is done or the graph stopped on an error
+	bool Tick();
+	//Block until every pass is done, return false if one failed
+	bool RunToEnd();
+	void Reset();
+
+	double GetProgress();
+
+	bool IsRunning() const
+	{
+		return Running;
+	}
+	bool IsFailed() const
+	{
+		return Failed;
+	}
+	int GetPassNum() const
+	{
+		return (int)PassList.size();
+	}
+	const PassDesc& GetPass(int PassIndex) const
+	{
+		return PassList[PassIndex];
+	}
+	const std::vector<PassRecord>& GetRecords() const
+	{
+		return Records;
+	}
+	//State string of the last pass that reported anything
+	const std::string& GetLastState() const
+	{
+		return LastState;
+	}
+
+public:
+	//Called after a pass is drained, on the Tick() thread, with its lane selected
+	//GetDrainedResults() holds every result of the pass until the callback returns
+	//GetErrorString() holds what the pass reported, stream passes share it with their head
+	std::function<void(Processer* InProcesser, int PassIndex, PassRecord& Record)> CallBackOnPassFinished;
+
+private:
+	void BuildDependency();
+	bool IsReady(int PassIndex);
+	bool LaunchPass(int PassIndex, int Lane);
+	void RetirePass(int PassIndex);
+	void FinishPass(int PassIndex, double EndTime);
+
+private:
+	Processer* ExternalProcesser;
+	int MaxParallelPasses;
+
+	std::vector<PassDesc> PassList;
+	std::vector<PassRecord> Records;
+	std::vector<int> LaneOwner;
+
+	int FinishedNum;
+	bool Running;
+	bool Failed;
+	std::string LastState;
+};
@@ -9,9 +9,15 @@
 #include <fstream>
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <type_traits>
 
 #include "Utils.h"
+#include "DrawTypes.h"
 #include "ThreadProcesser.h"
+#include "ResultCache.h"
+#include "Profiler.h"
+#include "GeometryArena.h"
 
 using namespace std;
 
@@ -19,20 +25,72 @@ class Processer;
 typedef std::function<bool(Processer* InProcesser, std::string& State)> PassType;
 
 
-struct DrawRawVertex
+typedef void* (*StreamFuncType)(void* Data, double* Progress);
+
+
+/*
+* A pass plus the data it touches, names are free-form keys like "Normal" or "Bounding".
+* Passes with no declared inputs and outputs are barriers and run alone, like PassPool.
+* A stream pass has no setup of its own, it runs StreamFunc on every result of the pass before it
+* while that pass is still working.
+*/
+struct PassDesc
 {
-	DrawRawVertex() :
-		pos(), normal(), color(), alpha(0.0f)
+	PassDesc() :
+		Name(""),
+		Func(nullptr),
+		StreamFunc(nullptr),
+		BufferSize(0)
 	{}
-	DrawRawVertex(Float3 _pos, Float3 _nor, Float3 _col, float _alpha) :
-		pos(_pos), normal(_nor), color(_col), alpha(_alpha)
+	PassDesc(const std::string& InName, PassType InFunc, const std::vector<std::string>& InInputs, const std::vector<std::string>& InOutputs) :
+		Name(InName),
+		Func(InFunc),
+		StreamFunc(nullptr),
+		BufferSize(0),
+		Inputs(InInputs),
+		Outputs(InOutputs)
 	{}
-	Float3 pos;
-	Float3 normal;
-	Float3 color;
-	float alpha;
+	PassDesc(const std::string& InName, StreamFuncType InStreamFunc, UINT32 InBufferSize, const std::vector<std::string>& InInputs, const std::vector<std::string>& InOutputs) :
+		Name(InName),
+		Func(nullptr),
+		StreamFunc(InStreamFunc),
+		BufferSize(InBufferSize),
+		Inputs(InInputs),
+		Outputs(InOutputs)
+	{}
+
+	bool IsBarrier() const
+	{
+		return Inputs.empty() && Outputs.empty();
+	}
+	bool IsStream() const
+	{
+		return StreamFunc != nullptr;
+	}
+
+	std::string Name;
+	PassType Func;
+	StreamFuncType StreamFunc;
+	UINT32 BufferSize;
+	std::vector<std::string> Inputs;
+	std::vector<std::string> Outputs;
+};
+
+
+//MeshletBuilder.h
+struct MeshletData;
+
+//Reduced level of a SourceContext, indexes the same DrawVertexList
+struct SourceLod
+{
+	SourceLod() :
+		Error(0.0f)
+	{}
+
+	std::vector<DrawRawIndex> IndexList;
+	//Largest distance to the full mesh, in world units
+	float Error;
 };
-typedef unsigned int DrawRawIndex;
 
 
 
@@ -42,13 +100,12 @@ public:
 	SourceContext() :
 		Name("Unknow"),
 		DrawIndexList(nullptr),
-		DrawFaceNormalIndexList(nullptr),
-		DrawVertexNormalIndexList(nullptr),
 		DrawVertexList(nullptr),
-		DrawFaceNormalVertexList(nullptr),
-		DrawVertexNormalVertexList(nullptr),
 		CurrentPos1(0),
-		CurrentPos2(0)
+		CurrentPos2(0),
+		Dirty(true),
+		SourceHash(0),
+		Arena(nullptr)
 	{}
 	virtual ~SourceContext()
 	{
@@ -65,48 +122,94 @@ public:
 	virtual bool Load(std::filesystem::path* InFilePath) {
 		return true;
 	}
+	//Called after a pass compacted DrawVertexList, return false if the context can't shrink
+	virtual bool SetVertexNum(int VertexNum) {
+		return false;
+	}
 
-	void Release()
-	{
-		if (DrawIndexList != nullptr)
-			delete[] DrawIndexList;
-		DrawIndexList = nullptr;
-
-		if (DrawFaceNormalIndexList != nullptr)
-			delete[] DrawFaceNormalIndexList;
-		DrawFaceNormalIndexList = nullptr;
+	/*
+	* Hooks for the result cache and incremental import.
+	* GetContentHash should cover everything a pass reads, the default hashes the draw arrays,
+	* override it if a pass reads more than that, and GetContentSize with it.
+	* Serialize/Deserialize should cover everything a pass writes, a context that keeps those defaults is never cached.
+	*/
+	virtual size_t GetContentHash() {
+		if (DrawVertexList == nullptr || DrawIndexList == nullptr)
+			return 0;
+
+		size_t Hash = HashBytes(DrawVertexList, (size_t)GetVertexNum() * sizeof(DrawRawVertex));
+		Hash = HashBytes(DrawIndexList, (size_t)GetTriangleNum() * 3 * sizeof(DrawRawIndex), Hash);
+		return HashFinalize(Hash);
+	}
+	//Bytes GetContentHash() covers, stored with cached results next to the hash
+	virtual UINT64 GetContentSize() {
+		if (DrawVertexList == nullptr || DrawIndexList == nullptr)
+			return 0;
 
-		if (DrawVertexNormalIndexList != nullptr)
-			delete[] DrawVertexNormalIndexList;
-		DrawVertexNormalIndexList = nullptr;
+		return (UINT64)GetVertexNum() * sizeof(DrawRawVertex) + (UINT64)GetTriangleNum() * 3 * sizeof(DrawRawIndex);
+	}
+	virtual bool Serialize(std::vector<Byte>& OutData) {
+		return false;
+	}
+	virtual bool Deserialize(const std::vector<Byte>& InData) {
+		return false;
+	}
 
-		if (DrawVertexList != nullptr)
-			delete[] DrawVertexList;
-		DrawVertexList = nullptr;
+	//From the arena of this context if it has one, from the heap otherwise, nullptr when the arena is out of memory
+	template<typename T>
+	T* AllocateBuffer(size_t Num)
+	{
+		if (Arena != nullptr)
+			return Arena->AllocateArray<T>(Num);
+		return new T[Num];
+	}
 
-		if (DrawFaceNormalVertexList != nullptr)
-			delete[] DrawFaceNormalVertexList;
-		DrawFaceNormalVertexList = nullptr;
+	void Release()
+	{
+		//Arena memory goes back with the whole arena
+		if (Arena == nullptr)
+		{
+			if (DrawIndexList != nullptr)
+				delete[] DrawIndexList;
+			if (DrawVertexList != nullptr)
+				delete[] DrawVertexList;
+		}
 
-		if (DrawVertexNormalVertexList != nullptr)
-			delete[] DrawVertexNormalVertexList;
-		DrawVertexNormalVertexList = nullptr;
+		DrawIndexList = nullptr;
+		DrawVertexList = nullptr;
+		LodList.clear();
+		Meshlets.reset();
 	}
 
 public:
 	std::string Name;
 	BoundingBox Bounding;
+	//Filled by MakeBoundingSpherePass(), radius 0 otherwise
+	BoundingSphere Sphere;
 
+	//Normal debug lines are derived from these by the viewer, see NormalLines.h
 	DrawRawIndex* DrawIndexList;
-	DrawRawIndex* DrawFaceNormalIndexList;
-	DrawRawIndex* DrawVertexNormalIndexList;
 	DrawRawVertex* DrawVertexList;
-	DrawRawVertex* DrawFaceNormalVertexList;
-	DrawRawVertex* DrawVertexNormalVertexList;
 
 	int CurrentPos1;
 	int CurrentPos2;
 
+	//Key of the pass running on this context, invalid if not cached
+	ResultKey CacheKey;
+
+	//Passes have to run on this context again
+	bool Dirty;
+	//GetContentHash() right after import, 0 if unknown
+	size_t SourceHash;
+
+	//Set by Processer::NewContext(), owns this context and its buffers
+	GeometryArena* Arena;
+
+	//Filled by MakeLodPass(), coarser levels come later
+	std::vector<SourceLod> LodList;
+	//Filled by MakeMeshletPass()
+	std::shared_ptr<MeshletData> Meshlets;
+
 };
 
 
@@ -118,25 +221,35 @@ class Processer
 public:
 	Processer() :
 		AsyncProcesser(nullptr),
-		ErrorString("")
+		SelectedLane(0),
+		Pool(new ThreadPool()),
+		Cache(nullptr),
+		PassProfiler(nullptr),
+		CurrentArena(nullptr)
 	{
-		AsyncProcesser = new ThreadProcesser();
+		SelectLane(0);
 	}
 	virtual ~Processer()
 	{
-
-		if (AsyncProcesser != nullptr)
+		for (int i = 0; i < Lanes.size(); i++)
 		{
-			delete AsyncProcesser;
-			AsyncProcesser = nullptr;
+			delete Lanes[i];
 		}
+		Lanes.clear();
+		AsyncProcesser = nullptr;
 
-		for (int i = 0; i < ContextList.size(); i++)
-		{
-			if(ContextList[i])
-				delete ContextList[i];
-		}
-		ContextList.clear();
+		delete Pool;
+		Pool = nullptr;
+
+		if (Cache != nullptr)
+			delete Cache;
+		Cache = nullptr;
+
+		if (PassProfiler != nullptr)
+			delete PassProfiler;
+		PassProfiler = nullptr;
+
+		ReleaseContexts();
 
 	}
 
@@ -144,9 +257,49 @@ public:
 
 public:
 
+	/*
+	* Collects the contexts of the file through ImportContexts() and merges them with UpdateContextList(),
+	* so meshes that didn't change keep their results and only the rest is generated again.
+	*/
 	virtual bool Import(std::filesystem::path* InFilePath)
 	{
 		std::cout << "Import:" << *InFilePath << std::endl;
+
+		BeginImportArena();
+		std::vector<SourceContext*> NewContextList;
+		bool Success = ImportContexts(InFilePath, NewContextList);
+
+		//A buffer the arena couldn't give fails the whole import
+		for (int i = 0; i < NewContextList.size() && Success; i++)
+		{
+			SourceContext* Context = NewContextList[i];
+			if ((Context->GetVertexNum() > 0 && Context->DrawVertexList == nullptr) || (Context->GetTriangleNum() > 0 && Context->DrawIndexList == nullptr))
+			{
+				GetErrorString() += "Import : out of memory for the buffers of " + Context->Name + "\n";
+				Success = false;
+			}
+		}
+
+		if (!Success)
+		{
+			for (int i = 0; i < NewContextList.size(); i++)
+			{
+				DeleteContext(NewContextList[i]);
+			}
+			NewContextList.clear();
+			ReleaseUnusedArenas();
+			return false;
+		}
+
+		int DirtyNum = UpdateContextList(NewContextList);
+		std::cout << "Contexts:" << ContextList.size() << " Dirty:" << DirtyNum << std::endl;
+		return true;
+	}
+
+	//One context per mesh of the file, made with NewContext<T>() so they share the arena of this import
+	//Buffers come from SourceContext::AllocateBuffer(), a nullptr one fails the import
+	virtual bool ImportContexts(std::filesystem::path* InFilePath, std::vector<SourceContext*>& OutContextList)
+	{
 		return true;
 	}
 
@@ -172,26 +325,184 @@ public:
 		AsyncProcesser->SetRunFunc(Runnable);
 		AsyncProcesser->SetIntervalTime(IntervalTime);
 	}
+	/*
+	* Same as BindRunFunc, but each context is looked up in the result cache first.
+	* The key is the content hash of the context before the pass plus ParamHash,
+	* so ParamHash must change whenever the pass or its settings change.
+	* Data added must be SourceContext, falls back to BindRunFunc if no cache is enabled.
+	*/
+	void BindCachedRunFunc(void*(*RunFunc)(void*, double*), double IntervalTime, size_t ParamHash)
+	{
+		if (!AsyncProcesser) return;
+		if (!Cache)
+		{
+			BindRunFunc(RunFunc, IntervalTime);
+			return;
+		}
+
+		ResultCache* PassCache = Cache;
+		std::function<void* (void*, double*)> Runnable = [PassCache, RunFunc, ParamHash](void* Data, double* Progress) -> void*
+		{
+			SourceContext* Context = (SourceContext*)Data;
+			if (!Context->CacheKey.IsValid())
+			{
+				size_t ContentHash = Context->GetContentHash();
+				if (ContentHash != 0)
+				{
+					Context->CacheKey = ResultKey(ContentHash, ParamHash, Context->GetContentSize());
+
+					std::vector<Byte> Cached;
+					if (PassCache->Load(Context->CacheKey, Cached) && Context->Deserialize(Cached))
+					{
+						Context->CacheKey = ResultKey();
+						*Progress = 1.0;
+						return Context;
+					}
+				}
+			}
+
+			void* Result = RunFunc(Data, Progress);
+			if (Result != nullptr && Context->CacheKey.IsValid())
+			{
+				std::vector<Byte> Output;
+				if (Context->Serialize(Output))
+					PassCache->Store(Context->CacheKey, Output);
+				Context->CacheKey = ResultKey();
+			}
+			return Result;
+		};
+		AsyncProcesser->SetRunFunc(Runnable);
+		AsyncProcesser->SetIntervalTime(IntervalTime);
+	}
+
+	//Cache directory may be shared, MaxBytes caps it with LRU eviction
+	void EnableResultCache(const std::filesystem::path& Directory, UINT64 MaxBytes = 1024ull * 1024ull * 1024ull)
+	{
+		if (Cache != nullptr)
+			delete Cache;
+		Cache = new ResultCache(Directory, MaxBytes);
+	}
+	ResultCache* GetResultCache()
+	{
+		return Cache;
+	}
+
+	/*
+	* Result cache for typed passes, the key of a context is the hash of its current content plus ParamHash,
+	* so ParamHash must change whenever the pass or its settings change.
+	* The content is hashed again for every pass, whatever ran before, cached or not.
+	* Dirty contexts ReadFunc(Context, Data) restores from the cache are left out,
+	* the rest come back with the key to give StorePassResult() once they are done, invalid without a cache.
+	*/
+	template<typename ReadFuncType>
+	void FindUncachedContexts(size_t ParamHash, ReadFuncType ReadFunc, std::vector<SourceContext*>& OutContexts, std::vector<ResultKey>& OutKeys)
+	{
+		OutContexts.clear();
+		OutKeys.clear();
+		for (int i = 0; i < ContextList.size(); i++)
+		{
+			SourceContext* Context = ContextList[i];
+			if (!Context->Dirty)
+				continue;
+
+			ResultKey Key;
+			if (Cache != nullptr)
+			{
+				size_t ContentHash = Context->GetContentHash();
+				if (ContentHash != 0)
+					Key = ResultKey(ContentHash, ParamHash, Context->GetContentSize());
+			}
+
+			std::vector<Byte> Cached;
+			if (Key.IsValid() && Cache->Load(Key, Cached) && ReadFunc(Context, Cached))
+				continue;
+
+			OutContexts.push_back(Context);
+			OutKeys.push_back(Key);
+		}
+	}
+	//Any thread, does nothing for an invalid key
+	bool StorePassResult(const ResultKey& Key, const std::vector<Byte>& Data)
+	{
+		return Key.IsValid() && Cache != nullptr && Cache->Store(Key, Data);
+	}
+
+	//Time every pass and every RunFunc call, see GetProfiler()
+	void EnableProfiling(bool Enable)
+	{
+		if (Enable && PassProfiler == nullptr)
+			PassProfiler = new Profiler();
+		else if (!Enable && PassProfiler != nullptr)
+		{
+			delete PassProfiler;
+			PassProfiler = nullptr;
+		}
+
+		for (int i = 0; i < Lanes.size(); i++)
+		{
+			Lanes[i]->SetProfiling(Enable);
+		}
+	}
+	//nullptr if profiling is off
+	Profiler* GetProfiler()
+	{
+		return PassProfiler;
+	}
+
+	/*
+	* Typed work, no void* items, no result allocation, no std::function call per item.
+	* Kernel is inlined into a loop over a chunk, only each chunk goes through the lane.
+	* Everything referenced must stay alive until the pass is done, typed kicks can't feed stream passes.
+	*/
+	bool KickRange(int ItemNum, std::function<void(int, int)> RangeFunc, int ChunkSize = 0)
+	{
+		return (AsyncProcesser != nullptr) && AsyncProcesser->KickRange(ItemNum, std::move(RangeFunc), ChunkSize);
+	}
+
+	//Kernel(Contexts[i], i) for every context, such as the ones FindUncachedContexts() returned, results stay in the contexts
+	template<typename ContextType, typename KernelType>
+	bool KickContexts(std::vector<ContextType*> Contexts, KernelType Kernel, int ChunkSize = 1)
+	{
+		int ContextNum = (int)Contexts.size();
+		return KickRange(ContextNum, [Contexts = std::move(Contexts), Kernel](int Begin, int End)
+			{
+				for (int i = Begin; i < End; i++)
+				{
+					Kernel(Contexts[i], i);
+				}
+			}, ChunkSize);
+	}
+
+	//Run StreamFunc on every result of the bound RunFunc as soon as it comes out
+	//At most BufferSize items wait in between, call before Kick()
+	void ChainStreamFunc(StreamFuncType StreamFunc, UINT32 BufferSize)
+	{
+		if (!AsyncProcesser) return;
+
+		std::function<void* (void*, double*)> Runnable = std::bind(StreamFunc, std::placeholders::_1, std::placeholders::_2);
+		AsyncProcesser->AddStage(Runnable, BufferSize);
+	}
+	void ClearStreamFunc()
+	{
+		if (AsyncProcesser)
+			AsyncProcesser->ClearStages();
+	}
 	bool Kick()
 	{
 		return (AsyncProcesser != nullptr) && AsyncProcesser->Kick();
 	}
 
+	//Progress of the selected lane without touching the results
 	double GetProgress()
 	{
-		if (AsyncProcesser == nullptr)
-			return 0.0;
-
-		double Progress = 0.0;
-		SourceContext* Result = (SourceContext*)AsyncProcesser->GetResult(&Progress);
-		//if (Result) ContextList.push_back(Result);
-
-		return Progress;
+		return (AsyncProcesser != nullptr) ? AsyncProcesser->GetProgress() : 0.0;
 	}
 
+	//Errors of the selected lane, a pass reports into the one of its own lane
+	//Take the reference while setting the pass up if its work items report too
 	std::string& GetErrorString()
 	{
-		return ErrorString;
+		return ErrorStrings[SelectedLane];
 	}
 
 	void DumpErrorString(uint FileIndex)
@@ -200,9 +511,9 @@ public:
 		FileName += ".log";
 
 		std::ofstream OutFile(FileName.c_str(), std::ios::out);
-		OutFile << ErrorString;
+		OutFile << ErrorStrings[SelectedLane];
 		OutFile.close();
-		ErrorString = "";
+		ErrorStrings[SelectedLane] = "";
 	}
 
 	std::vector<SourceContext*>& GetContextList()
@@ -210,26 +521,316 @@ public:
 		return ContextList;
 	}
 
+	/*
+	* Take a freshly imported list, contexts are matched by Name.
+	* If the geometry hash of a match is unchanged the old context is kept with its results
+	* and the new one is deleted, anything else is marked dirty.
+	* Return the number of dirty contexts.
+	*/
+	int UpdateContextList(std::vector<SourceContext*>& NewContextList)
+	{
+		std::unordered_multimap<std::string, SourceContext*> OldContexts;
+		for (int i = 0; i < ContextList.size(); i++)
+		{
+			OldContexts.insert(std::make_pair(ContextList[i]->Name, ContextList[i]));
+		}
+
+		std::vector<SourceContext*> UpdatedList;
+		for (int i = 0; i < NewContextList.size(); i++)
+		{
+			SourceContext* NewContext = NewContextList[i];
+			NewContext->SourceHash = NewContext->GetContentHash();
+			NewContext->Dirty = true;
+
+			auto Range = OldContexts.equal_range(NewContext->Name);
+			auto Found = Range.second;
+			for (auto It = Range.first; It != Range.second; It++)
+			{
+				if (NewContext->SourceHash != 0 && It->second->SourceHash == NewContext->SourceHash)
+				{
+					Found = It;
+					break;
+				}
+			}
+
+			if (Found != Range.second)
+			{
+				UpdatedList.push_back(Found->second);
+				OldContexts.erase(Found);
+				DeleteContext(NewContext);
+			}
+			else
+			{
+				UpdatedList.push_back(NewContext);
+			}
+		}
+
+		//Gone from the source
+		for (auto& Item : OldContexts)
+		{
+			DeleteContext(Item.second);
+		}
+
+		ContextList.swap(UpdatedList);
+		NewContextList.clear();
+		ReleaseUnusedArenas();
+
+		return GetDirtyNum();
+	}
+
+	/*
+	* Contexts of one import share an arena, the context object and all its buffers
+	* are packed together and go away in one piece once no context of that import is left.
+	* Call BeginImportArena() at the start of Import(), then NewContext<T>() for each mesh.
+	*/
+	GeometryArena* BeginImportArena()
+	{
+		CurrentArena = new GeometryArena();
+		Arenas.push_back(CurrentArena);
+		return CurrentArena;
+	}
+
+	template<typename ContextType, typename... ArgTypes>
+	ContextType* NewContext(ArgTypes&&... Args)
+	{
+		if (CurrentArena == nullptr)
+			return new ContextType(std::forward<ArgTypes>(Args)...);
+
+		//Out of arena memory, the context and its buffers live on the heap like without an arena
+		void* Memory = CurrentArena->Allocate(sizeof(ContextType), alignof(ContextType));
+		if (Memory == nullptr)
+			return new ContextType(std::forward<ArgTypes>(Args)...);
+
+		ContextType* Context = new (Memory) ContextType(std::forward<ArgTypes>(Args)...);
+		Context->Arena = CurrentArena;
+		return Context;
+	}
+
+	void DeleteContext(SourceContext* Context)
+	{
+		if (Context == nullptr)
+			return;
+
+		if (Context->Arena != nullptr)
+			Context->~SourceContext();
+		else
+			delete Context;
+	}
+
+	//Drop every context and every arena, buffers are freed a block at a time
+	void ReleaseContexts()
+	{
+		for (int i = 0; i < ContextList.size(); i++)
+		{
+			DeleteContext(ContextList[i]);
+		}
+		ContextList.clear();
+
+		for (int i = 0; i < Arenas.size(); i++)
+		{
+			delete Arenas[i];
+		}
+		Arenas.clear();
+		CurrentArena = nullptr;
+	}
+
+	//Arenas of older imports whose contexts were all replaced
+	void ReleaseUnusedArenas()
+	{
+		std::unordered_set<GeometryArena*> UsedArenas;
+		for (int i = 0; i < ContextList.size(); i++)
+		{
+			UsedArenas.insert(ContextList[i]->Arena);
+		}
+
+		for (int i = 0; i < Arenas.size(); i++)
+		{
+			if (Arenas[i] == CurrentArena || UsedArenas.count(Arenas[i]) > 0)
+				continue;
+
+			delete Arenas[i];
+			Arenas.erase(Arenas.begin() + i);
+			i--;
+		}
+	}
+
+	//AddData for every dirty context, use in passes instead of walking ContextList
+	void AddDirtyData()
+	{
+		for (int i = 0; i < ContextList.size(); i++)
+		{
+			if (ContextList[i]->Dirty)
+				AddData(ContextList[i]);
+		}
+	}
+
+	void MarkDirty(SourceContext* Context)
+	{
+		Context->Dirty = true;
+	}
+	void MarkAllDirty()
+	{
+		for (int i = 0; i < ContextList.size(); i++)
+		{
+			ContextList[i]->Dirty = true;
+		}
+	}
+	//Call once every pass has finished on the dirty contexts
+	void ClearDirty()
+	{
+		for (int i = 0; i < ContextList.size(); i++)
+		{
+			ContextList[i]->Dirty = false;
+		}
+	}
+	int GetDirtyNum()
+	{
+		int DirtyNum = 0;
+		for (int i = 0; i < ContextList.size(); i++)
+		{
+			DirtyNum += ContextList[i]->Dirty ? 1 : 0;
+		}
+		return DirtyNum;
+	}
+
 	bool IsWorking()
 	{
 		return (AsyncProcesser != nullptr && AsyncProcesser->IsWorking());
 	}
 
+	//Return false if timeout
+	bool WaitForComplete(UINT32 WaitTime = INFINITE)
+	{
+		return (AsyncProcesser == nullptr) || AsyncProcesser->WaitForComplete(WaitTime);
+	}
+
 	void Clear()
 	{
 		AsyncProcesser->Clear();
+		DrainedResults[SelectedLane].clear();
+		ErrorStrings[SelectedLane] = "";
+	}
+
+	//Drop every result that is ready without waiting for the rest
+	void FlushResults()
+	{
+		DrainedResults[SelectedLane].clear();
+		if (AsyncProcesser != nullptr)
+			AsyncProcesser->DrainResults(DrainedResults[SelectedLane]);
+	}
+
+	/*
+	* Completion handle of the selected lane.
+	* Sleep up to WaitTime for the lane to finish, then append every ready result to
+	* GetDrainedResults() in one batch. Return true once the lane is finished and empty.
+	* WaitTime 0 never blocks, so the UI can poll it every frame.
+	*/
+	bool Join(UINT32 WaitTime = 0)
+	{
+		if (AsyncProcesser == nullptr)
+			return true;
+
+		bool Complete = AsyncProcesser->WaitForComplete(WaitTime);
+		AsyncProcesser->DrainResults(DrainedResults[SelectedLane]);
+
+		return Complete && !AsyncProcesser->IsWorking();
+	}
+	//Results of the selected lane, kept over every Join() until ClearDrainedResults()
+	std::vector<void*>& GetDrainedResults()
+	{
+		return DrainedResults[SelectedLane];
+	}
+	//PassScheduler calls it once CallBackOnPassFinished has seen the results of a pass
+	void ClearDrainedResults()
+	{
+		DrainedResults[SelectedLane].clear();
+	}
+
 
-		ErrorString = "";
+	/*
+	* Each lane is a ThreadProcesser with its own quests and results so passes that don't share data can run together.
+	* Lanes run on the threads of one pool, a lane never adds threads, see GetThreadPool().
+	* AddData/BindRunFunc/Kick/IsWorking/GetProgress/Clear all act on the selected lane.
+	*/
+	void SelectLane(int LaneIndex)
+	{
+		while (Lanes.size() <= LaneIndex)
+		{
+			Lanes.push_back(new ThreadProcesser(Pool));
+			Lanes.back()->SetProfiling(PassProfiler != nullptr);
+			DrainedResults.push_back(std::vector<void*>());
+			ErrorStrings.push_back(std::string());
+		}
+		AsyncProcesser = Lanes[LaneIndex];
+		SelectedLane = LaneIndex;
+	}
+
+	ThreadProcesser* GetSelectedLane()
+	{
+		return AsyncProcesser;
+	}
+
+	int GetLaneNum()
+	{
+		return (int)Lanes.size();
+	}
+
+	//For other work that should share the cores with the passes, detach from it before the Processer goes away
+	ThreadPool* GetThreadPool()
+	{
+		return Pool;
+	}
+
+	bool IsAnyLaneWorking()
+	{
+		for (int i = 0; i < Lanes.size(); i++)
+		{
+			if (Lanes[i]->IsWorking())
+				return true;
+		}
+		return false;
+	}
+
+	void AddPass(const std::string& Name, PassType Pass, const std::vector<std::string>& Inputs, const std::vector<std::string>& Outputs)
+	{
+		PassGraph.push_back(PassDesc(Name, Pass, Inputs, Outputs));
+	}
+
+	//Streams the results of the pass added right before it, the two behave as one pass in the graph
+	void AddStreamPass(const std::string& Name, StreamFuncType StreamFunc, const std::vector<std::string>& Inputs, const std::vector<std::string>& Outputs, UINT32 BufferSize = 256)
+	{
+		PassGraph.push_back(PassDesc(Name, StreamFunc, BufferSize, Inputs, Outputs));
+	}
+
+	//PassPool first as barriers, then PassGraph in the order they were added
+	void GetPassList(std::vector<PassDesc>& OutPassList)
+	{
+		OutPassList.clear();
+		for (int i = 0; i < PassPool.size(); i++)
+		{
+			OutPassList.push_back(PassDesc("Pass" + std::to_string(i + 1), PassPool[i], {}, {}));
+		}
+		OutPassList.insert(OutPassList.end(), PassGraph.begin(), PassGraph.end());
 	}
 
 
 public:
 	std::vector<PassType> PassPool;
+	std::vector<PassDesc> PassGraph;
 
 protected:
 	ThreadProcesser* AsyncProcesser;
-	std::string ErrorString;
+	int SelectedLane;
+	ThreadPool* Pool;
+	std::vector<ThreadProcesser*> Lanes;
+	ResultCache* Cache;
+	Profiler* PassProfiler;
+	//One per lane
+	std::vector<std::vector<void*>> DrainedResults;
+	std::vector<std::string> ErrorStrings;
 
 	std::vector<SourceContext*> ContextList;
+	std::vector<GeometryArena*> Arenas;
+	GeometryArena* CurrentArena;
 
 };
@@ -0,0 +1,175 @@
+#include "Profiler.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+#define LINE_STRING "================================"
+
+
+static std::string EscapeJson(const std::string& Str)
+{
+	std::string Result;
+	for (int i = 0; i < Str.size(); i++)
+	{
+		char c = Str[i];
+		if (c == '"' || c == '\\')
+		{
+			Result.push_back('\\');
+			Result.push_back(c);
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			Result.push_back(' ');
+		}
+		else
+		{
+			Result.push_back(c);
+		}
+	}
+	return Result;
+}
+
+
+
+Profiler::Profiler() :
+	SessionBegin(0.0)
+{
+	Reset();
+}
+
+
+void Profiler::Reset()
+{
+	PassList.clear();
+	TraceItems.clear();
+	SessionBegin = PlatformTime::Seconds();
+}
+
+
+void Profiler::AddPass(PassProfile& Pass, const ThreadProcesser* Lane, int Stage)
+{
+	if (Lane != nullptr)
+	{
+		Pass.WorkerNum = (int)Lane->GetWorkerNum();
+		for (int i = 0; i < Pass.WorkerNum; i++)
+		{
+			const WorkerProfile& Profile = Lane->GetWorkerProfile(i);
+			if (Stage >= Profile.Stages.size())
+				continue;
+
+			const StageStat& Stat = Profile.Stages[Stage];
+			Pass.BusySeconds += Stat.BusySeconds;
+			Pass.CpuSeconds += Stat.CpuSeconds;
+			Pass.CallNum += Stat.CallNum;
+			Pass.ItemNum += Stat.ItemNum;
+
+			for (int j = 0; j < Profile.Timings.size(); j++)
+			{
+				if (Profile.Timings[j].Stage != Stage)
+					continue;
+
+				TraceItem Item;
+				Item.Timing = Profile.Timings[j];
+				Item.Lane = Pass.Lane;
+				Item.PassIndex = Pass.PassIndex;
+				TraceItems.push_back(Item);
+			}
+		}
+	}
+
+	Pass.CpuSeconds += Pass.SetupCpuSeconds;
+	Pass.ItemsPerSecond = Pass.WallSeconds > 0.0 ? Pass.ItemNum / Pass.WallSeconds : 0.0;
+	Pass.Utilization = (Pass.WallSeconds > 0.0 && Pass.WorkerNum > 0) ? Pass.BusySeconds / (Pass.WallSeconds * Pass.WorkerNum) : 0.0;
+
+	PassList.push_back(Pass);
+}
+
+
+void Profiler::PrintReport()
+{
+	std::vector<PassProfile> Sorted = PassList;
+	std::sort(Sorted.begin(), Sorted.end(), [](const PassProfile& A, const PassProfile& B) { return A.PassIndex < B.PassIndex; });
+
+	std::cout << LINE_STRING << std::endl;
+	std::cout << std::left << std::setw(4) << "#" << std::setw(16) << "Pass" << std::right
+		<< std::setw(11) << "Wall(ms)" << std::setw(11) << "CPU(ms)" << std::setw(11) << "Setup(ms)"
+		<< std::setw(10) << "Items" << std::setw(12) << "Items/s" << std::setw(8) << "Util" << std::endl;
+
+	for (int i = 0; i < Sorted.size(); i++)
+	{
+		PassProfile& Pass = Sorted[i];
+		std::cout << std::left << std::setw(4) << Pass.PassIndex << std::setw(16) << Pass.Name.substr(0, 15) << std::right << std::fixed
+			<< std::setw(11) << std::setprecision(2) << Pass.WallSeconds * 1000.0
+			<< std::setw(11) << std::setprecision(2) << Pass.CpuSeconds * 1000.0
+			<< std::setw(11) << std::setprecision(2) << Pass.SetupSeconds * 1000.0
+			<< std::setw(10) << Pass.ItemNum
+			<< std::setw(12) << std::setprecision(1) << Pass.ItemsPerSecond
+			<< std::setw(7) << std::setprecision(1) << Pass.Utilization * 100.0 << "%"
+			<< (Pass.Success ? "" : "  FAILED") << std::endl;
+	}
+	std::cout << LINE_STRING << std::endl;
+}
+
+
+bool Profiler::ExportChromeTrace(const std::filesystem::path& FilePath)
+{
+	std::ofstream OutFile(FilePath, std::ios::out | std::ios::trunc);
+	if (!OutFile.is_open())
+		return false;
+
+	//Microseconds from the start of the run, one track for the passes of each lane and one per worker
+	auto ToMicro = [this](double Seconds) { return (Seconds - SessionBegin) * 1000000.0; };
+	auto PassTrack = [](int Lane) { return Lane * 1000; };
+	auto WorkerTrack = [](int Lane, int Worker) { return Lane * 1000 + 1 + Worker; };
+
+	OutFile << std::fixed << std::setprecision(3);
+	OutFile << "{\"traceEvents\":[" << std::endl;
+	OutFile << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Processer\"}}";
+
+	std::vector<int> NamedTracks;
+	auto NameTrack = [&](int Track, const std::string& Name)
+	{
+		if (std::find(NamedTracks.begin(), NamedTracks.end(), Track) != NamedTracks.end())
+			return;
+		NamedTracks.push_back(Track);
+		OutFile << "," << std::endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << Track << ",\"args\":{\"name\":\"" << Name << "\"}}";
+		OutFile << "," << std::endl << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << Track << ",\"args\":{\"sort_index\":" << Track << "}}";
+	};
+
+	for (int i = 0; i < PassList.size(); i++)
+	{
+		PassProfile& Pass = PassList[i];
+		NameTrack(PassTrack(Pass.Lane), "Lane " + std::to_string(Pass.Lane) + " Passes");
+
+		OutFile << "," << std::endl << "{\"name\":\"" << EscapeJson(Pass.Name) << "\",\"cat\":\"Pass\",\"ph\":\"X\",\"pid\":1,\"tid\":" << PassTrack(Pass.Lane)
+			<< ",\"ts\":" << ToMicro(Pass.Begin) << ",\"dur\":" << Pass.WallSeconds * 1000000.0
+			<< ",\"args\":{\"pass\":" << Pass.PassIndex << ",\"items\":" << Pass.ItemNum << ",\"items_per_second\":" << Pass.ItemsPerSecond
+			<< ",\"cpu_ms\":" << Pass.CpuSeconds * 1000.0 << ",\"setup_ms\":" << Pass.SetupSeconds * 1000.0
+			<< ",\"utilization\":" << Pass.Utilization << ",\"success\":" << (Pass.Success ? "true" : "false") << "}}";
+	}
+
+	for (int i = 0; i < TraceItems.size(); i++)
+	{
+		TraceItem& Item = TraceItems[i];
+		int Track = WorkerTrack(Item.Lane, Item.Timing.Worker);
+		NameTrack(Track, "Lane " + std::to_string(Item.Lane) + " Worker " + std::to_string(Item.Timing.Worker));
+
+		std::string PassName = "Pass" + std::to_string(Item.PassIndex);
+		for (int j = 0; j < PassList.size(); j++)
+		{
+			if (PassList[j].PassIndex == Item.PassIndex)
+				PassName = PassList[j].Name;
+		}
+
+		OutFile << "," << std::endl << "{\"name\":\"" << EscapeJson(PassName) << "\",\"cat\":\"Quest\",\"ph\":\"X\",\"pid\":1,\"tid\":" << Track
+			<< ",\"ts\":" << ToMicro(Item.Timing.Begin) << ",\"dur\":" << Item.Timing.Duration * 1000000.0
+			<< ",\"args\":{\"cpu_us\":" << Item.Timing.CpuDuration * 1000000.0 << "}}";
+	}
+
+	OutFile << std::endl << "]}" << std::endl;
+	OutFile.close();
+
+	return true;
+}
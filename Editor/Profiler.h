@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "ThreadProcesser.h"
+
+
+struct PassProfile
+{
+	PassProfile() :
+		PassIndex(0),
+		Lane(0),
+		WorkerNum(0),
+		Begin(0.0),
+		WallSeconds(0.0),
+		SetupSeconds(0.0),
+		SetupCpuSeconds(0.0),
+		BusySeconds(0.0),
+		CpuSeconds(0.0),
+		CallNum(0),
+		ItemNum(0),
+		ItemsPerSecond(0.0),
+		Utilization(0.0),
+		Success(false)
+	{}
+
+	std::string Name;
+	int PassIndex;
+	int Lane;
+	int WorkerNum;
+
+	//PlatformTime::Seconds()
+	double Begin;
+	double WallSeconds;
+
+	//The PassType function itself, on the thread that launched the pass
+	double SetupSeconds;
+	double SetupCpuSeconds;
+
+	//Summed over the workers
+	double BusySeconds;
+	//Workers + setup
+	double CpuSeconds;
+
+	UINT32 CallNum;
+	UINT32 ItemNum;
+	double ItemsPerSecond;
+	//BusySeconds / (WallSeconds * WorkerNum)
+	double Utilization;
+
+	bool Success;
+};
+
+
+/*
+* Collects pass timings of one generation run.
+* Needs ThreadProcesser::SetProfiling(true) on the lanes for the per item numbers.
+*/
+class Profiler
+{
+public:
+	Profiler();
+
+	//Start a new run, drop the last one
+	void Reset();
+
+	//Fill the worker side of Pass from one stage of Lane, Lane may be nullptr if the pass never kicked
+	void AddPass(PassProfile& Pass, const ThreadProcesser* Lane, int Stage);
+
+	const std::vector<PassProfile>& GetPassList() const
+	{
+		return PassList;
+	}
+
+	void PrintReport();
+	//chrome://tracing or ui.perfetto.dev
+	bool ExportChromeTrace(const std::filesystem::path& FilePath);
+
+private:
+	struct TraceItem
+	{
+		QuestTiming Timing;
+		int Lane;
+		int PassIndex;
+	};
+
+	std::vector<PassProfile> PassList;
+	std::vector<TraceItem> TraceItems;
+	double SessionBegin;
+};
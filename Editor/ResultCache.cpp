@@ -0,0 +1,253 @@
+#include "ResultCache.h"
+#include "ByteStream.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+#define CACHE_MAGIC 0x48434554
+#define CACHE_VERSION 2
+#define CACHE_HEADER_SIZE 48
+
+
+ResultCache::ResultCache(const std::filesystem::path& InDirectory, UINT64 InMaxBytes) :
+	Directory(InDirectory),
+	MaxBytes(InMaxBytes),
+	TotalBytes(0),
+	HitCounter(0),
+	MissCounter(0)
+{
+	std::error_code Error;
+	std::filesystem::create_directories(Directory, Error);
+
+	//Rebuild the order from the file times left by the last run
+	std::vector<std::pair<std::filesystem::file_time_type, size_t>> Found;
+	for (auto& Item : std::filesystem::directory_iterator(Directory, Error))
+	{
+		if (!Item.is_regular_file() || Item.path().extension() != ".cache")
+			continue;
+
+		std::string Stem = Item.path().stem().string();
+		char* End = nullptr;
+		size_t Key = (size_t)strtoull(Stem.c_str(), &End, 16);
+		if (Stem.size() != 16 || End != Stem.c_str() + Stem.size())
+			continue;
+		Found.push_back(std::make_pair(Item.last_write_time(), Key));
+
+		Entry NewEntry;
+		NewEntry.Size = (UINT64)Item.file_size();
+		EntryMap[Key] = NewEntry;
+		TotalBytes += NewEntry.Size;
+	}
+
+	std::sort(Found.begin(), Found.end());
+	for (int i = 0; i < Found.size(); i++)
+	{
+		RecentList.push_back(Found[i].second);
+		EntryMap[Found[i].second].Recent = std::prev(RecentList.end());
+	}
+
+	Evict();
+}
+
+
+std::filesystem::path ResultCache::GetEntryPath(size_t Key)
+{
+	char Name[32];
+	snprintf(Name, sizeof(Name), "%016llx.cache", (unsigned long long)Key);
+	return Directory / Name;
+}
+
+
+bool ResultCache::Load(const ResultKey& Key, std::vector<Byte>& OutData)
+{
+	std::filesystem::path EntryPath = GetEntryPath(Key.Key);
+	bool Known = false;
+	{
+		LockGuard<PlatformCriticalSection> Lock(CacheLock);
+		Known = EntryMap.find(Key.Key) != EntryMap.end();
+	}
+
+	//Not in the map may still be on disk, written by another user of the directory after we scanned it
+	std::ifstream InFile(EntryPath, std::ios::in | std::ios::binary);
+	if (!Known && !InFile.is_open())
+	{
+		MissCounter.Increment();
+		return false;
+	}
+
+	Byte Header[CACHE_HEADER_SIZE];
+	bool Valid = InFile.read((char*)Header, CACHE_HEADER_SIZE).good();
+	bool Collided = false;
+	size_t PayloadSize = 0;
+
+	if (Valid)
+	{
+		//Magic, version, key, input hash, param hash, input size, payload size
+		ByteReader Reader(Header, CACHE_HEADER_SIZE);
+		std::uint32_t Magic = Reader.ReadUint32();
+		std::uint32_t Version = Reader.ReadUint32();
+		ResultKey StoredKey;
+		StoredKey.Key = (size_t)Reader.ReadUint64();
+		StoredKey.InputHash = (size_t)Reader.ReadUint64();
+		StoredKey.ParamHash = (size_t)Reader.ReadUint64();
+		StoredKey.InputSize = Reader.ReadUint64();
+		PayloadSize = (size_t)Reader.ReadUint64();
+		Valid = Magic == CACHE_MAGIC
+			&& Version == CACHE_VERSION
+			&& StoredKey.Key == Key.Key;
+
+		//A good file for another input, leave it to its owner
+		Collided = Valid && !(StoredKey == Key);
+
+		if (Valid && !Collided)
+		{
+			OutData.resize(PayloadSize);
+			Valid = PayloadSize == 0 || InFile.read((char*)OutData.data(), PayloadSize).good();
+		}
+	}
+	InFile.close();
+
+	if (Collided)
+	{
+		OutData.clear();
+		MissCounter.Increment();
+		return false;
+	}
+
+	if (!Valid)
+	{
+		//Truncated or written by another version, drop it
+		LockGuard<PlatformCriticalSection> Lock(CacheLock);
+		auto Found = EntryMap.find(Key.Key);
+		if (Found != EntryMap.end())
+		{
+			TotalBytes -= Found->second.Size;
+			RecentList.erase(Found->second.Recent);
+			EntryMap.erase(Found);
+		}
+		std::error_code Error;
+		std::filesystem::remove(EntryPath, Error);
+
+		MissCounter.Increment();
+		return false;
+	}
+
+	if (!Known)
+		AddEntry(Key.Key, (UINT64)PayloadSize + CACHE_HEADER_SIZE);
+
+	Touch(Key.Key);
+	HitCounter.Increment();
+	return true;
+}
+
+
+bool ResultCache::Store(const ResultKey& Key, const std::vector<Byte>& Data)
+{
+	std::filesystem::path EntryPath = GetEntryPath(Key.Key);
+	std::filesystem::path TempPath = EntryPath;
+	//Unique per call, several threads or machines may write the same key at once
+	TempPath += "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "_" + std::to_string((size_t)&Data) + ".tmp";
+
+	UINT64 PayloadSize = (UINT64)Data.size();
+
+	//Write aside and rename, a reader never sees half a file
+	std::ofstream OutFile(TempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	{
+		ByteWriter Writer(OutFile, CACHE_HEADER_SIZE);
+		Writer.WriteUint32(CACHE_MAGIC);
+		Writer.WriteUint32(CACHE_VERSION);
+		Writer.WriteUint64((UINT64)Key.Key);
+		Writer.WriteUint64((UINT64)Key.InputHash);
+		Writer.WriteUint64((UINT64)Key.ParamHash);
+		Writer.WriteUint64(Key.InputSize);
+		Writer.WriteUint64(PayloadSize);
+		Writer.WriteArray(Data);
+	}
+	bool Success = OutFile.good();
+	OutFile.close();
+
+	std::error_code Error;
+	if (Success)
+	{
+		std::filesystem::rename(TempPath, EntryPath, Error);
+		Success = !Error;
+	}
+	if (!Success)
+	{
+		std::filesystem::remove(TempPath, Error);
+		return false;
+	}
+
+	AddEntry(Key.Key, PayloadSize + CACHE_HEADER_SIZE);
+	return true;
+}
+
+
+void ResultCache::AddEntry(size_t Key, UINT64 Size)
+{
+	LockGuard<PlatformCriticalSection> Lock(CacheLock);
+	auto Found = EntryMap.find(Key);
+	if (Found != EntryMap.end())
+	{
+		TotalBytes -= Found->second.Size;
+		RecentList.erase(Found->second.Recent);
+	}
+
+	RecentList.push_back(Key);
+	Entry& NewEntry = EntryMap[Key];
+	NewEntry.Recent = std::prev(RecentList.end());
+	NewEntry.Size = Size;
+	TotalBytes += NewEntry.Size;
+
+	Evict();
+}
+
+
+void ResultCache::Touch(size_t Key)
+{
+	LockGuard<PlatformCriticalSection> Lock(CacheLock);
+	auto Found = EntryMap.find(Key);
+	if (Found == EntryMap.end())
+		return;
+
+	RecentList.splice(RecentList.end(), RecentList, Found->second.Recent);
+
+	//Keep the file time in step so the order survives a restart and other users of the directory
+	std::error_code Error;
+	std::filesystem::last_write_time(GetEntryPath(Key), std::filesystem::file_time_type::clock::now(), Error);
+}
+
+
+void ResultCache::Evict()
+{
+	LockGuard<PlatformCriticalSection> Lock(CacheLock);
+	while (TotalBytes > MaxBytes && RecentList.size() > 1)
+	{
+		size_t Key = RecentList.front();
+		RecentList.pop_front();
+
+		auto Found = EntryMap.find(Key);
+		TotalBytes -= Found->second.Size;
+		EntryMap.erase(Found);
+
+		std::error_code Error;
+		std::filesystem::remove(GetEntryPath(Key), Error);
+	}
+}
+
+
+void ResultCache::Clear()
+{
+	LockGuard<PlatformCriticalSection> Lock(CacheLock);
+	for (auto& Item : EntryMap)
+	{
+		std::error_code Error;
+		std::filesystem::remove(GetEntryPath(Item.first), Error);
+	}
+	EntryMap.clear();
+	RecentList.clear();
+	TotalBytes = 0;
+}
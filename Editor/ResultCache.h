@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <filesystem>
+
+#include "Utils.h"
+#include "ThreadProcesser.h"
+
+
+/*
+* Everything a cached result depends on, written into the file and compared on load,
+* so two inputs whose 64 bit Key collides miss instead of getting each other's result.
+*/
+struct ResultKey
+{
+	ResultKey() :
+		Key(0),
+		InputHash(0),
+		ParamHash(0),
+		InputSize(0)
+	{}
+	ResultKey(size_t InInputHash, size_t InParamHash, UINT64 InInputSize) :
+		Key(HashCombine2(InInputHash, InParamHash)),
+		InputHash(InInputHash),
+		ParamHash(InParamHash),
+		InputSize(InInputSize)
+	{}
+
+	bool IsValid() const
+	{
+		return Key != 0;
+	}
+	bool operator==(const ResultKey& Other) const
+	{
+		return Key == Other.Key && InputHash == Other.InputHash && ParamHash == Other.ParamHash && InputSize == Other.InputSize;
+	}
+
+	//Names the file
+	size_t Key;
+	//Content hash of what the pass reads
+	size_t InputHash;
+	//Pass name, version and settings
+	size_t ParamHash;
+	//Bytes the input hash covers
+	UINT64 InputSize;
+};
+
+
+
+/*
+* Content addressed cache of pass outputs on disk.
+* One file per key, named by the key, so a directory can be shared between machines.
+* Least recently used files are removed once the directory grows over MaxBytes.
+*/
+class ResultCache
+{
+public:
+	ResultCache(const std::filesystem::path& InDirectory, UINT64 InMaxBytes = 1024ull * 1024ull * 1024ull);
+
+	/****Call in Any Thread****/
+	//A file whose stored key differs from Key in any field is a miss
+	bool Load(const ResultKey& Key, std::vector<Byte>& OutData);
+	bool Store(const ResultKey& Key, const std::vector<Byte>& Data);
+
+	void Clear();
+
+	UINT64 GetTotalBytes() const
+	{
+		return TotalBytes;
+	}
+	UINT32 GetHitNum() const
+	{
+		return (UINT32)HitCounter.GetCounter();
+	}
+	UINT32 GetMissNum() const
+	{
+		return (UINT32)MissCounter.GetCounter();
+	}
+	const std::filesystem::path& GetDirectory() const
+	{
+		return Directory;
+	}
+
+private:
+	std::filesystem::path GetEntryPath(size_t Key);
+	//Most recently used, replaces the entry of Key if there is one
+	void AddEntry(size_t Key, UINT64 Size);
+	void Touch(size_t Key);
+	void Evict();
+
+private:
+	struct Entry
+	{
+		std::list<size_t>::iterator Recent;
+		UINT64 Size;
+	};
+
+	std::filesystem::path Directory;
+	UINT64 MaxBytes;
+	UINT64 TotalBytes;
+
+	PlatformCriticalSection CacheLock;
+	//Front is the least recently used
+	std::list<size_t> RecentList;
+	std::unordered_map<size_t, Entry> EntryMap;
+
+	AtomicCounter HitCounter;
+	AtomicCounter MissCounter;
+};
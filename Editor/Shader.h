@@ -10,16 +10,32 @@ static const char* InternalShader =
 #ifndef DRAW_NORMAL\n\
 #define DRAW_NORMAL 0\n\
 #endif\n\
+#ifndef PACKED_VERTEX\n\
+#define PACKED_VERTEX 0\n\
+#endif\n\
 \n\
 cbuffer ConstantBuffer : register(b0)\n\
 {\n\
 	float4x4 WorldViewProjection;\n\
 };\n\
 \n\
+cbuffer MeshConstants : register(b1)\n\
+{\n\
+	float3 QuantizeOffset;\n\
+	float Pad0;\n\
+	float3 QuantizeScale;\n\
+	float Pad1;\n\
+};\n\
+\n\
 struct VSInput\n\
 {\n\
+#if PACKED_VERTEX\n\
+	float4 position : POSITION;\n\
+	float2 normal : NORMAL;\n\
+#else\n\
 	float3 position : POSITION;\n\
 	float3 normal : NORMAL;\n\
+#endif\n\
 	float4 color : COLOR0;\n\
 };\n\
 struct VSOutput\n\
@@ -29,12 +45,25 @@ struct VSOutput\n\
 	float3 color : TEXCOORD1;\n\
 };\n\
 \n\
+float3 DecodeOctahedral(float2 e)\n\
+{\n\
+	float3 n = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));\n\
+	float t = saturate(-n.z);\n\
+	n.xy += n.xy >= 0.0f ? -t : t;\n\
+	return normalize(n);\n\
+}\n\
+\n\
 VSOutput VSMain(VSInput input)\n\
 {\n\
 	VSOutput output = (VSOutput)0;\n\
 \n\
+#if PACKED_VERTEX\n\
+	float4 positionLocal = float4(QuantizeOffset + input.position.xyz * QuantizeScale, 1.0f);\n\
+	output.normal = DecodeOctahedral(input.normal);\n\
+#else\n\
 	float4 positionLocal = float4(input.position, 1.0f);\n\
 	output.normal = normalize(input.normal);\n\
+#endif\n\
 #if DRAW_WIREFRAME\n\
 	positionLocal.xyz = positionLocal.xyz + output.normal.xyz * 0.0001f;\n\
 #endif\n\
@@ -1,33 +1,18 @@
 #include "ThreadProcesser.h"
 #include <iostream>
-#include <intrin.h>
 #include <utility>
 
-template <typename GuardObject>
-class LockGuard
-{
-public:
-	explicit
-		LockGuard(GuardObject& InObjRef) :
-		ObjRef(InObjRef)
-	{
-		ObjRef.Lock();
-	}
-
-	~LockGuard()
-	{
-		ObjRef.UnLock();
-	}
-
-	LockGuard(const LockGuard& Other) = delete;
-	LockGuard& operator=(const LockGuard&) = delete;
-
-private:
-	LockGuard() {}
+#if defined(_WIN32)
+#include <intrin.h>
+#else
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
 
-private:
-	GuardObject& ObjRef;
-};
 
 Thread* Thread::Create(Runnable* ObjectToRun,
 	UINT32 InitStackSize,
@@ -36,7 +21,7 @@ Thread* Thread::Create(Runnable* ObjectToRun,
 {
 
 	Thread* NewThread = nullptr;
-	NewThread = WindowsThread::CreateThread();
+	NewThread = PlatformThread::CreateThread();
 
 	if (NewThread)
 	{
@@ -53,6 +38,57 @@ Thread* Thread::Create(Runnable* ObjectToRun,
 
 
 
+#if defined(_WIN32)
+const UINT32 PlatformAffinity::GetNumberOfCores()
+{
+	SYSTEM_INFO Info;
+	::GetSystemInfo(&Info);
+	return Info.dwNumberOfProcessors > 0 ? Info.dwNumberOfProcessors : 1;
+}
+
+
+void PlatformProcess::Sleep(UINT32 Milliseconds)
+{
+	::Sleep(Milliseconds);
+}
+
+
+void PlatformProcess::YieldThread()
+{
+	::SwitchToThread();
+}
+
+
+double PlatformTime::Seconds()
+{
+	static double SecondsPerCycle = 0.0;
+	if (SecondsPerCycle == 0.0)
+	{
+		LARGE_INTEGER Frequency;
+		::QueryPerformanceFrequency(&Frequency);
+		SecondsPerCycle = 1.0 / (double)Frequency.QuadPart;
+	}
+
+	LARGE_INTEGER Cycles;
+	::QueryPerformanceCounter(&Cycles);
+	return (double)Cycles.QuadPart * SecondsPerCycle;
+}
+
+
+double PlatformTime::ThreadCpuSeconds()
+{
+	FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+	if (!::GetThreadTimes(::GetCurrentThread(), &CreationTime, &ExitTime, &KernelTime, &UserTime))
+		return 0.0;
+
+	//100 nanosecond ticks
+	UINT64 Kernel = ((UINT64)KernelTime.dwHighDateTime << 32) | KernelTime.dwLowDateTime;
+	UINT64 User = ((UINT64)UserTime.dwHighDateTime << 32) | UserTime.dwLowDateTime;
+	return (double)(Kernel + User) * 1e-7;
+}
+
+
+
 bool WindowsThread::PlatformInit(Runnable* ObjectToRun,
 	UINT32 InitStackSize,
 	ThreadPriority InitPriority,
@@ -175,60 +211,397 @@ UINT32 WindowsThread::Run()
 
 	return Result;
 }
+#else
+const UINT32 PlatformAffinity::GetNumberOfCores()
+{
+	long Cores = ::sysconf(_SC_NPROCESSORS_ONLN);
+	return Cores > 0 ? (UINT32)Cores : 1;
+}
 
 
-static void* InterlockedExchangePtr(void** Dest, void* Exchange)
+void PlatformProcess::Sleep(UINT32 Milliseconds)
 {
-	return (void*)InterlockedExchange64((long long*)Dest, (long long)Exchange);
+	::usleep((useconds_t)Milliseconds * 1000);
 }
 
 
+void PlatformProcess::YieldThread()
+{
+	::sched_yield();
+}
 
 
-ThreadProcesser::ThreadProcesser() :
-	WriterThreadPtr(nullptr),
-	StopTrigger(0),
-	WorkingCounter(0),
-	ReportCounter(0),
-	CurrentQuestPos(0),
-	RunFunc(nullptr),
-	Progress(0.0),
-	ProgressPerQuest(0.0),
-	IntervalTime(0.0)
+double PlatformTime::Seconds()
 {
+	struct timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (double)Now.tv_sec + (double)Now.tv_nsec * 1e-9;
+}
+
 
-	InterlockedExchangePtr((void**)&WriterThreadPtr, WindowsThread::Create(this, 0, ThreadPriority::Normal));
+double PlatformTime::ThreadCpuSeconds()
+{
+	struct timespec Now;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &Now) != 0)
+		return 0.0;
+	return (double)Now.tv_sec + (double)Now.tv_nsec * 1e-9;
 }
 
 
-ThreadProcesser::~ThreadProcesser()
+
+bool PosixEvent::Wait(UINT32 WaitTime)
+{
+	pthread_mutex_lock(&Mutex);
+
+	if (WaitTime == INFINITE)
+	{
+		while (!Triggered)
+			pthread_cond_wait(&Condition, &Mutex);
+	}
+	else if (!Triggered)
+	{
+		timespec Deadline;
+		clock_gettime(CLOCK_REALTIME, &Deadline);
+		Deadline.tv_sec += WaitTime / 1000;
+		Deadline.tv_nsec += (long)(WaitTime % 1000) * 1000000;
+		if (Deadline.tv_nsec >= 1000000000)
+		{
+			Deadline.tv_sec++;
+			Deadline.tv_nsec -= 1000000000;
+		}
+
+		while (!Triggered)
+		{
+			if (pthread_cond_timedwait(&Condition, &Mutex, &Deadline) == ETIMEDOUT)
+				break;
+		}
+	}
+
+	bool Result = Triggered;
+	if (!ManualReset)
+		Triggered = false;
+
+	pthread_mutex_unlock(&Mutex);
+	return Result;
+}
+
+
+
+bool PosixThread::PlatformInit(Runnable* ObjectToRun,
+	UINT32 InitStackSize,
+	ThreadPriority InitPriority,
+	UINT64 AffinityMask)
+{
+	RunObject = ObjectToRun;
+	ThreadAffinityMask = AffinityMask;
+
+	pthread_attr_t Attribute;
+	pthread_attr_init(&Attribute);
+	if (InitStackSize > 0)
+	{
+		pthread_attr_setstacksize(&Attribute, InitStackSize);
+	}
+
+	ThreadCreated = pthread_create(&ThreadHandle, &Attribute, ThreadEntrance, this) == 0;
+	pthread_attr_destroy(&Attribute);
+
+	if (!ThreadCreated)
+	{
+		RunObject = nullptr;
+	}
+	else
+	{
+		pthread_setname_np(ThreadHandle, "ProcesserWorker");
+
+		//Here will wait for Runnable's Init() finish
+		SyncEvent.Wait();
+
+		SetThreadPriority(InitPriority);
+	}
+
+	return ThreadCreated;
+}
+
+
+void PosixThread::SetThreadPriority(ThreadPriority PriorityToSet)
 {
-	if (WriterThreadPtr != nullptr)
+	Priority = PriorityToSet;
+
+	int NiceValue = 0;
+	switch (PriorityToSet)
 	{
-		delete WriterThreadPtr;
-		WriterThreadPtr = nullptr;
+	case ThreadPriority::AboveNormal: NiceValue = -2; break;
+	case ThreadPriority::BelowNormal: NiceValue = 2; break;
+	case ThreadPriority::Highest:     NiceValue = -5; break;
+	case ThreadPriority::Lowest:      NiceValue = 5; break;
+	default:
+		NiceValue = 0;
 	}
+
+	//On Linux the nice value is per thread, failure only means no privilege to raise it
+	::setpriority(PRIO_PROCESS, (id_t)ThreadID, NiceValue);
 }
 
 
-bool ThreadProcesser::Init()
+bool PosixThread::Kill(bool WaitUntilExit)
 {
+	if (RunObject)
+	{
+		RunObject->Stop();
+	}
+
+	if (ThreadCreated && !ThreadJoined)
+	{
+		if (WaitUntilExit == true)
+			pthread_join(ThreadHandle, nullptr);
+		else
+			pthread_detach(ThreadHandle);
+		ThreadJoined = true;
+	}
+
+	ThreadCreated = false;
+
 	return true;
 }
 
 
-UINT32 ThreadProcesser::Run()
+void PosixThread::WaitForComplete()
 {
-	while (StopTrigger.GetCounter() == 0)
+	if (ThreadCreated && !ThreadJoined)
+	{
+		pthread_join(ThreadHandle, nullptr);
+		ThreadJoined = true;
+	}
+}
+
+
+
+
+UINT32 PosixThread::RunWrapper()
+{
+	UINT32 Result = 0;
+
+	ThreadID = (UINT32)::syscall(SYS_gettid);
+
+	//All bits set means any core, leave the default mask so machines over 64 cores are not capped
+	if (ThreadAffinityMask != 0 && ThreadAffinityMask != 0xFFFFFFFFFFFFFFFF)
 	{
-		if (WorkingCounter.GetCounter() > 0)
+		cpu_set_t CpuSet;
+		CPU_ZERO(&CpuSet);
+		for (int i = 0; i < 64 && i < CPU_SETSIZE; i++)
 		{
-			InternelDoRequest();
-			::Sleep(IntervalTime);
+			if (ThreadAffinityMask & (1ull << i))
+				CPU_SET(i, &CpuSet);
 		}
-		else
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &CpuSet);
+	}
+
+	try
+	{
+		Result = Run();
+	}
+	catch (...)
+	{
+		std::cerr << "Error occurred on running Thread !!" << std::endl;
+		::_exit(1);
+	}
+
+	return Result;
+}
+
+
+
+UINT32 PosixThread::Run()
+{
+	UINT32 Result = 1;
+
+	if (RunObject->Init())
+	{
+		//Set waiting point here
+		SyncEvent.Trigger();
+
+		Result = RunObject->Run();
+
+		RunObject->Exit();
+	}
+	else
+	{
+		//Set waiting point here
+		SyncEvent.Trigger();
+	}
+
+	return Result;
+}
+#endif
+
+
+
+bool StreamStage::Push(void* Data, bool* OutWasEmpty)
+{
+	LockGuard<PlatformCriticalSection> Lock(QueueLock);
+	UINT32 Count = (UINT32)Counter.GetCounter();
+	if (Count >= Buffer.size())
+		return false;
+
+	Buffer[(Head + Count) % Buffer.size()] = Data;
+	Counter.Increment();
+	*OutWasEmpty = (Count == 0);
+	return true;
+}
+
+
+bool StreamStage::Pop(void** OutData, bool* OutHasMore)
+{
+	if (Counter.GetCounter() == 0)
+		return false;
+
+	LockGuard<PlatformCriticalSection> Lock(QueueLock);
+	if (Counter.GetCounter() == 0)
+		return false;
+
+	*OutData = Buffer[Head];
+	Head = (Head + 1) % Buffer.size();
+	*OutHasMore = Counter.Decrement() > 0;
+	return true;
+}
+
+
+void StreamStage::Reset()
+{
+	LockGuard<PlatformCriticalSection> Lock(QueueLock);
+	Head = 0;
+	Counter.Reset();
+}
+
+
+
+
+ThreadWorker::ThreadWorker(ThreadProcesser* InOwner, int InIndex) :
+	Owner(InOwner),
+	Index(InIndex),
+	RangeBegin(0),
+	RangeEnd(0),
+	ResultChannel(4096),
+	OverflowCounter(0),
+	CurrentStage(-1),
+	CurrentData(nullptr)
+{
+}
+
+
+ThreadWorker::~ThreadWorker()
+{
+}
+
+
+void ThreadWorker::WakeUp()
+{
+	Owner->Pool->WakeUp(Index);
+}
+
+
+void ThreadWorker::RecordCall(int Stage, double BeginTime, double BeginCpuTime, bool Finished)
+{
+	//Keep the trace bounded on huge inputs, the totals stay exact
+	static const size_t MaxTimings = 65536;
+
+	QuestTiming Timing;
+	Timing.Begin = BeginTime;
+	Timing.Duration = PlatformTime::Seconds() - BeginTime;
+	Timing.CpuDuration = PlatformTime::ThreadCpuSeconds() - BeginCpuTime;
+	Timing.Stage = Stage;
+	Timing.Worker = Index;
+
+	StageStat& Stat = Profile.Stages[Stage];
+	Stat.BusySeconds += Timing.Duration;
+	Stat.CpuSeconds += Timing.CpuDuration;
+	Stat.CallNum++;
+	Stat.ItemNum += Finished ? 1 : 0;
+
+	if (Profile.Timings.size() < MaxTimings)
+		Profile.Timings.push_back(Timing);
+}
+
+
+void ThreadWorker::AssignRange(int Begin, int End)
+{
+	LockGuard<PlatformCriticalSection> Lock(RangeLock);
+	RangeBegin = Begin;
+	RangeEnd = End;
+}
+
+
+void ThreadWorker::ClearRange()
+{
+	LockGuard<PlatformCriticalSection> Lock(RangeLock);
+	RangeBegin = RangeEnd = 0;
+}
+
+
+bool ThreadWorker::PopQuest(int* OutQuestIndex)
+{
+	LockGuard<PlatformCriticalSection> Lock(RangeLock);
+	if (RangeBegin >= RangeEnd)
+		return false;
+
+	*OutQuestIndex = RangeBegin++;
+	return true;
+}
+
+
+bool ThreadWorker::StealHalf(int* OutBegin, int* OutEnd)
+{
+	LockGuard<PlatformCriticalSection> Lock(RangeLock);
+	int Remaining = RangeEnd - RangeBegin;
+	if (Remaining <= 0)
+		return false;
+
+	//Take the back half, the owner keeps walking from the front
+	int Half = (Remaining + 1) / 2;
+	*OutBegin = RangeEnd - Half;
+	*OutEnd = RangeEnd;
+	RangeEnd -= Half;
+	return true;
+}
+
+
+
+
+PoolThread::PoolThread(ThreadPool* InPool, int InIndex) :
+	Pool(InPool),
+	WorkerThread(nullptr),
+	Index(InIndex),
+	StopTrigger(0),
+	WakeEvent(false),
+	ScanCounter(0)
+{
+}
+
+
+PoolThread::~PoolThread()
+{
+	if (WorkerThread != nullptr)
+	{
+		delete WorkerThread;
+		WorkerThread = nullptr;
+	}
+}
+
+
+bool PoolThread::Init()
+{
+	return true;
+}
+
+
+UINT32 PoolThread::Run()
+{
+	while (StopTrigger.GetCounter() == 0)
+	{
+		if (!Pool->DoRequest(this))
 		{
-			::Sleep(10);
+			//Nothing left to pop or steal anywhere, sleep until next Kick() or Stop()
+			WakeEvent.Wait();
 		}
 	}
 
@@ -236,60 +609,425 @@ UINT32 ThreadProcesser::Run()
 }
 
 
-void ThreadProcesser::Stop()
+void PoolThread::Stop()
 {
 	StopTrigger.Increment();
+	WakeEvent.Trigger();
+}
+
+
+bool PoolThread::Start()
+{
+	WorkerThread = Thread::Create(this, 0, ThreadPriority::Normal);
+	return WorkerThread != nullptr;
+}
+
+
+void PoolThread::WakeUp()
+{
+	WakeEvent.Trigger();
+}
+
+
+void PoolThread::Join()
+{
+	if (WorkerThread != nullptr)
+		WorkerThread->WaitForComplete();
+}
+
+
+void PoolThread::WaitForScan()
+{
+	INT32 Scan = ScanCounter.GetCounter();
+	while ((Scan & 1) != 0 && ScanCounter.GetCounter() == Scan)
+	{
+		PlatformProcess::YieldThread();
+	}
+}
+
+
+
+
+ThreadPool::ThreadPool(UINT32 ThreadNum) :
+	ProcesserNum(0)
+{
+	if (ThreadNum == 0)
+		ThreadNum = PlatformAffinity::GetNumberOfCores();
+
+	for (int i = 0; i < MaxProcesserNum; i++)
+	{
+		Processers[i].store(nullptr);
+	}
+
+	for (UINT32 i = 0; i < ThreadNum; i++)
+	{
+		PoolThread* Worker = new PoolThread(this, (int)Threads.size());
+		if (Worker->Start())
+		{
+			Threads.push_back(Worker);
+		}
+		else
+		{
+			std::cout << "Create Worker Thread Failed." << std::endl;
+			delete Worker;
+		}
+	}
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	for (int i = 0; i < Threads.size(); i++)
+	{
+		Threads[i]->Stop();
+	}
+	for (int i = 0; i < Threads.size(); i++)
+	{
+		Threads[i]->Join();
+	}
+	for (int i = 0; i < Threads.size(); i++)
+	{
+		delete Threads[i];
+	}
+	Threads.clear();
+}
+
+
+bool ThreadPool::Attach(ThreadProcesser* Processer)
+{
+	LockGuard<PlatformCriticalSection> Lock(AttachLock);
+	int Num = ProcesserNum.load();
+	for (int i = 0; i < Num; i++)
+	{
+		if (Processers[i].load() == nullptr)
+		{
+			Processers[i].store(Processer);
+			return true;
+		}
+	}
+	if (Num >= MaxProcesserNum)
+		return false;
+
+	Processers[Num].store(Processer);
+	ProcesserNum.store(Num + 1);
+	return true;
+}
+
+
+void ThreadPool::Detach(ThreadProcesser* Processer)
+{
+	{
+		LockGuard<PlatformCriticalSection> Lock(AttachLock);
+		int Num = ProcesserNum.load();
+		for (int i = 0; i < Num; i++)
+		{
+			if (Processers[i].load() == Processer)
+				Processers[i].store(nullptr);
+		}
+	}
+
+	//A thread that read the slot before it was cleared may still be inside
+	for (int i = 0; i < Threads.size(); i++)
+	{
+		Threads[i]->WaitForScan();
+	}
+}
+
+
+void ThreadPool::WakeUp(int ThreadIndex)
+{
+	Threads[ThreadIndex]->WakeUp();
+}
+
+
+bool ThreadPool::DoRequest(PoolThread* Worker)
+{
+	Worker->ScanCounter.Increment();
+
+	bool DidWork = false;
+	double IntervalTime = 0.0;
+	int Num = ProcesserNum.load();
+	for (int i = 0; i < Num; i++)
+	{
+		ThreadProcesser* Processer = Processers[i].load();
+		if (Processer == nullptr || Processer->WorkingCounter.GetCounter() == 0)
+			continue;
+
+		if (Processer->InternelDoRequest(Processer->Workers[Worker->GetIndex()]))
+		{
+			DidWork = true;
+			double ProcesserInterval = Processer->IntervalTime.load();
+			if (ProcesserInterval > IntervalTime)
+				IntervalTime = ProcesserInterval;
+		}
+	}
+
+	Worker->ScanCounter.Increment();
+
+	if (IntervalTime > 0.0)
+		PlatformProcess::Sleep((UINT32)IntervalTime);
+	return DidWork;
+}
+
+
+
+
+ThreadProcesser::ThreadProcesser(UINT32 WorkerNum) :
+	Pool(new ThreadPool(WorkerNum)),
+	OwnPool(true),
+	WorkingCounter(0),
+	FinishedCounter(0),
+	ActiveCounter(0),
+	CancelTrigger(0),
+	CompleteEvent(true),
+	RunFunc(nullptr),
+	NextResultWorker(0),
+	Progress(0.0),
+	ProgressPerQuest(0.0),
+	RangeKick(false),
+	IntervalTime(0.0),
+	Profiling(false)
+{
+	AttachToPool();
+}
+
+
+ThreadProcesser::ThreadProcesser(ThreadPool* SharedPool) :
+	Pool(SharedPool),
+	OwnPool(false),
+	WorkingCounter(0),
+	FinishedCounter(0),
+	ActiveCounter(0),
+	CancelTrigger(0),
+	CompleteEvent(true),
+	RunFunc(nullptr),
+	NextResultWorker(0),
+	Progress(0.0),
+	ProgressPerQuest(0.0),
+	RangeKick(false),
+	IntervalTime(0.0),
+	Profiling(false)
+{
+	AttachToPool();
+}
+
+
+void ThreadProcesser::AttachToPool()
+{
+	CompleteEvent.Trigger();
+
+	//Workers first, a thread may look at them as soon as we are attached
+	for (UINT32 i = 0; i < Pool->GetThreadNum(); i++)
+	{
+		Workers.push_back(new ThreadWorker(this, (int)i));
+	}
+
+	if (!Pool->Attach(this))
+	{
+		std::cout << "Attach To Thread Pool Failed." << std::endl;
+		for (int i = 0; i < Workers.size(); i++)
+		{
+			delete Workers[i];
+		}
+		Workers.clear();
+	}
+}
+
+
+ThreadProcesser::~ThreadProcesser()
+{
+	Clear();
+
+	//No thread may be left in here before any worker is freed, a late thief may still read its range
+	if (!Workers.empty())
+		Pool->Detach(this);
+	if (OwnPool)
+		delete Pool;
+	Pool = nullptr;
+
+	for (int i = 0; i < Workers.size(); i++)
+	{
+		delete Workers[i];
+	}
+	Workers.clear();
+
+	ClearStages();
 }
 
 
 
 
 bool ThreadProcesser::Kick()
+{
+	return StartKick(false);
+}
+
+
+bool ThreadProcesser::StartKick(bool Range)
 {
 	if (IsWorking()) {
 		std::cout << "Kick Failed: IS WORKING" << std::endl;
 		return false;
 	}
-	if (RunFunc == nullptr)
+	if (RunFunc == nullptr || Workers.empty())
 	{
 		return false;
 	}
 
-	LockGuard<WindowsCriticalSection> Lock(CriticalSection);
+	WaitForIdleWorkers();
+	FinishedCounter.Reset();
+	Progress.store(0.0);
+	RangeKick = Range;
+
+	for (int i = 0; i < Workers.size(); i++)
+	{
+		Workers[i]->Profile.Stages.assign(GetStageNum(), StageStat());
+		Workers[i]->Profile.Timings.clear();
+	}
+
+	if (QuestList.size() == 0)
+	{
+		Progress.store(1.0);
+		CompleteEvent.Trigger();
+		return true;
+	}
+
+	CompleteEvent.Reset();
 
-	ResultList = std::queue<void*>();
+	//Every item goes through every stage, each stage is an equal share of the progress
+	ProgressPerQuest = 1.0 / ((double)QuestList.size() * (double)GetStageNum());
 
-	CurrentQuestPos = 0;
-	Progress = 0.0;
-	ProgressPerQuest = 1.0 / (double)QuestList.size();
+	//Split the quests evenly, unbalanced items are picked up by stealing
+	int QuestNum = (int)QuestList.size();
+	int WorkerNum = (int)Workers.size();
+	for (int i = 0; i < WorkerNum; i++)
+	{
+		Workers[i]->CurrentStage = -1;
+		Workers[i]->CurrentData = nullptr;
+		Workers[i]->AssignRange((int)((INT64)QuestNum * i / WorkerNum), (int)((INT64)QuestNum * (i + 1) / WorkerNum));
+	}
 
 	WorkingCounter.Increment();
 
+	for (int i = 0; i < WorkerNum; i++)
+	{
+		Workers[i]->WakeUp();
+	}
+
 	return true;
 }
 
 
+bool ThreadProcesser::KickRange(int ItemNum, std::function<void(int, int)> RangeFunc, int ChunkSize)
+{
+	if (IsWorking()) {
+		std::cout << "Kick Failed: IS WORKING" << std::endl;
+		return false;
+	}
+	if (Workers.empty())
+	{
+		return false;
+	}
+	if (!Stages.empty())
+	{
+		//Chunks are not items, nothing downstream could use them
+		std::cout << "Kick Failed: range can't feed stream stages" << std::endl;
+		return false;
+	}
+
+	//A few chunks per worker leaves room for stealing on uneven items
+	if (ChunkSize <= 0)
+	{
+		int ChunkNum = (int)Workers.size() * 8;
+		ChunkSize = ItemNum > ChunkNum ? ItemNum / ChunkNum : 1;
+	}
+
+	WaitForIdleWorkers();
+
+	//Chunk index + 1 as the quest, a chunk is done after one call and has no result
+	QuestList.clear();
+	int ChunkNum = (ItemNum + ChunkSize - 1) / ChunkSize;
+	for (int i = 0; i < ChunkNum; i++)
+	{
+		QuestList.push_back((void*)(intptr_t)(i + 1));
+	}
+
+	RunFunc = [RangeFunc, ItemNum, ChunkSize](void* Data, double* Progress) -> void*
+	{
+		int Begin = ((int)(intptr_t)Data - 1) * ChunkSize;
+		int End = Begin + ChunkSize;
+		RangeFunc(Begin, End < ItemNum ? End : ItemNum);
+		*Progress = 1.0;
+		return nullptr;
+	};
+
+	return StartKick(true);
+}
+
+
 bool ThreadProcesser::IsWorking()
 {
-	LockGuard<WindowsCriticalSection> Lock(CriticalSection);
-	bool a = WorkingCounter.GetCounter() > 0;
-	bool b = ResultList.size() > 0;
+	//Read the counter first, results are pushed before it drops to zero
+	if (WorkingCounter.GetCounter() > 0)
+		return true;
 
-	return a || b;
+	for (int i = 0; i < Workers.size(); i++)
+	{
+		if (!Workers[i]->ResultChannel.IsEmpty() || Workers[i]->OverflowCounter.GetCounter() > 0)
+			return true;
+	}
+	return false;
 }
 
 void* ThreadProcesser::GetResult(double* OutCurrentProcess)
 {
-	LockGuard<WindowsCriticalSection> Lock(CriticalSection);
-
-	*OutCurrentProcess = Progress;
+	*OutCurrentProcess = Progress.load(std::memory_order_acquire);
 
 	void* ResultData = nullptr;
-	if (ResultList.size() > 0) {
-		ResultData = ResultList.front();
-		ResultList.pop();
+	int WorkerNum = (int)Workers.size();
+	for (int i = 0; i < WorkerNum; i++)
+	{
+		int Index = (NextResultWorker + i) % WorkerNum;
+		if (Workers[Index]->ResultChannel.Pop(&ResultData))
+		{
+			NextResultWorker = (Index + 1) % WorkerNum;
+			return ResultData;
+		}
+	}
+
+	for (int i = 0; i < WorkerNum; i++)
+	{
+		ThreadWorker* Worker = Workers[i];
+		if (Worker->OverflowCounter.GetCounter() > 0)
+		{
+			LockGuard<PlatformCriticalSection> Lock(Worker->OverflowLock);
+			ResultData = Worker->OverflowResults.front();
+			Worker->OverflowResults.pop_front();
+			Worker->OverflowCounter.Decrement();
+			return ResultData;
+		}
 	}
-	return ResultData;
+	return nullptr;
+}
+
+size_t ThreadProcesser::DrainResults(std::vector<void*>& OutResults)
+{
+	size_t DrainedNum = 0;
+	for (int i = 0; i < Workers.size(); i++)
+	{
+		ThreadWorker* Worker = Workers[i];
+		DrainedNum += Worker->ResultChannel.PopAll(OutResults);
+
+		if (Worker->OverflowCounter.GetCounter() > 0)
+		{
+			LockGuard<PlatformCriticalSection> Lock(Worker->OverflowLock);
+			DrainedNum += Worker->OverflowResults.size();
+			OutResults.insert(OutResults.end(), Worker->OverflowResults.begin(), Worker->OverflowResults.end());
+			Worker->OverflowResults.clear();
+			Worker->OverflowCounter.Reset();
+		}
+	}
+	return DrainedNum;
 }
 
 void ThreadProcesser::AddData(void* Data)
@@ -301,56 +1039,203 @@ void ThreadProcesser::AddData(void* Data)
 
 void ThreadProcesser::Clear()
 {
-	if (IsWorking()) 
+	if (WorkingCounter.GetCounter() > 0)
 	{
-		Stop();
+		//Drop the quests nobody picked up yet and wait for the running calls
+		CancelTrigger.SetCounter(1);
+		for (int i = 0; i < Workers.size(); i++)
+		{
+			Workers[i]->ClearRange();
+		}
+		while (ActiveCounter.GetCounter() > 0)
+		{
+			PlatformProcess::Sleep(1);
+		}
+
+		WorkingCounter.Reset();
+		for (int i = 0; i < Workers.size(); i++)
+		{
+			Workers[i]->CurrentStage = -1;
+			Workers[i]->CurrentData = nullptr;
+		}
+		CancelTrigger.Reset();
+		CompleteEvent.Trigger();
 	}
-	::Sleep(1.0);
 
 	QuestList.clear();
-	ResultList = std::queue<void*>();
+	for (int i = 0; i < Stages.size(); i++)
+	{
+		Stages[i]->Reset();
+	}
+	for (int i = 0; i < Workers.size(); i++)
+	{
+		Workers[i]->ResultChannel.Reset();
+
+		LockGuard<PlatformCriticalSection> Lock(Workers[i]->OverflowLock);
+		Workers[i]->OverflowResults.clear();
+		Workers[i]->OverflowCounter.Reset();
+	}
 }
 
+bool ThreadProcesser::WaitForComplete(UINT32 WaitTime)
+{
+	return CompleteEvent.Wait(WaitTime);
+}
 
-void ThreadProcesser::InternelDoRequest()
+void ThreadProcesser::AddStage(std::function<void* (void*, double*)>& ToRun, UINT32 BufferSize)
 {
-	if (QuestList.size() == 0) {
-		Progress = 1.0;
+	if (IsWorking()) return;
+
+	Stages.push_back(new StreamStage(ToRun, BufferSize));
+}
+
+void ThreadProcesser::ClearStages()
+{
+	if (IsWorking()) return;
+
+	for (int i = 0; i < Stages.size(); i++)
+	{
+		delete Stages[i];
 	}
-	else if(CurrentQuestPos < QuestList.size())
+	Stages.clear();
+}
+
+
+void ThreadProcesser::WaitForIdleWorkers()
+{
+	while (ActiveCounter.GetCounter() > 0)
 	{
-		void* SourceData = QuestList[CurrentQuestPos];
-		double ProgressPerRun = 0.0;
-		void* DestData = RunFunc(SourceData, &ProgressPerRun);
+		PlatformProcess::YieldThread();
+	}
+}
 
-		Progress += ProgressPerRun * ProgressPerQuest;
 
-		if (DestData != nullptr)
+bool ThreadProcesser::StealQuest(ThreadWorker* Thief)
+{
+	int WorkerNum = (int)Workers.size();
+	for (int i = 1; i < WorkerNum; i++)
+	{
+		ThreadWorker* Victim = Workers[(Thief->GetIndex() + i) % WorkerNum];
+
+		int Begin = 0;
+		int End = 0;
+		if (Victim->StealHalf(&Begin, &End))
 		{
-			LockGuard<WindowsCriticalSection> Lock(CriticalSection);
-			ResultList.push(DestData);
-			CurrentQuestPos++;
+			Thief->CurrentStage = 0;
+			Thief->CurrentData = QuestList[Begin];
+			Thief->AssignRange(Begin + 1, End);
+			return true;
 		}
+	}
+
+	return false;
+}
 
+
+bool ThreadProcesser::PopStageItem(ThreadWorker* Worker)
+{
+	//Later stages first, so items leave the pipeline and the buffers stay short
+	for (int i = (int)Stages.size() - 1; i >= 0; i--)
+	{
+		bool HasMore = false;
+		if (Stages[i]->Pop(&Worker->CurrentData, &HasMore))
+		{
+			Worker->CurrentStage = i + 1;
+			if (HasMore)
+				Workers[(Worker->GetIndex() + 1) % Workers.size()]->WakeUp();
+			return true;
+		}
 	}
 
-	if (Progress > 1.0 && CurrentQuestPos < QuestList.size())
+	return false;
+}
+
+
+bool ThreadProcesser::InternelDoRequest(ThreadWorker* Worker)
+{
+	ActiveCounter.Increment();
+	//Leave CurrentStage/CurrentData alone here, Clear() resets them once we are out
+	//and after the last quest they belong to the next Kick()
+	if (CancelTrigger.GetCounter() > 0 || WorkingCounter.GetCounter() == 0)
 	{
-		std::cout << "Progress Over 1.0 But QuestList Not Finish" << std::endl;
-		std::cout << CurrentQuestPos << "|" << QuestList.size() << std::endl;
+		ActiveCounter.Decrement();
+		return false;
 	}
-	if (Progress < 1.0 && CurrentQuestPos > QuestList.size())
+
+	if (Worker->CurrentStage < 0 && !PopStageItem(Worker))
 	{
-		std::cout << "Progress less 1.0 But QuestList Over" << std::endl;
-		std::cout << CurrentQuestPos << "|" << QuestList.size() << std::endl;
+		int QuestIndex = -1;
+		if (Worker->PopQuest(&QuestIndex))
+		{
+			Worker->CurrentStage = 0;
+			Worker->CurrentData = QuestList[QuestIndex];
+		}
+		else if (!StealQuest(Worker))
+		{
+			ActiveCounter.Decrement();
+			return false;
+		}
 	}
 
-	if (CurrentQuestPos >= QuestList.size())
+	//Read before our quest is counted, the client may Clear() right after the last one
+	INT32 QuestNum = (INT32)QuestList.size();
+	int StageIndex = Worker->CurrentStage;
+	std::function<void* (void*, double*)>& StageFunc = (StageIndex == 0) ? RunFunc : Stages[StageIndex - 1]->RunFunc;
+	double ProgressPerRun = 0.0;
+
+	bool Profile = Profiling.load(std::memory_order_relaxed);
+	double BeginTime = Profile ? PlatformTime::Seconds() : 0.0;
+	double BeginCpuTime = Profile ? PlatformTime::ThreadCpuSeconds() : 0.0;
+
+	void* DestData = StageFunc(Worker->CurrentData, &ProgressPerRun);
+	//Range chunks finish in one call, nullptr there is not "call again"
+	bool Finished = DestData != nullptr || RangeKick;
+
+	//Before the item is handed on, the last one may complete the Kick
+	if (Profile)
+		Worker->RecordCall(StageIndex, BeginTime, BeginCpuTime, Finished);
+
+	double Current = Progress.load(std::memory_order_relaxed);
+	while (!Progress.compare_exchange_weak(Current, Current + ProgressPerRun * ProgressPerQuest, std::memory_order_release, std::memory_order_relaxed));
+
+	if (DestData != nullptr && StageIndex < Stages.size())
 	{
-		Progress = 1.0;
-		WorkingCounter.Decrement();
+		//Hand it to the next stage, or keep going on it ourselves if that stage is backed up
+		//Let go of it first, once pushed another worker may finish the Kick and the client Kick again
+		Worker->CurrentStage = -1;
+		Worker->CurrentData = nullptr;
+		bool WasEmpty = false;
+		if (Stages[StageIndex]->Push(DestData, &WasEmpty))
+		{
+			if (WasEmpty)
+				Workers[(Worker->GetIndex() + 1) % Workers.size()]->WakeUp();
+		}
+		else
+		{
+			Worker->CurrentStage = StageIndex + 1;
+			Worker->CurrentData = DestData;
+		}
+	}
+	else if (Finished)
+	{
+		if (DestData != nullptr && (Worker->OverflowCounter.GetCounter() > 0 || !Worker->ResultChannel.Push(DestData)))
+		{
+			//Client is behind, spill instead of waiting for it
+			LockGuard<PlatformCriticalSection> Lock(Worker->OverflowLock);
+			Worker->OverflowResults.push_back(DestData);
+			Worker->OverflowCounter.Increment();
+		}
+		Worker->CurrentStage = -1;
+		Worker->CurrentData = nullptr;
 
+		if (FinishedCounter.Increment() >= QuestNum)
+		{
+			Progress.store(1.0, std::memory_order_release);
+			WorkingCounter.Decrement();
+			CompleteEvent.Trigger();
+		}
 	}
 
+	ActiveCounter.Decrement();
+	return true;
 }
-
@@ -2,11 +2,31 @@
 
 #include <string>
 #include <queue>
+#include <deque>
 #include <vector>
+
+#if defined(_WIN32)
 #define NOMINMAX
 #include <windows.h>
+#else
+#include <pthread.h>
+#include <stdint.h>
+
+typedef uint32_t UINT32;
+typedef int32_t INT32;
+typedef uint64_t UINT64;
+typedef int64_t INT64;
+
+#ifndef INFINITE
+#define INFINITE 0xFFFFFFFF
+#endif
+#ifndef __forceinline
+#define __forceinline inline __attribute__((always_inline))
+#endif
+#endif
 
 #include <functional>
+#include <atomic>
 
 /************************************
 Base Thread interface
@@ -27,6 +47,25 @@ struct PlatformAffinity
 	{
 		return 0xFFFFFFFFFFFFFFFF;
 	}
+
+	static const UINT32 GetNumberOfCores();
+};
+
+
+struct PlatformProcess
+{
+	static void Sleep(UINT32 Milliseconds);
+
+	//Give up the rest of the time slice
+	static void YieldThread();
+};
+
+struct PlatformTime
+{
+	//Monotonic wall clock
+	static double Seconds();
+	//CPU time spent by the calling thread, user + kernel
+	static double ThreadCpuSeconds();
 };
 
 enum class ThreadPriority
@@ -58,6 +97,7 @@ public:
 };
 
 
+#if defined(_WIN32)
 class WindowsCriticalSection
 {
 public:
@@ -104,6 +144,241 @@ private:
 
 
 
+class WindowsEvent
+{
+public:
+	WindowsEvent(bool ManualReset = false)
+	{
+		Event = ::CreateEvent(NULL, ManualReset, FALSE, nullptr);
+	}
+
+	~WindowsEvent()
+	{
+		if (Event != NULL)
+		{
+			CloseHandle(Event);
+			Event = NULL;
+		}
+	}
+
+	void Trigger()
+	{
+		::SetEvent(Event);
+	}
+
+	void Reset()
+	{
+		::ResetEvent(Event);
+	}
+
+	//Return false if timeout
+	bool Wait(UINT32 WaitTime = INFINITE)
+	{
+		return ::WaitForSingleObject(Event, WaitTime) == WAIT_OBJECT_0;
+	}
+
+	WindowsEvent(const WindowsEvent& Other) = delete;
+	WindowsEvent& operator=(const WindowsEvent& Other) = delete;
+
+private:
+	HANDLE Event;
+};
+#else
+class PosixCriticalSection
+{
+public:
+	__forceinline PosixCriticalSection()
+	{
+		//Recursive like CRITICAL_SECTION
+		pthread_mutexattr_t Attribute;
+		pthread_mutexattr_init(&Attribute);
+		pthread_mutexattr_settype(&Attribute, PTHREAD_MUTEX_RECURSIVE);
+		pthread_mutex_init(&Mutex, &Attribute);
+		pthread_mutexattr_destroy(&Attribute);
+	}
+
+	__forceinline ~PosixCriticalSection()
+	{
+		pthread_mutex_destroy(&Mutex);
+	}
+
+
+	__forceinline void Lock()
+	{
+		pthread_mutex_lock(&Mutex);
+	}
+
+
+	__forceinline
+		void UnLock()
+	{
+		pthread_mutex_unlock(&Mutex);
+	}
+
+
+	__forceinline
+		bool TryLock()
+	{
+		return pthread_mutex_trylock(&Mutex) == 0;
+	}
+
+	PosixCriticalSection(const PosixCriticalSection& Other) = delete;
+	PosixCriticalSection& operator=(const PosixCriticalSection& Other) = delete;
+
+private:
+	pthread_mutex_t Mutex;
+};
+
+
+
+class PosixEvent
+{
+public:
+	PosixEvent(bool InManualReset = false) :
+		ManualReset(InManualReset),
+		Triggered(false)
+	{
+		pthread_mutex_init(&Mutex, nullptr);
+		pthread_cond_init(&Condition, nullptr);
+	}
+
+	~PosixEvent()
+	{
+		pthread_cond_destroy(&Condition);
+		pthread_mutex_destroy(&Mutex);
+	}
+
+	void Trigger()
+	{
+		pthread_mutex_lock(&Mutex);
+		Triggered = true;
+		if (ManualReset)
+			pthread_cond_broadcast(&Condition);
+		else
+			pthread_cond_signal(&Condition);
+		pthread_mutex_unlock(&Mutex);
+	}
+
+	void Reset()
+	{
+		pthread_mutex_lock(&Mutex);
+		Triggered = false;
+		pthread_mutex_unlock(&Mutex);
+	}
+
+	//Return false if timeout
+	bool Wait(UINT32 WaitTime = INFINITE);
+
+	PosixEvent(const PosixEvent& Other) = delete;
+	PosixEvent& operator=(const PosixEvent& Other) = delete;
+
+private:
+	pthread_mutex_t Mutex;
+	pthread_cond_t Condition;
+	bool ManualReset;
+	bool Triggered;
+};
+#endif
+
+
+#if defined(_WIN32)
+struct WindowsAtomics
+{
+	static INT32 Increment(volatile INT32* Value)
+	{
+		return (INT32)::InterlockedIncrement((long*)Value);
+	}
+
+	static INT32 Decrement(volatile INT32* Value)
+	{
+		return (INT32)::InterlockedDecrement((long*)Value);
+	}
+
+	//Return the new value
+	static INT32 Add(volatile INT32* Value, INT32 Amount)
+	{
+		return (INT32)::InterlockedAdd((long*)Value, (long)Amount);
+	}
+
+	//Return the old value
+	static INT32 Exchange(volatile INT32* Value, INT32 NewValue)
+	{
+		return (INT32)::InterlockedExchange((long*)Value, (long)NewValue);
+	}
+
+	static INT32 Read(volatile const INT32* Value)
+	{
+		return (INT32)::InterlockedCompareExchange((long*)const_cast<INT32*>(Value), 0, 0);
+	}
+};
+typedef WindowsAtomics PlatformAtomics;
+typedef WindowsCriticalSection PlatformCriticalSection;
+typedef WindowsEvent PlatformEvent;
+#else
+struct PosixAtomics
+{
+	static INT32 Increment(volatile INT32* Value)
+	{
+		return __atomic_add_fetch(Value, 1, __ATOMIC_SEQ_CST);
+	}
+
+	static INT32 Decrement(volatile INT32* Value)
+	{
+		return __atomic_sub_fetch(Value, 1, __ATOMIC_SEQ_CST);
+	}
+
+	//Return the new value
+	static INT32 Add(volatile INT32* Value, INT32 Amount)
+	{
+		return __atomic_add_fetch(Value, Amount, __ATOMIC_SEQ_CST);
+	}
+
+	//Return the old value
+	static INT32 Exchange(volatile INT32* Value, INT32 NewValue)
+	{
+		return __atomic_exchange_n(Value, NewValue, __ATOMIC_SEQ_CST);
+	}
+
+	static INT32 Read(volatile const INT32* Value)
+	{
+		return __atomic_load_n(Value, __ATOMIC_SEQ_CST);
+	}
+};
+typedef PosixAtomics PlatformAtomics;
+typedef PosixCriticalSection PlatformCriticalSection;
+typedef PosixEvent PlatformEvent;
+#endif
+
+
+
+template <typename GuardObject>
+class LockGuard
+{
+public:
+	explicit
+		LockGuard(GuardObject& InObjRef) :
+		ObjRef(InObjRef)
+	{
+		ObjRef.Lock();
+	}
+
+	~LockGuard()
+	{
+		ObjRef.UnLock();
+	}
+
+	LockGuard(const LockGuard& Other) = delete;
+	LockGuard& operator=(const LockGuard&) = delete;
+
+private:
+	LockGuard() {}
+
+private:
+	GuardObject& ObjRef;
+};
+
+
+
 class AtomicCounter
 {
 
@@ -123,49 +398,49 @@ public:
 
 	INT32 operator=(INT32 Val)
 	{
-		InterlockedExchange((long*)&Counter, (long)Val);
+		PlatformAtomics::Exchange(&Counter, Val);
 		return GetCounter();
 	}
 
 	INT32 GetCounter() const
 	{
-		return InterlockedCompareExchange((long*)&const_cast<AtomicCounter*>(this)->Counter, 0, 0);
+		return PlatformAtomics::Read(&Counter);
 	}
 
 
 	void SetCounter(INT32 Val)
 	{
-		InterlockedExchange((long*)&Counter, (long)Val);
+		PlatformAtomics::Exchange(&Counter, Val);
 	}
 
 
 	void Reset()
 	{
-		InterlockedExchange((long*)&Counter, 0);
+		PlatformAtomics::Exchange(&Counter, 0);
 	}
 
 
 	INT32 Increment()
 	{
-		return InterlockedIncrement((long*)&Counter);
+		return PlatformAtomics::Increment(&Counter);
 	}
 
 
 	INT32 Add(INT32 AddValue)
 	{
-		return InterlockedAdd((long*)&Counter, (long)AddValue);
+		return PlatformAtomics::Add(&Counter, AddValue);
 	}
 
 
 	INT32 Decrement()
 	{
-		return InterlockedDecrement((long*)&Counter);
+		return PlatformAtomics::Decrement(&Counter);
 	}
 
 
 	INT32 Sub(INT32 SubValue)
 	{
-		return InterlockedAdd((long*)&Counter, (long)-SubValue);
+		return PlatformAtomics::Add(&Counter, -SubValue);
 	}
 
 protected:
@@ -175,6 +450,97 @@ protected:
 
 
 
+/*
+* Bounded lock-free ring for exactly one producer thread and one consumer thread.
+* Capacity is rounded up to a power of two.
+*/
+template <typename ElementType>
+class SPSCRingBuffer
+{
+public:
+	SPSCRingBuffer(UINT32 InCapacity = 1024) :
+		Head(0),
+		Tail(0)
+	{
+		UINT32 Capacity = 1;
+		while (Capacity < InCapacity)
+			Capacity <<= 1;
+
+		Buffer.resize(Capacity);
+		Mask = Capacity - 1;
+	}
+
+	SPSCRingBuffer(const SPSCRingBuffer& Other) = delete;
+	SPSCRingBuffer& operator=(const SPSCRingBuffer& Other) = delete;
+
+	/****Call in Producer****/
+	//Return false if full
+	bool Push(const ElementType& Element)
+	{
+		size_t CurrentTail = Tail.load(std::memory_order_relaxed);
+		if (CurrentTail - Head.load(std::memory_order_acquire) > Mask)
+			return false;
+
+		Buffer[CurrentTail & Mask] = Element;
+		Tail.store(CurrentTail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/****Call in Consumer****/
+	//Return false if empty
+	bool Pop(ElementType* OutElement)
+	{
+		size_t CurrentHead = Head.load(std::memory_order_relaxed);
+		if (CurrentHead == Tail.load(std::memory_order_acquire))
+			return false;
+
+		*OutElement = Buffer[CurrentHead & Mask];
+		Head.store(CurrentHead + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Move everything ready in one go, return how many
+	size_t PopAll(std::vector<ElementType>& OutElements)
+	{
+		size_t CurrentHead = Head.load(std::memory_order_relaxed);
+		size_t CurrentTail = Tail.load(std::memory_order_acquire);
+		for (size_t i = CurrentHead; i != CurrentTail; i++)
+		{
+			OutElements.push_back(Buffer[i & Mask]);
+		}
+		Head.store(CurrentTail, std::memory_order_release);
+		return CurrentTail - CurrentHead;
+	}
+
+	/****Call in Any Thread****/
+	bool IsEmpty() const
+	{
+		return Head.load(std::memory_order_acquire) == Tail.load(std::memory_order_acquire);
+	}
+
+	size_t Size() const
+	{
+		return Tail.load(std::memory_order_acquire) - Head.load(std::memory_order_acquire);
+	}
+
+	//Only when both sides are idle
+	void Reset()
+	{
+		Head.store(0, std::memory_order_relaxed);
+		Tail.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	//Keep the two indices on separate cache lines
+	alignas(64) std::atomic<size_t> Head;
+	alignas(64) std::atomic<size_t> Tail;
+	std::vector<ElementType> Buffer;
+	size_t Mask;
+};
+
+
+
+
 class Thread
 {
 public:
@@ -230,6 +596,7 @@ protected:
 
 };
 
+#if defined(_WIN32)
 class WindowsThread : public Thread
 {
 public:
@@ -309,15 +676,214 @@ protected:
 	HANDLE ThreadHandle;
 	HANDLE SyncEvent;
 };
+typedef WindowsThread PlatformThread;
+#else
+class PosixThread : public Thread
+{
+public:
+	static Thread* CreateThread()
+	{
+		return new PosixThread();
+	}
+
+	virtual ~PosixThread()
+	{
+		if (ThreadCreated)
+		{
+			Kill(true);
+		}
+	}
+
+
+	//Mapped to the nice value of this thread, raising it needs CAP_SYS_NICE
+	void SetThreadPriority(ThreadPriority PriorityToSet) override;
+
+	//pthreads can not suspend another thread
+	void Pause() override {}
+	void Resume() override {}
+
+	bool Kill(bool WaitUntilExit = true) override;
+
+	void WaitForComplete() override;
+
+
+protected:
+	PosixThread() :
+		ThreadHandle(),
+		ThreadCreated(false),
+		ThreadJoined(false),
+		SyncEvent(false)
+	{}
+
+	UINT32 RunWrapper();
+	UINT32 Run();
+
+	bool PlatformInit(Runnable* ObjectToRun,
+		UINT32 InitStackSize = 0,
+		ThreadPriority InitPriority = ThreadPriority::Normal,
+		UINT64 AffinityMask = PlatformAffinity::GetNormalThradMask()) override;
+
+	static void* ThreadEntrance(void* Object)
+	{
+		((PosixThread*)Object)->RunWrapper();
+		return nullptr;
+	}
+
+
+
+protected:
+	pthread_t ThreadHandle;
+	bool ThreadCreated;
+	bool ThreadJoined;
+	PosixEvent SyncEvent;
+};
+typedef PosixThread PlatformThread;
+#endif
 
 
 
+class ThreadProcesser;
+class ThreadPool;
 
-class ThreadProcesser :public Runnable
+/*
+* A stage chained after the ThreadProcesser RunFunc.
+* Results of the previous stage are queued here and picked up by any worker,
+* so consecutive passes run on different items at the same time.
+* The queue is bounded, a worker that finds it full runs the item itself.
+*/
+class StreamStage
 {
 public:
-	ThreadProcesser();
-	~ThreadProcesser();
+	StreamStage(std::function<void* (void*, double*)>& InRunFunc, UINT32 InCapacity) :
+		RunFunc(InRunFunc),
+		Head(0),
+		Counter(0)
+	{
+		Buffer.resize(InCapacity > 0 ? InCapacity : 1);
+	}
+
+	/****Call in Any Worker****/
+	//Return false if full
+	bool Push(void* Data, bool* OutWasEmpty);
+	//Return false if empty
+	bool Pop(void** OutData, bool* OutHasMore);
+
+	/****Call in Client****/
+	//Only when no worker is running
+	void Reset();
+
+public:
+	std::function<void* (void*, double*)> RunFunc;
+
+private:
+	PlatformCriticalSection QueueLock;
+	std::vector<void*> Buffer;
+	UINT32 Head;
+	AtomicCounter Counter;
+};
+
+
+
+//One RunFunc call, only kept while profiling
+struct QuestTiming
+{
+	double Begin;
+	double Duration;
+	double CpuDuration;
+	int Stage;
+	int Worker;
+};
+
+struct StageStat
+{
+	StageStat() :
+		BusySeconds(0.0),
+		CpuSeconds(0.0),
+		CallNum(0),
+		ItemNum(0)
+	{}
+
+	double BusySeconds;
+	double CpuSeconds;
+	UINT32 CallNum;
+	UINT32 ItemNum;
+};
+
+//Written by its worker during a Kick, read by the client once IsWorking() is false
+struct WorkerProfile
+{
+	std::vector<StageStat> Stages;
+	std::vector<QuestTiming> Timings;
+};
+
+
+
+/*
+* One worker of a ThreadProcesser, run by the pool thread of the same index.
+* Owns a range of quest indices, pops from the front of its own range
+* and steals the back half of another worker's range when it runs dry.
+*/
+class ThreadWorker
+{
+public:
+	ThreadWorker(ThreadProcesser* InOwner, int InIndex);
+	~ThreadWorker();
+
+	/****Call in Client****/
+	void WakeUp();
+	void AssignRange(int Begin, int End);
+	void ClearRange();
+
+	/****Call in Any Worker****/
+	bool PopQuest(int* OutQuestIndex);
+	bool StealHalf(int* OutBegin, int* OutEnd);
+
+	int GetIndex() const
+	{
+		return Index;
+	}
+
+	/****Call in Thread****/
+	void RecordCall(int Stage, double BeginTime, double BeginCpuTime, bool Finished);
+
+private:
+	ThreadProcesser* Owner;
+	int Index;
+
+	PlatformCriticalSection RangeLock;
+	int RangeBegin;
+	int RangeEnd;
+
+	//Worker -> client, one channel per worker so nobody shares a lock
+	SPSCRingBuffer<void*> ResultChannel;
+
+	//Only used when the channel is full, so a client blocked in WaitForComplete() can't stall the worker.
+	//Results keep going here until the client emptied it, so they still come out in order
+	PlatformCriticalSection OverflowLock;
+	std::deque<void*> OverflowResults;
+	AtomicCounter OverflowCounter;
+
+	//Item being processed and its stage, RunFunc may need several calls to finish one
+	int CurrentStage;
+	void* CurrentData;
+
+	WorkerProfile Profile;
+
+	friend class ThreadProcesser;
+};
+
+
+
+/*
+* One thread of a ThreadPool.
+* Runs a quest of every ThreadProcesser on the pool in turn, as the worker of its own index,
+* and sleeps once none of them has anything left.
+*/
+class PoolThread :public Runnable
+{
+public:
+	PoolThread(ThreadPool* InPool, int InIndex);
+	~PoolThread();
 
 	/****Call in Thread****/
 	bool Init() override;
@@ -325,44 +891,179 @@ public:
 	void Stop() override;
 
 	/****Call in Client****/
+	bool Start();
+	void WakeUp();
+	void Join();
+	//Return once a scan of the processers running at the call is over
+	void WaitForScan();
+
+	int GetIndex() const
+	{
+		return Index;
+	}
+
+private:
+	ThreadPool* Pool;
+	Thread* WorkerThread;
+	int Index;
+
+	AtomicCounter StopTrigger;
+	PlatformEvent WakeEvent;
+	//Odd while the thread looks at the processers of the pool
+	AtomicCounter ScanCounter;
+
+	friend class ThreadPool;
+};
+
+
+
+/*
+* Threads shared by several ThreadProcessers, so processers kicked at the same time
+* split the cores between them instead of each bringing a thread per core.
+*/
+class ThreadPool
+{
+public:
+	//ThreadNum == 0 means one thread per core
+	ThreadPool(UINT32 ThreadNum = 0);
+	//Every processer must be detached first
+	~ThreadPool();
+
+	UINT32 GetThreadNum() const
+	{
+		return (UINT32)Threads.size();
+	}
+
+	/****Call in Client****/
+	//Return false if the pool is full
+	bool Attach(ThreadProcesser* Processer);
+	//Return once no thread can still be in Processer
+	void Detach(ThreadProcesser* Processer);
+	void WakeUp(int ThreadIndex);
+
+private:
+	/****Call in Thread****/
+	//One quest of every working processer, return false if there was nothing to do
+	bool DoRequest(PoolThread* Worker);
+
+private:
+	static const int MaxProcesserNum = 64;
+
+	std::vector<PoolThread*> Threads;
+
+	PlatformCriticalSection AttachLock;
+	//Slots of detached processers are nullptr until reused
+	std::atomic<ThreadProcesser*> Processers[MaxProcesserNum];
+	std::atomic<int> ProcesserNum;
+
+	friend class PoolThread;
+};
+
+
+
+class ThreadProcesser
+{
+public:
+	//Threads of its own, WorkerNum == 0 means one worker per core
+	ThreadProcesser(UINT32 WorkerNum = 0);
+	//On the threads of SharedPool, which must outlive this
+	ThreadProcesser(ThreadPool* SharedPool);
+	~ThreadProcesser();
+
+	/****Call in Client****/
+	//Only one client thread may call these
 	bool Kick();
+	//Split [0, ItemNum) into chunks and call RangeFunc(Begin, End) once per chunk
+	//Replaces QuestList and RunFunc, ChunkSize <= 0 picks one for the worker count
+	//Chunks give no results, completion shows in GetProgress(), IsWorking() and WaitForComplete()
+	bool KickRange(int ItemNum, std::function<void(int, int)> RangeFunc, int ChunkSize = 0);
 	bool IsWorking();
 	void* GetResult(double* OutCurrentProcess);
+	//Append every result that is ready to OutResults, return how many
+	size_t DrainResults(std::vector<void*>& OutResults);
+	double GetProgress() const
+	{
+		return Progress.load(std::memory_order_acquire);
+	}
 	void AddData(void* Data);
 	void Clear();
+	//Block until the kicked quests are all done, return false if timeout
+	//Results may still be waiting in GetResult() after this returns
+	bool WaitForComplete(UINT32 WaitTime = INFINITE);
 	void SetRunFunc(std::function<void* (void*, double*)>& ToRun)
 	{
 		RunFunc = ToRun;
 	}
+	//Chain a stage after RunFunc, or after the last chained stage
+	//BufferSize caps how many items may wait between the two stages
+	void AddStage(std::function<void* (void*, double*)>& ToRun, UINT32 BufferSize);
+	void ClearStages();
+	UINT32 GetStageNum() const
+	{
+		return (UINT32)Stages.size() + 1;
+	}
 	void SetIntervalTime(double Time)
 	{
 		IntervalTime = Time;
 	}
+	UINT32 GetWorkerNum() const
+	{
+		return (UINT32)Workers.size();
+	}
+	//Time every RunFunc call from the next Kick() on
+	void SetProfiling(bool Enable)
+	{
+		Profiling.store(Enable);
+	}
+	bool IsProfiling() const
+	{
+		return Profiling.load();
+	}
+	//Only valid once IsWorking() is false
+	const WorkerProfile& GetWorkerProfile(int WorkerIndex) const
+	{
+		return Workers[WorkerIndex]->Profile;
+	}
 
 private:
-	void InternelDoRequest();
+	/****Call in Worker****/
+	bool InternelDoRequest(ThreadWorker* Worker);
+	bool StealQuest(ThreadWorker* Thief);
+	bool PopStageItem(ThreadWorker* Worker);
+
+	/****Call in Client****/
+	bool StartKick(bool Range);
+	//Wait for workers still scanning for work after the last quest, before their state is reset
+	void WaitForIdleWorkers();
+	void AttachToPool();
 
 private:
-	WindowsThread* WriterThreadPtr;
-	WindowsCriticalSection CriticalSection;
+	ThreadPool* Pool;
+	bool OwnPool;
+	std::vector<ThreadWorker*> Workers;
 
-	AtomicCounter StopTrigger;
 	AtomicCounter WorkingCounter;
-	AtomicCounter ReportCounter;
+	AtomicCounter FinishedCounter;
+	AtomicCounter ActiveCounter;
+	AtomicCounter CancelTrigger;
+	PlatformEvent CompleteEvent;
 
 	std::function<void*(void*, double*)> RunFunc;
 
 	std::vector<void*> QuestList;
-	std::queue<void*> ResultList;
+	std::vector<StreamStage*> Stages;
+	int NextResultWorker;
 
-	int CurrentQuestPos;
-
-	double Progress;
+	std::atomic<double> Progress;
 	double ProgressPerQuest;
+	//Set by KickRange(), every RunFunc call finishes its quest and nothing is pushed as a result
+	bool RangeKick;
 	
-	double IntervalTime;
-
+	std::atomic<double> IntervalTime;
+	std::atomic<bool> Profiling;
 
+	friend class ThreadWorker;
+	friend class ThreadPool;
 };
 
 
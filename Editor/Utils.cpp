@@ -3,6 +3,7 @@
 
 using namespace std;
 
+#if defined(_WIN32)
 std::string ToUtf8(const std::wstring& str)
 {
 	std::string ret;
@@ -14,6 +15,41 @@ std::string ToUtf8(const std::wstring& str)
 	}
 	return ret;
 }
+#else
+//wchar_t is UTF-32 here
+std::string ToUtf8(const std::wstring& str)
+{
+	std::string ret;
+	ret.reserve(str.length());
+	for (size_t i = 0; i < str.length(); i++)
+	{
+		uint32_t c = (uint32_t)str[i];
+		if (c < 0x80)
+		{
+			ret.push_back((char)c);
+		}
+		else if (c < 0x800)
+		{
+			ret.push_back((char)(0xC0 | (c >> 6)));
+			ret.push_back((char)(0x80 | (c & 0x3F)));
+		}
+		else if (c < 0x10000)
+		{
+			ret.push_back((char)(0xE0 | (c >> 12)));
+			ret.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+			ret.push_back((char)(0x80 | (c & 0x3F)));
+		}
+		else
+		{
+			ret.push_back((char)(0xF0 | (c >> 18)));
+			ret.push_back((char)(0x80 | ((c >> 12) & 0x3F)));
+			ret.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+			ret.push_back((char)(0x80 | (c & 0x3F)));
+		}
+	}
+	return ret;
+}
+#endif
 
 unsigned int HashCombine(unsigned int A, unsigned int C)
 {
@@ -40,114 +76,36 @@ size_t HashCombine2(size_t A, size_t C)
 	return value;
 }
 
-
-
-Float3 CalculateNormal(Float3& x, Float3& y, Float3& z)
-{
-	Float3 U = y - x;
-	Float3 V = z - x;
-
-	Float3 Normal = Float3(0.0f, 0.0f, 0.0f);
-
-	Normal = Cross(U, V);
-	Normal = Normalize(Normal);
-
-	return Normal;
-}
-
-Float3 operator-(const Float3& a, const Float3& b)
-{
-	return Float3(a.x - b.x, a.y - b.y, a.z - b.z);
-}
-
-Float3 operator+(const Float3& a, const Float3& b)
-{
-	return Float3(a.x + b.x, a.y + b.y, a.z + b.z);
-}
-
-Float3 operator*(const Float3& a, const double b)
-{
-	return Float3(a.x * b, a.y * b, a.z * b);
-}
-
-Float3 operator*(const Float3& a, const Float3& b)
-{
-	return Float3(a.x * b.x, a.y * b.y, a.z * b.z);
-}
-
-Float3 operator/(const Float3& a, const double b)
-{
-	return Float3(a.x / b, a.y / b, a.z / b);
-}
-
-Float3 Normalize(const Float3& a)
-{
-	float MagInv = 1.0f / Length(a);
-	return a * MagInv;
-}
-
-float Length(const Float3& a)
+size_t HashBytes(const void* Data, size_t Size, size_t Seed)
 {
-	return MAX(0.000001f, sqrt(a.x * a.x + a.y * a.y + a.z * a.z));
-}
-
-Float3 Cross(const Float3& a, const Float3& b)
-{
-	return Float3(
-		a.y * b.z - a.z * b.y,
-		a.z * b.x - a.x * b.z,
-		a.x * b.y - a.y * b.x
-	);
-}
-
-float Dot(const Float3& a, const Float3& b)
-{
-	return a.x * b.x + a.y * b.y + a.z * b.z;
-}
-
-
+	const Byte* Src = (const Byte*)Data;
+	size_t Hash = HashCombine2(Seed, Size);
 
+	size_t Offset = 0;
+	for (; Offset + sizeof(size_t) <= Size; Offset += sizeof(size_t))
+	{
+		size_t Word = 0;
+		memcpy(&Word, Src + Offset, sizeof(size_t));
+		Hash = HashCombine2(Hash, Word);
+	}
 
+	if (Offset < Size)
+	{
+		size_t Word = 0;
+		memcpy(&Word, Src + Offset, Size - Offset);
+		Hash = HashCombine2(Hash, Word);
+	}
 
-
-
-Float2 operator-(const Float2& a, const Float2& b)
-{
-	return Float2(a.x - b.x, a.y - b.y);
-}
-
-Float2 operator+(const Float2& a, const Float2& b)
-{
-	return Float2(a.x + b.x, a.y + b.y);
-}
-
-Float2 operator*(const Float2& a, const double b)
-{
-	return Float2(a.x * b, a.y * b);
-}
-
-Float2 operator*(const Float2& a, const Float2& b)
-{
-	return Float2(a.x * b.x, a.y * b.y);
-}
-
-Float2 operator/(const Float2& a, const double b)
-{
-	return Float2(a.x / b, a.y / b);
-}
-
-Float2 Normalize(const Float2& a)
-{
-	float MagInv = 1.0f / Length(a);
-	return a * MagInv;
+	return Hash;
 }
 
-float Length(const Float2& a)
+size_t HashFinalize(size_t Hash)
 {
-	return MAX(0.000001f, sqrt(a.x * a.x + a.y * a.y));
+	uint64_t Value = (uint64_t)Hash;
+	Value ^= Value >> 33;
+	Value *= 0xff51afd7ed558ccdull;
+	Value ^= Value >> 33;
+	Value *= 0xc4ceb9fe1a85ec53ull;
+	Value ^= Value >> 33;
+	return (size_t)Value;
 }
-
-float Dot(const Float2& a, const Float2& b)
-{
-	return a.x * b.x + a.y * b.y;
-}
\ No newline at end of file
@@ -1,7 +1,16 @@
 #pragma once
 
 #include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+#include "MathTypes.h"
+
+#if defined(_WIN32)
 #include <ShObjIdl_core.h>
+#endif
 
 typedef unsigned char Byte;
 typedef unsigned int uint;
@@ -14,91 +23,10 @@ std::string ToUtf8(const std::wstring& str);
 //Not commutative
 unsigned int HashCombine(unsigned int A, unsigned int C);
 size_t HashCombine2(size_t A, size_t C);
-
-
-
-struct Float3
-{
-	Float3() :
-		x(0.0), y(0.0), z(0.0) {}
-	Float3(float a) :
-		x(a), y(a), z(a) {}
-	Float3(float _x, float _y, float _z) :
-		x(_x), y(_y), z(_z) {}
-
-	float x;
-	float y;
-	float z;
-
-	float& operator[](unsigned int i)
-	{
-		return (i == 0 ? x : (i == 1 ? y : z));
-	}
-	float& operator[](int i)
-	{
-		return (i == 0 ? x : (i == 1 ? y : z));
-	}
-	const float& operator[](unsigned int i) const
-	{
-		return (i == 0 ? x : (i == 1 ? y : z));
-	}
-	const float& operator[](int i) const
-	{
-		return (i == 0 ? x : (i == 1 ? y : z));
-	}
-
-	friend Float3 operator-(const Float3& a, const Float3& b);
-	friend Float3 operator+(const Float3& a, const Float3& b);
-	friend Float3 operator*(const Float3& a, const double b);
-	friend Float3 operator*(const Float3& a, const Float3& b);
-	friend Float3 operator/(const Float3& a, const double b);
-	friend Float3 Normalize(const Float3& a);
-	friend float Length(const Float3& a);
-	friend Float3 Cross(const Float3& a, const Float3& b);
-	friend float Dot(const Float3& a, const Float3& b);
-};
-
-Float3 CalculateNormal(Float3& x, Float3& y, Float3& z);
-
-
-struct Float2
-{
-	Float2() :
-		x(0.0), y(0.0) {}
-	Float2(float a) :
-		x(a), y(a) {}
-	Float2(float _x, float _y) :
-		x(_x), y(_y) {}
-
-	float x;
-	float y;
-
-	float& operator[](unsigned int i)
-	{
-		return (i == 0 ? x : y);
-	}
-	float& operator[](int i)
-	{
-		return (i == 0 ? x : y);
-	}
-	const float& operator[](unsigned int i) const
-	{
-		return (i == 0 ? x : y);
-	}
-	const float& operator[](int i) const
-	{
-		return (i == 0 ? x : y);
-	}
-
-	friend Float2 operator-(const Float2& a, const Float2& b);
-	friend Float2 operator+(const Float2& a, const Float2& b);
-	friend Float2 operator*(const Float2& a, const double b);
-	friend Float2 operator*(const Float2& a, const Float2& b);
-	friend Float2 operator/(const Float2& a, const double b);
-	friend Float2 Normalize(const Float2& a);
-	friend float Length(const Float2& a);
-	friend float Dot(const Float2& a, const Float2& b);
-};
+//HashCombine2 folded over a buffer, stable between runs so it can key files on disk
+size_t HashBytes(const void* Data, size_t Size, size_t Seed = 0);
+//Spread the bits of a combined hash before masking it into a power of two table
+size_t HashFinalize(size_t Hash);
 
 
 
@@ -137,13 +65,10 @@ inline float BytesToFloatLittleEndian(Byte* Src, size_t Offset)
 
 inline std::string BytesToASCIIString(Byte* Src, size_t Offset, int Length)
 {
-	char* Buffer = new char[size_t(Length) + 1];
-	memcpy(Buffer, Src + Offset, Length);
-	Buffer[Length] = '\0';
-
-	std::string Str = Buffer;
-	delete[] Buffer;
-	return std::move(Str);
+	//Stops at the first '\0' of a zero padded field
+	const char* Begin = (const char*)(Src + Offset);
+	const void* End = memchr(Begin, '\0', Length);
+	return std::string(Begin, End != nullptr ? (const char*)End - Begin : Length);
 }
 
 
@@ -194,6 +119,7 @@ static void UnpackUintToFloats(uint v, float* a, float* b)
 }
 /*
 * Precision : 0.00005f
+* Arrays go through EncodeNormalsToUint3Array()/DecodeUint3ToNormalsArray() in VectorMath.h
 */
 static Uint3 EncodeNormalsToUint3(Float3 N1, Float3 N2)
 {
@@ -243,6 +169,31 @@ struct BoundingBox
 		Center = Min + HalfLength;
 	}
 
+	//Min and Max only, start from SetMinMax(First, First) and call UpdateCenter() after the last point
+	void Expand(const Float3& Point)
+	{
+		Min.x = MIN(Point.x, Min.x);
+		Min.y = MIN(Point.y, Min.y);
+		Min.z = MIN(Point.z, Min.z);
+
+		Max.x = MAX(Point.x, Max.x);
+		Max.y = MAX(Point.y, Max.y);
+		Max.z = MAX(Point.z, Max.z);
+	}
+
+	void UpdateCenter()
+	{
+		HalfLength = (Max - Min) * 0.5f;
+		Center = Min + HalfLength;
+	}
+
+	void SetMinMax(const Float3& InMin, const Float3& InMax)
+	{
+		Min = InMin;
+		Max = InMax;
+		UpdateCenter();
+	}
+
 	void Resize(BoundingBox& Box)
 	{
 		Min.x = MIN(Box.Min.x, Min.x);
@@ -270,3 +221,15 @@ struct BoundingBox
 	Float3 Min;
 	Float3 Max;
 };
+
+
+struct BoundingSphere
+{
+	BoundingSphere() :
+		Center(0.0f),
+		Radius(0.0f)
+	{}
+
+	Float3 Center;
+	float Radius;
+};
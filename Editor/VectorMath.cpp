@@ -0,0 +1,1144 @@
+#include "VectorMath.h"
+
+#include <atomic>
+#include <cfloat>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VECTOR_MATH_SSE 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+//MSVC takes AVX2 intrinsics in any function, other compilers only with -mavx2
+#if defined(VECTOR_MATH_SSE) && (defined(_MSC_VER) || defined(__AVX2__))
+#define VECTOR_MATH_AVX2 1
+#endif
+
+
+using namespace std;
+
+
+
+static SimdLevel DetectSimdLevel()
+{
+#if defined(VECTOR_MATH_AVX2)
+#if defined(_MSC_VER)
+	int Info[4];
+	__cpuid(Info, 0);
+	if (Info[0] >= 7)
+	{
+		__cpuid(Info, 1);
+		bool OSXSave = (Info[2] & (1 << 27)) != 0;
+		bool Avx = (Info[2] & (1 << 28)) != 0;
+		__cpuidex(Info, 7, 0);
+		bool Avx2 = (Info[1] & (1 << 5)) != 0;
+		//The OS has to save the ymm registers as well
+		if (OSXSave && Avx && Avx2 && (_xgetbv(0) & 6) == 6)
+			return SimdLevel::AVX2;
+	}
+#else
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::AVX2;
+#endif
+#endif
+
+#if defined(VECTOR_MATH_SSE)
+	return SimdLevel::SSE;
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+static std::atomic<int> CurrentSimdLevel(-1);
+
+SimdLevel GetSimdLevel()
+{
+	int Level = CurrentSimdLevel.load(std::memory_order_relaxed);
+	if (Level < 0)
+	{
+		Level = (int)DetectSimdLevel();
+		CurrentSimdLevel.store(Level, std::memory_order_relaxed);
+	}
+	return (SimdLevel)Level;
+}
+
+void SetSimdLevel(SimdLevel Level)
+{
+	CurrentSimdLevel.store(MIN((int)Level, (int)DetectSimdLevel()), std::memory_order_relaxed);
+}
+
+const char* GetSimdLevelName(SimdLevel Level)
+{
+	switch (Level)
+	{
+	case SimdLevel::AVX2:
+		return "AVX2";
+	case SimdLevel::SSE:
+		return "SSE";
+	default:
+		return "Scalar";
+	}
+}
+
+
+
+/*
+* Lanes, every kernel is written once against these.
+* LoadFloat3/StoreFloat3 turn Width contiguous Float3 into X, Y, Z registers and back,
+* GatherFloat3/ScatterFloat3 do the same through one pointer per lane.
+* IntType holds 32 bit integers, LoadInt3/StoreInt3 are the same transpose without going through floats.
+* Round is lroundf, halves go away from zero.
+*/
+
+struct ScalarLane
+{
+	typedef float Type;
+	static const int Width = 1;
+
+	static Type Set(float a) { return a; }
+	static Type Load(const float* p) { return *p; }
+	static void Store(float* p, Type a) { *p = a; }
+	static Type Add(Type a, Type b) { return a + b; }
+	static Type Sub(Type a, Type b) { return a - b; }
+	static Type Mul(Type a, Type b) { return a * b; }
+	static Type Sqrt(Type a) { return sqrtf(a); }
+	static Type Max(Type a, Type b) { return MAX(a, b); }
+	static Type Min(Type a, Type b) { return MIN(a, b); }
+
+	//1 / length, 0 for a zero vector
+	static Type InvLength(Type LengthSq, bool)
+	{
+		return LengthSq > 0.0f ? 1.0f / sqrtf(LengthSq) : 0.0f;
+	}
+
+	static void LoadFloat3(const Float3* p, Type& X, Type& Y, Type& Z)
+	{
+		X = p->x;
+		Y = p->y;
+		Z = p->z;
+	}
+	static void StoreFloat3(Float3* p, Type X, Type Y, Type Z)
+	{
+		*p = Float3(X, Y, Z);
+	}
+	static void GatherFloat3(const Float3* const* p, Type& X, Type& Y, Type& Z)
+	{
+		LoadFloat3(p[0], X, Y, Z);
+	}
+	static void ScatterFloat3(Float3* const* p, Type X, Type Y, Type Z)
+	{
+		StoreFloat3(p[0], X, Y, Z);
+	}
+
+	static Type Div(Type a, Type b) { return a / b; }
+	static Type Abs(Type a) { return fabsf(a); }
+	static Type Neg(Type a) { return -a; }
+	static Type SelectGe(Type a, Type b, Type IfTrue, Type IfFalse) { return a >= b ? IfTrue : IfFalse; }
+	static Type SelectGt(Type a, Type b, Type IfTrue, Type IfFalse) { return a > b ? IfTrue : IfFalse; }
+
+	typedef std::int32_t IntType;
+
+	static IntType SetInt(std::int32_t a) { return a; }
+	static IntType LoadInt(const std::int32_t* p) { return *p; }
+	static void StoreInt(std::int32_t* p, IntType a) { *p = a; }
+	static IntType AndInt(IntType a, IntType b) { return a & b; }
+	static IntType OrInt(IntType a, IntType b) { return a | b; }
+	template<int N> static IntType ShiftLeft(IntType a) { return (IntType)((std::uint32_t)a << N); }
+	template<int N> static IntType ShiftRight(IntType a) { return (IntType)((std::uint32_t)a >> N); }
+	template<int N> static IntType ShiftRightSigned(IntType a) { return a >> N; }
+	static IntType Truncate(Type a) { return (IntType)a; }
+	static IntType Round(Type a) { return (IntType)lroundf(a); }
+	static Type ToFloat(IntType a) { return (float)a; }
+
+	static void LoadInt3(const std::int32_t* p, IntType& X, IntType& Y, IntType& Z)
+	{
+		X = p[0];
+		Y = p[1];
+		Z = p[2];
+	}
+	static void StoreInt3(std::int32_t* p, IntType X, IntType Y, IntType Z)
+	{
+		p[0] = X;
+		p[1] = Y;
+		p[2] = Z;
+	}
+};
+
+
+#if defined(VECTOR_MATH_SSE)
+struct SseLane
+{
+	typedef __m128 Type;
+	static const int Width = 4;
+
+	static Type Set(float a) { return _mm_set1_ps(a); }
+	static Type Load(const float* p) { return _mm_loadu_ps(p); }
+	static void Store(float* p, Type a) { _mm_storeu_ps(p, a); }
+	static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+	static Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+	static Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+	static Type Sqrt(Type a) { return _mm_sqrt_ps(a); }
+	static Type Max(Type a, Type b) { return _mm_max_ps(a, b); }
+	static Type Min(Type a, Type b) { return _mm_min_ps(a, b); }
+
+	static Type InvLength(Type LengthSq, bool Fast)
+	{
+		if (Fast)
+		{
+			//One Newton step takes rsqrt from 12 to about 22 bits
+			Type R = _mm_rsqrt_ps(LengthSq);
+			Type Inv = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), R), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(LengthSq, R), R)));
+			//rsqrt of a denormal is inf, of inf is 0 and the Newton step turns that into NaN,
+			//both go to 0 as the exact path does for an overflowed length
+			Type InRange = _mm_and_ps(_mm_cmpge_ps(LengthSq, _mm_set1_ps(FLT_MIN)), _mm_cmple_ps(LengthSq, _mm_set1_ps(FLT_MAX)));
+			return _mm_and_ps(Inv, InRange);
+		}
+		Type Inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(LengthSq));
+		return _mm_and_ps(Inv, _mm_cmpgt_ps(LengthSq, _mm_setzero_ps()));
+	}
+
+	//x0y0z0x1 y1z1x2y2 z2x3y3z3 -> x0x1x2x3 y0y1y2y3 z0z1z2z3
+	static void LoadFloat3(const Float3* p, Type& X, Type& Y, Type& Z)
+	{
+		const float* f = &p->x;
+		Type A = _mm_loadu_ps(f);
+		Type B = _mm_loadu_ps(f + 4);
+		Type C = _mm_loadu_ps(f + 8);
+
+		X = _mm_shuffle_ps(A, _mm_shuffle_ps(B, C, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+		Y = _mm_shuffle_ps(_mm_shuffle_ps(A, B, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(B, C, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		Z = _mm_shuffle_ps(_mm_shuffle_ps(A, B, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(C, C, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+	}
+	static void StoreFloat3(Float3* p, Type X, Type Y, Type Z)
+	{
+		Type XY01 = _mm_unpacklo_ps(X, Y);
+		Type XY23 = _mm_unpackhi_ps(X, Y);
+
+		float* f = &p->x;
+		_mm_storeu_ps(f, _mm_shuffle_ps(XY01, _mm_shuffle_ps(Z, X, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0)));
+		_mm_storeu_ps(f + 4, _mm_shuffle_ps(_mm_shuffle_ps(Y, Z, _MM_SHUFFLE(1, 1, 1, 1)), XY23, _MM_SHUFFLE(1, 0, 2, 0)));
+		_mm_storeu_ps(f + 8, _mm_shuffle_ps(_mm_shuffle_ps(Z, XY23, _MM_SHUFFLE(3, 2, 2, 2)), _mm_shuffle_ps(XY23, Z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+	}
+	static void GatherFloat3(const Float3* const* p, Type& X, Type& Y, Type& Z)
+	{
+		X = _mm_setr_ps(p[0]->x, p[1]->x, p[2]->x, p[3]->x);
+		Y = _mm_setr_ps(p[0]->y, p[1]->y, p[2]->y, p[3]->y);
+		Z = _mm_setr_ps(p[0]->z, p[1]->z, p[2]->z, p[3]->z);
+	}
+	static void ScatterFloat3(Float3* const* p, Type X, Type Y, Type Z)
+	{
+		Float3 Temp[Width];
+		StoreFloat3(Temp, X, Y, Z);
+		for (int i = 0; i < Width; i++)
+		{
+			*p[i] = Temp[i];
+		}
+	}
+
+	static Type Div(Type a, Type b) { return _mm_div_ps(a, b); }
+	static Type Abs(Type a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static Type Neg(Type a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+	//No blendv before SSE4.1
+	static Type Select(Type Mask, Type IfTrue, Type IfFalse) { return _mm_or_ps(_mm_and_ps(Mask, IfTrue), _mm_andnot_ps(Mask, IfFalse)); }
+	static Type SelectGe(Type a, Type b, Type IfTrue, Type IfFalse) { return Select(_mm_cmpge_ps(a, b), IfTrue, IfFalse); }
+	static Type SelectGt(Type a, Type b, Type IfTrue, Type IfFalse) { return Select(_mm_cmpgt_ps(a, b), IfTrue, IfFalse); }
+
+	typedef __m128i IntType;
+
+	static IntType SetInt(std::int32_t a) { return _mm_set1_epi32(a); }
+	static IntType LoadInt(const std::int32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+	static void StoreInt(std::int32_t* p, IntType a) { _mm_storeu_si128((__m128i*)p, a); }
+	static IntType AndInt(IntType a, IntType b) { return _mm_and_si128(a, b); }
+	static IntType OrInt(IntType a, IntType b) { return _mm_or_si128(a, b); }
+	template<int N> static IntType ShiftLeft(IntType a) { return _mm_slli_epi32(a, N); }
+	template<int N> static IntType ShiftRight(IntType a) { return _mm_srli_epi32(a, N); }
+	template<int N> static IntType ShiftRightSigned(IntType a) { return _mm_srai_epi32(a, N); }
+	static IntType Truncate(Type a) { return _mm_cvttps_epi32(a); }
+	static IntType Round(Type a)
+	{
+		//cvtps rounds halves to even, step the truncated value by one where half or more was dropped
+		IntType Whole = _mm_cvttps_epi32(a);
+		Type Dropped = _mm_sub_ps(a, _mm_cvtepi32_ps(Whole));
+		Type Step = _mm_or_ps(_mm_set1_ps(1.0f), _mm_and_ps(a, _mm_set1_ps(-0.0f)));
+		Step = _mm_and_ps(Step, _mm_cmpge_ps(Abs(Dropped), _mm_set1_ps(0.5f)));
+		return _mm_add_epi32(Whole, _mm_cvttps_epi32(Step));
+	}
+	static Type ToFloat(IntType a) { return _mm_cvtepi32_ps(a); }
+
+	//Shuffles only, the bits go through untouched
+	static void LoadInt3(const std::int32_t* p, IntType& X, IntType& Y, IntType& Z)
+	{
+		Type FX, FY, FZ;
+		LoadFloat3((const Float3*)p, FX, FY, FZ);
+		X = _mm_castps_si128(FX);
+		Y = _mm_castps_si128(FY);
+		Z = _mm_castps_si128(FZ);
+	}
+	static void StoreInt3(std::int32_t* p, IntType X, IntType Y, IntType Z)
+	{
+		StoreFloat3((Float3*)p, _mm_castsi128_ps(X), _mm_castsi128_ps(Y), _mm_castsi128_ps(Z));
+	}
+};
+#endif
+
+
+#if defined(VECTOR_MATH_AVX2)
+struct AvxLane
+{
+	typedef __m256 Type;
+	static const int Width = 8;
+
+	static Type Set(float a) { return _mm256_set1_ps(a); }
+	static Type Load(const float* p) { return _mm256_loadu_ps(p); }
+	static void Store(float* p, Type a) { _mm256_storeu_ps(p, a); }
+	static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+	static Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+	static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+	static Type Sqrt(Type a) { return _mm256_sqrt_ps(a); }
+	static Type Max(Type a, Type b) { return _mm256_max_ps(a, b); }
+	static Type Min(Type a, Type b) { return _mm256_min_ps(a, b); }
+
+	static Type InvLength(Type LengthSq, bool Fast)
+	{
+		if (Fast)
+		{
+			Type R = _mm256_rsqrt_ps(LengthSq);
+			Type Inv = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), R), _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(_mm256_mul_ps(LengthSq, R), R)));
+			Type InRange = _mm256_and_ps(_mm256_cmp_ps(LengthSq, _mm256_set1_ps(FLT_MIN), _CMP_GE_OQ), _mm256_cmp_ps(LengthSq, _mm256_set1_ps(FLT_MAX), _CMP_LE_OQ));
+			return _mm256_and_ps(Inv, InRange);
+		}
+		Type Inv = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(LengthSq));
+		return _mm256_and_ps(Inv, _mm256_cmp_ps(LengthSq, _mm256_setzero_ps(), _CMP_GT_OQ));
+	}
+
+	//Two SSE transposes, the shuffles don't cross 128 bit halves anyway
+	static void LoadFloat3(const Float3* p, Type& X, Type& Y, Type& Z)
+	{
+		__m128 X0, Y0, Z0, X1, Y1, Z1;
+		SseLane::LoadFloat3(p, X0, Y0, Z0);
+		SseLane::LoadFloat3(p + 4, X1, Y1, Z1);
+		X = _mm256_set_m128(X1, X0);
+		Y = _mm256_set_m128(Y1, Y0);
+		Z = _mm256_set_m128(Z1, Z0);
+	}
+	static void StoreFloat3(Float3* p, Type X, Type Y, Type Z)
+	{
+		SseLane::StoreFloat3(p, _mm256_castps256_ps128(X), _mm256_castps256_ps128(Y), _mm256_castps256_ps128(Z));
+		SseLane::StoreFloat3(p + 4, _mm256_extractf128_ps(X, 1), _mm256_extractf128_ps(Y, 1), _mm256_extractf128_ps(Z, 1));
+	}
+	static void GatherFloat3(const Float3* const* p, Type& X, Type& Y, Type& Z)
+	{
+		X = _mm256_setr_ps(p[0]->x, p[1]->x, p[2]->x, p[3]->x, p[4]->x, p[5]->x, p[6]->x, p[7]->x);
+		Y = _mm256_setr_ps(p[0]->y, p[1]->y, p[2]->y, p[3]->y, p[4]->y, p[5]->y, p[6]->y, p[7]->y);
+		Z = _mm256_setr_ps(p[0]->z, p[1]->z, p[2]->z, p[3]->z, p[4]->z, p[5]->z, p[6]->z, p[7]->z);
+	}
+	static void ScatterFloat3(Float3* const* p, Type X, Type Y, Type Z)
+	{
+		Float3 Temp[Width];
+		StoreFloat3(Temp, X, Y, Z);
+		for (int i = 0; i < Width; i++)
+		{
+			*p[i] = Temp[i];
+		}
+	}
+
+	static Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+	static Type Abs(Type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	static Type Neg(Type a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+	static Type SelectGe(Type a, Type b, Type IfTrue, Type IfFalse) { return _mm256_blendv_ps(IfFalse, IfTrue, _mm256_cmp_ps(a, b, _CMP_GE_OQ)); }
+	static Type SelectGt(Type a, Type b, Type IfTrue, Type IfFalse) { return _mm256_blendv_ps(IfFalse, IfTrue, _mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+
+	typedef __m256i IntType;
+
+	static IntType SetInt(std::int32_t a) { return _mm256_set1_epi32(a); }
+	static IntType LoadInt(const std::int32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+	static void StoreInt(std::int32_t* p, IntType a) { _mm256_storeu_si256((__m256i*)p, a); }
+	static IntType AndInt(IntType a, IntType b) { return _mm256_and_si256(a, b); }
+	static IntType OrInt(IntType a, IntType b) { return _mm256_or_si256(a, b); }
+	template<int N> static IntType ShiftLeft(IntType a) { return _mm256_slli_epi32(a, N); }
+	template<int N> static IntType ShiftRight(IntType a) { return _mm256_srli_epi32(a, N); }
+	template<int N> static IntType ShiftRightSigned(IntType a) { return _mm256_srai_epi32(a, N); }
+	static IntType Truncate(Type a) { return _mm256_cvttps_epi32(a); }
+	static IntType Round(Type a)
+	{
+		IntType Whole = _mm256_cvttps_epi32(a);
+		Type Dropped = _mm256_sub_ps(a, _mm256_cvtepi32_ps(Whole));
+		Type Step = _mm256_or_ps(_mm256_set1_ps(1.0f), _mm256_and_ps(a, _mm256_set1_ps(-0.0f)));
+		Step = _mm256_and_ps(Step, _mm256_cmp_ps(Abs(Dropped), _mm256_set1_ps(0.5f), _CMP_GE_OQ));
+		return _mm256_add_epi32(Whole, _mm256_cvttps_epi32(Step));
+	}
+	static Type ToFloat(IntType a) { return _mm256_cvtepi32_ps(a); }
+
+	static void LoadInt3(const std::int32_t* p, IntType& X, IntType& Y, IntType& Z)
+	{
+		Type FX, FY, FZ;
+		LoadFloat3((const Float3*)p, FX, FY, FZ);
+		X = _mm256_castps_si256(FX);
+		Y = _mm256_castps_si256(FY);
+		Z = _mm256_castps_si256(FZ);
+	}
+	static void StoreInt3(std::int32_t* p, IntType X, IntType Y, IntType Z)
+	{
+		StoreFloat3((Float3*)p, _mm256_castsi256_ps(X), _mm256_castsi256_ps(Y), _mm256_castsi256_ps(Z));
+	}
+};
+#endif
+
+
+
+template<typename L>
+static inline typename L::Type Dot3(typename L::Type X1, typename L::Type Y1, typename L::Type Z1, typename L::Type X2, typename L::Type Y2, typename L::Type Z2)
+{
+	return L::Add(L::Add(L::Mul(X1, X2), L::Mul(Y1, Y2)), L::Mul(Z1, Z2));
+}
+
+template<typename L>
+static inline void Cross3(typename L::Type X1, typename L::Type Y1, typename L::Type Z1, typename L::Type X2, typename L::Type Y2, typename L::Type Z2,
+	typename L::Type& OutX, typename L::Type& OutY, typename L::Type& OutZ)
+{
+	OutX = L::Sub(L::Mul(Y1, Z2), L::Mul(Z1, Y2));
+	OutY = L::Sub(L::Mul(Z1, X2), L::Mul(X1, Z2));
+	OutZ = L::Sub(L::Mul(X1, Y2), L::Mul(Y1, X2));
+}
+
+template<typename L>
+static inline void Normalize3(typename L::Type& X, typename L::Type& Y, typename L::Type& Z, bool Fast)
+{
+	typename L::Type Inv = L::InvLength(Dot3<L>(X, Y, Z, X, Y, Z), Fast);
+	X = L::Mul(X, Inv);
+	Y = L::Mul(Y, Inv);
+	Z = L::Mul(Z, Inv);
+}
+
+
+//Width points starting at i, Stride bytes apart, contiguous Float3 arrays take the transpose
+template<typename L>
+static inline void LoadPoints(const Byte* Base, size_t Stride, size_t i, typename L::Type& X, typename L::Type& Y, typename L::Type& Z)
+{
+	if (Stride == sizeof(Float3))
+	{
+		L::LoadFloat3((const Float3*)Base + i, X, Y, Z);
+		return;
+	}
+
+	const Float3* Points[L::Width];
+	for (int j = 0; j < L::Width; j++)
+	{
+		Points[j] = (const Float3*)(Base + (i + j) * Stride);
+	}
+	L::GatherFloat3(Points, X, Y, Z);
+}
+
+//Fold the lanes of a register into Value
+template<typename L, typename FoldType>
+static inline void FoldLanes(typename L::Type Lanes, float& Value, FoldType Fold)
+{
+	float Temp[L::Width];
+	L::Store(Temp, Lanes);
+	for (int j = 0; j < L::Width; j++)
+	{
+		Value = Fold(Value, Temp[j]);
+	}
+}
+
+//Counterpart of LoadPoints
+template<typename L>
+static inline void StorePoints(Byte* Base, size_t Stride, size_t i, typename L::Type X, typename L::Type Y, typename L::Type Z)
+{
+	if (Stride == sizeof(Float3))
+	{
+		L::StoreFloat3((Float3*)Base + i, X, Y, Z);
+		return;
+	}
+
+	Float3* Points[L::Width];
+	for (int j = 0; j < L::Width; j++)
+	{
+		Points[j] = (Float3*)(Base + (i + j) * Stride);
+	}
+	L::ScatterFloat3(Points, X, Y, Z);
+}
+
+//Width 32 bit words starting at i, Stride bytes apart
+template<typename L>
+static inline typename L::IntType LoadWords(const Byte* Base, size_t Stride, size_t i)
+{
+	if (Stride == sizeof(std::int32_t))
+		return L::LoadInt((const std::int32_t*)Base + i);
+
+	std::int32_t Words[L::Width];
+	for (int j = 0; j < L::Width; j++)
+	{
+		memcpy(&Words[j], Base + (i + j) * Stride, sizeof(std::int32_t));
+	}
+	return L::LoadInt(Words);
+}
+
+template<typename L>
+static inline void StoreWords(Byte* Base, size_t Stride, size_t i, typename L::IntType Value)
+{
+	if (Stride == sizeof(std::int32_t))
+	{
+		L::StoreInt((std::int32_t*)Base + i, Value);
+		return;
+	}
+
+	std::int32_t Words[L::Width];
+	L::StoreInt(Words, Value);
+	for (int j = 0; j < L::Width; j++)
+	{
+		memcpy(Base + (i + j) * Stride, &Words[j], sizeof(std::int32_t));
+	}
+}
+
+//High << 16 | Low & 0xFFFF, as PackFloatsToUint() puts them together
+template<typename L>
+static inline typename L::IntType PackHalves(typename L::IntType High, typename L::IntType Low)
+{
+	return L::OrInt(L::template ShiftLeft<16>(High), L::AndInt(Low, L::SetInt(0xFFFF)));
+}
+
+//0~1 to 0~65535, truncated like PackFloatsToUint()
+template<typename L>
+static inline typename L::IntType ToUnorm16(typename L::Type Value)
+{
+	return L::Truncate(L::Mul(Value, L::Set(65535.0f)));
+}
+
+template<typename L>
+static inline typename L::Type FromUnorm16(typename L::IntType Value)
+{
+	return L::Div(L::ToFloat(Value), L::Set(65535.0f));
+}
+
+//-1~1 to 0~65535, the half of EncodeNormalsToUint3() for one component
+template<typename L>
+static inline typename L::IntType SignedToUnorm16(typename L::Type Value)
+{
+	return ToUnorm16<L>(L::Add(L::Mul(Value, L::Set(0.5f)), L::Set(0.5f)));
+}
+
+template<typename L>
+static inline typename L::Type Unorm16ToSigned(typename L::IntType Value)
+{
+	return L::Sub(L::Mul(FromUnorm16<L>(Value), L::Set(2.0f)), L::Set(1.0f));
+}
+
+
+/*
+* Kernels, Run<Lane>(Begin, Num) does whole lanes from Begin and returns where it stopped
+*/
+
+struct DotKernel
+{
+	const Float3* A;
+	const Float3* B;
+	float* Dst;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::Type X1, Y1, Z1, X2, Y2, Z2;
+			L::LoadFloat3(A + i, X1, Y1, Z1);
+			L::LoadFloat3(B + i, X2, Y2, Z2);
+			L::Store(Dst + i, Dot3<L>(X1, Y1, Z1, X2, Y2, Z2));
+		}
+		return i;
+	}
+};
+
+struct CrossKernel
+{
+	const Float3* A;
+	const Float3* B;
+	Float3* Dst;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::Type X1, Y1, Z1, X2, Y2, Z2, X, Y, Z;
+			L::LoadFloat3(A + i, X1, Y1, Z1);
+			L::LoadFloat3(B + i, X2, Y2, Z2);
+			Cross3<L>(X1, Y1, Z1, X2, Y2, Z2, X, Y, Z);
+			L::StoreFloat3(Dst + i, X, Y, Z);
+		}
+		return i;
+	}
+};
+
+struct LengthKernel
+{
+	const Float3* Src;
+	float* Dst;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::Type X, Y, Z;
+			L::LoadFloat3(Src + i, X, Y, Z);
+			//Same floor as Length()
+			L::Store(Dst + i, L::Max(L::Sqrt(Dot3<L>(X, Y, Z, X, Y, Z)), L::Set(0.000001f)));
+		}
+		return i;
+	}
+};
+
+struct NormalizeKernel
+{
+	const Float3* Src;
+	Float3* Dst;
+	bool Fast;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::Type X, Y, Z;
+			L::LoadFloat3(Src + i, X, Y, Z);
+			Normalize3<L>(X, Y, Z, Fast);
+			L::StoreFloat3(Dst + i, X, Y, Z);
+		}
+		return i;
+	}
+};
+
+struct ToSoAKernel
+{
+	const Float3* Src;
+	float* X;
+	float* Y;
+	float* Z;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::Type VX, VY, VZ;
+			L::LoadFloat3(Src + i, VX, VY, VZ);
+			L::Store(X + i, VX);
+			L::Store(Y + i, VY);
+			L::Store(Z + i, VZ);
+		}
+		return i;
+	}
+};
+
+struct FromSoAKernel
+{
+	const float* X;
+	const float* Y;
+	const float* Z;
+	Float3* Dst;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			L::StoreFloat3(Dst + i, L::Load(X + i), L::Load(Y + i), L::Load(Z + i));
+		}
+		return i;
+	}
+};
+
+struct NormalizeSoAKernel
+{
+	float* X;
+	float* Y;
+	float* Z;
+	bool Fast;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::Type VX = L::Load(X + i), VY = L::Load(Y + i), VZ = L::Load(Z + i);
+			Normalize3<L>(VX, VY, VZ, Fast);
+			L::Store(X + i, VX);
+			L::Store(Y + i, VY);
+			L::Store(Z + i, VZ);
+		}
+		return i;
+	}
+};
+
+struct FaceNormalKernel
+{
+	const DrawRawVertex* VertexList;
+	const DrawRawIndex* IndexList;
+	Float3* Dst;
+	bool Fast;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			const Float3* P0[L::Width];
+			const Float3* P1[L::Width];
+			const Float3* P2[L::Width];
+			for (int j = 0; j < L::Width; j++)
+			{
+				const DrawRawIndex* Triangle = IndexList + (i + j) * 3;
+				P0[j] = &VertexList[Triangle[0]].pos;
+				P1[j] = &VertexList[Triangle[1]].pos;
+				P2[j] = &VertexList[Triangle[2]].pos;
+			}
+
+			typename L::Type X0, Y0, Z0, X1, Y1, Z1, X2, Y2, Z2, X, Y, Z;
+			L::GatherFloat3(P0, X0, Y0, Z0);
+			L::GatherFloat3(P1, X1, Y1, Z1);
+			L::GatherFloat3(P2, X2, Y2, Z2);
+
+			Cross3<L>(L::Sub(X1, X0), L::Sub(Y1, Y0), L::Sub(Z1, Z0), L::Sub(X2, X0), L::Sub(Y2, Y0), L::Sub(Z2, Z0), X, Y, Z);
+			Normalize3<L>(X, Y, Z, Fast);
+			L::StoreFloat3(Dst + i, X, Y, Z);
+		}
+		return i;
+	}
+};
+
+struct VertexNormalKernel
+{
+	DrawRawVertex* VertexList;
+	bool Fast;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			Float3* Normals[L::Width];
+			for (int j = 0; j < L::Width; j++)
+			{
+				Normals[j] = &VertexList[i + j].normal;
+			}
+
+			typename L::Type X, Y, Z;
+			L::GatherFloat3(Normals, X, Y, Z);
+			Normalize3<L>(X, Y, Z, Fast);
+			L::ScatterFloat3(Normals, X, Y, Z);
+		}
+		return i;
+	}
+};
+
+
+//Accumulates into OutMin/OutMax, which start at +-FLT_MAX
+struct MinMaxKernel
+{
+	const Byte* Base;
+	size_t Stride;
+	Float3* OutMin;
+	Float3* OutMax;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		if (i + L::Width > Num)
+			return i;
+
+		typename L::Type MinX = L::Set(FLT_MAX), MinY = L::Set(FLT_MAX), MinZ = L::Set(FLT_MAX);
+		typename L::Type MaxX = L::Set(-FLT_MAX), MaxY = L::Set(-FLT_MAX), MaxZ = L::Set(-FLT_MAX);
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::Type X, Y, Z;
+			LoadPoints<L>(Base, Stride, i, X, Y, Z);
+			MinX = L::Min(MinX, X);
+			MinY = L::Min(MinY, Y);
+			MinZ = L::Min(MinZ, Z);
+			MaxX = L::Max(MaxX, X);
+			MaxY = L::Max(MaxY, Y);
+			MaxZ = L::Max(MaxZ, Z);
+		}
+
+		auto Smaller = [](float a, float b) { return MIN(a, b); };
+		auto Larger = [](float a, float b) { return MAX(a, b); };
+		FoldLanes<L>(MinX, OutMin->x, Smaller);
+		FoldLanes<L>(MinY, OutMin->y, Smaller);
+		FoldLanes<L>(MinZ, OutMin->z, Smaller);
+		FoldLanes<L>(MaxX, OutMax->x, Larger);
+		FoldLanes<L>(MaxY, OutMax->y, Larger);
+		FoldLanes<L>(MaxZ, OutMax->z, Larger);
+		return i;
+	}
+};
+
+//Accumulates the largest squared distance into OutDistanceSq
+struct MaxDistanceKernel
+{
+	const Byte* Base;
+	size_t Stride;
+	Float3 Center;
+	float* OutDistanceSq;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		if (i + L::Width > Num)
+			return i;
+
+		typename L::Type CX = L::Set(Center.x), CY = L::Set(Center.y), CZ = L::Set(Center.z);
+		typename L::Type Largest = L::Set(0.0f);
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::Type X, Y, Z;
+			LoadPoints<L>(Base, Stride, i, X, Y, Z);
+			X = L::Sub(X, CX);
+			Y = L::Sub(Y, CY);
+			Z = L::Sub(Z, CZ);
+			Largest = L::Max(Largest, Dot3<L>(X, Y, Z, X, Y, Z));
+		}
+
+		FoldLanes<L>(Largest, *OutDistanceSq, [](float a, float b) { return MAX(a, b); });
+		return i;
+	}
+};
+
+
+struct PackFloatsKernel
+{
+	const float* A;
+	const float* B;
+	uint* Dst;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			L::StoreInt((std::int32_t*)Dst + i, PackHalves<L>(ToUnorm16<L>(L::Load(A + i)), ToUnorm16<L>(L::Load(B + i))));
+		}
+		return i;
+	}
+};
+
+struct UnpackFloatsKernel
+{
+	const uint* Src;
+	float* A;
+	float* B;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::IntType Word = L::LoadInt((const std::int32_t*)Src + i);
+			L::Store(A + i, FromUnorm16<L>(L::template ShiftRight<16>(Word)));
+			L::Store(B + i, FromUnorm16<L>(L::AndInt(Word, L::SetInt(0xFFFF))));
+		}
+		return i;
+	}
+};
+
+//N1.xy, N1.z N2.x, N2.yz in the three words of a Uint3
+struct EncodeNormalPairKernel
+{
+	const Float3* N1;
+	const Float3* N2;
+	Uint3* Dst;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::Type X1, Y1, Z1, X2, Y2, Z2;
+			L::LoadFloat3(N1 + i, X1, Y1, Z1);
+			L::LoadFloat3(N2 + i, X2, Y2, Z2);
+			L::StoreInt3((std::int32_t*)(Dst + i),
+				PackHalves<L>(SignedToUnorm16<L>(X1), SignedToUnorm16<L>(Y1)),
+				PackHalves<L>(SignedToUnorm16<L>(Z1), SignedToUnorm16<L>(X2)),
+				PackHalves<L>(SignedToUnorm16<L>(Y2), SignedToUnorm16<L>(Z2)));
+		}
+		return i;
+	}
+};
+
+struct DecodeNormalPairKernel
+{
+	const Uint3* Src;
+	Float3* N1;
+	Float3* N2;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		typename L::IntType Low = L::SetInt(0xFFFF);
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::IntType WX, WY, WZ;
+			L::LoadInt3((const std::int32_t*)(Src + i), WX, WY, WZ);
+			L::StoreFloat3(N1 + i,
+				Unorm16ToSigned<L>(L::template ShiftRight<16>(WX)),
+				Unorm16ToSigned<L>(L::AndInt(WX, Low)),
+				Unorm16ToSigned<L>(L::template ShiftRight<16>(WY)));
+			L::StoreFloat3(N2 + i,
+				Unorm16ToSigned<L>(L::AndInt(WY, Low)),
+				Unorm16ToSigned<L>(L::template ShiftRight<16>(WZ)),
+				Unorm16ToSigned<L>(L::AndInt(WZ, Low)));
+		}
+		return i;
+	}
+};
+
+#if defined(VECTOR_MATH_AVX2)
+/*
+* No transpose on AVX2, pshufb picks the halves of each output register straight out of the source.
+* 4 pairs are 48 bytes in and 12 floats out to each array, every 4 floats need at most 16 bytes.
+* Same math as the other lanes, so still bit exact with DecodeUint3ToNormals().
+*/
+static inline __m256i LoadHalvesAvx(const Byte* Base, int LowOffset, int HighOffset, __m256i Mask)
+{
+	__m256i Words = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(Base + LowOffset))),
+		_mm_loadu_si128((const __m128i*)(Base + HighOffset)), 1);
+	return _mm256_shuffle_epi8(Words, Mask);
+}
+
+template<>
+size_t DecodeNormalPairKernel::Run<AvxLane>(size_t i, size_t Num) const
+{
+	//-1 zeroes the byte, each float takes the 2 bytes of its half
+	const __m128i N1Mask0 = _mm_setr_epi8(2, 3, -1, -1, 0, 1, -1, -1, 6, 7, -1, -1, 14, 15, -1, -1);
+	const __m128i N1Mask1 = _mm_setr_epi8(0, 1, -1, -1, 6, 7, -1, -1, 14, 15, -1, -1, 12, 13, -1, -1);
+	const __m128i N1Mask2 = _mm_setr_epi8(0, 1, -1, -1, 8, 9, -1, -1, 6, 7, -1, -1, 12, 13, -1, -1);
+	const __m128i N2Mask0 = _mm_setr_epi8(0, 1, -1, -1, 6, 7, -1, -1, 4, 5, -1, -1, 12, 13, -1, -1);
+	const __m128i N2Mask1 = _mm_setr_epi8(2, 3, -1, -1, 0, 1, -1, -1, 8, 9, -1, -1, 14, 15, -1, -1);
+	const __m128i N2Mask2 = _mm_setr_epi8(0, 1, -1, -1, 8, 9, -1, -1, 14, 15, -1, -1, 12, 13, -1, -1);
+	const __m256i N1Masks[3] = { _mm256_set_m128i(N1Mask1, N1Mask0), _mm256_set_m128i(N1Mask0, N1Mask2), _mm256_set_m128i(N1Mask2, N1Mask1) };
+	const __m256i N2Masks[3] = { _mm256_set_m128i(N2Mask1, N2Mask0), _mm256_set_m128i(N2Mask0, N2Mask2), _mm256_set_m128i(N2Mask2, N2Mask1) };
+	//Bytes into the 96 of 8 pairs where each 4 floats start
+	const int N1Offsets[6] = { 0, 12, 30, 48, 60, 78 };
+	const int N2Offsets[6] = { 4, 20, 32, 52, 68, 80 };
+
+	for (; i + AvxLane::Width <= Num; i += AvxLane::Width)
+	{
+		const Byte* Base = (const Byte*)(Src + i);
+		float* Dst1 = &N1[i].x;
+		float* Dst2 = &N2[i].x;
+		for (int j = 0; j < 3; j++)
+		{
+			AvxLane::Store(Dst1 + j * 8, Unorm16ToSigned<AvxLane>(LoadHalvesAvx(Base, N1Offsets[j * 2], N1Offsets[j * 2 + 1], N1Masks[j])));
+			AvxLane::Store(Dst2 + j * 8, Unorm16ToSigned<AvxLane>(LoadHalvesAvx(Base, N2Offsets[j * 2], N2Offsets[j * 2 + 1], N2Masks[j])));
+		}
+	}
+	return i;
+}
+#endif
+
+//Same steps as EncodeOctahedral(), x in the low half of the word
+struct EncodeOctahedralKernel
+{
+	const Byte* Src;
+	size_t SrcStride;
+	Byte* Dst;
+	size_t DstStride;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		typename L::Type Zero = L::Set(0.0f), One = L::Set(1.0f), MinusOne = L::Set(-1.0f), Scale = L::Set(32767.0f);
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::Type X, Y, Z;
+			LoadPoints<L>(Src, SrcStride, i, X, Y, Z);
+
+			typename L::Type Sum = L::Add(L::Add(L::Abs(X), L::Abs(Y)), L::Abs(Z));
+			typename L::Type OX = L::Div(X, Sum);
+			typename L::Type OY = L::Div(Y, Sum);
+
+			//Lower half folds over the diagonals
+			typename L::Type FoldX = L::Mul(L::Sub(One, L::Abs(OY)), L::SelectGe(OX, Zero, One, MinusOne));
+			typename L::Type FoldY = L::Mul(L::Sub(One, L::Abs(OX)), L::SelectGe(OY, Zero, One, MinusOne));
+			OX = L::SelectGe(Z, Zero, OX, FoldX);
+			OY = L::SelectGe(Z, Zero, OY, FoldY);
+
+			//Zero, infinite and NaN normals encode as 0
+			typename L::Type Largest = L::Set(FLT_MAX);
+			OX = L::SelectGt(Sum, Zero, L::SelectGe(Largest, Sum, L::Min(L::Max(OX, MinusOne), One), Zero), Zero);
+			OY = L::SelectGt(Sum, Zero, L::SelectGe(Largest, Sum, L::Min(L::Max(OY, MinusOne), One), Zero), Zero);
+
+			StoreWords<L>(Dst, DstStride, i, PackHalves<L>(L::Round(L::Mul(OY, Scale)), L::Round(L::Mul(OX, Scale))));
+		}
+		return i;
+	}
+};
+
+//Same steps as DecodeOctahedral()
+struct DecodeOctahedralKernel
+{
+	const Byte* Src;
+	size_t SrcStride;
+	Byte* Dst;
+	size_t DstStride;
+
+	template<typename L>
+	size_t Run(size_t i, size_t Num) const
+	{
+		typename L::Type Zero = L::Set(0.0f), One = L::Set(1.0f), MinusOne = L::Set(-1.0f), Scale = L::Set(32767.0f);
+		for (; i + L::Width <= Num; i += L::Width)
+		{
+			typename L::IntType Word = LoadWords<L>(Src, SrcStride, i);
+			typename L::Type X = L::Max(L::Div(L::ToFloat(L::template ShiftRightSigned<16>(L::template ShiftLeft<16>(Word))), Scale), MinusOne);
+			typename L::Type Y = L::Max(L::Div(L::ToFloat(L::template ShiftRightSigned<16>(Word)), Scale), MinusOne);
+			typename L::Type Z = L::Sub(L::Sub(One, L::Abs(X)), L::Abs(Y));
+
+			typename L::Type T = L::Max(L::Neg(Z), Zero);
+			X = L::Add(X, L::SelectGe(X, Zero, L::Neg(T), T));
+			Y = L::Add(Y, L::SelectGe(Y, Zero, L::Neg(T), T));
+
+			//Normalize() with its 1e-6 floor, multiplied by the reciprocal as it does
+			typename L::Type Inv = L::Div(One, L::Max(L::Sqrt(Dot3<L>(X, Y, Z, X, Y, Z)), L::Set(0.000001f)));
+			StorePoints<L>(Dst, DstStride, i, L::Mul(X, Inv), L::Mul(Y, Inv), L::Mul(Z, Inv));
+		}
+		return i;
+	}
+};
+
+//Widest lane first, narrower ones pick up what is left
+template<typename KernelType>
+static void RunKernel(const KernelType& Kernel, size_t Num)
+{
+	size_t Done = 0;
+	SimdLevel Level = GetSimdLevel();
+
+#if defined(VECTOR_MATH_AVX2)
+	if (Level == SimdLevel::AVX2)
+	{
+		Done = Kernel.template Run<AvxLane>(Done, Num);
+		_mm256_zeroupper();
+	}
+#endif
+#if defined(VECTOR_MATH_SSE)
+	if (Level != SimdLevel::Scalar)
+		Done = Kernel.template Run<SseLane>(Done, Num);
+#endif
+	Kernel.template Run<ScalarLane>(Done, Num);
+}
+
+
+
+void DotArray(const Float3* A, const Float3* B, float* Dst, size_t Num)
+{
+	RunKernel(DotKernel{ A, B, Dst }, Num);
+}
+
+void CrossArray(const Float3* A, const Float3* B, Float3* Dst, size_t Num)
+{
+	RunKernel(CrossKernel{ A, B, Dst }, Num);
+}
+
+void LengthArray(const Float3* Src, float* Dst, size_t Num)
+{
+	RunKernel(LengthKernel{ Src, Dst }, Num);
+}
+
+void NormalizeArray(const Float3* Src, Float3* Dst, size_t Num, NormalizeMode Mode)
+{
+	RunKernel(NormalizeKernel{ Src, Dst, Mode == NormalizeMode::Fast }, Num);
+}
+
+void Float3ToSoA(const Float3* Src, float* X, float* Y, float* Z, size_t Num)
+{
+	RunKernel(ToSoAKernel{ Src, X, Y, Z }, Num);
+}
+
+void SoAToFloat3(const float* X, const float* Y, const float* Z, Float3* Dst, size_t Num)
+{
+	RunKernel(FromSoAKernel{ X, Y, Z, Dst }, Num);
+}
+
+void NormalizeSoA(float* X, float* Y, float* Z, size_t Num, NormalizeMode Mode)
+{
+	RunKernel(NormalizeSoAKernel{ X, Y, Z, Mode == NormalizeMode::Fast }, Num);
+}
+
+void CalculateFaceNormals(const DrawRawVertex* VertexList, const DrawRawIndex* IndexList, size_t TriangleNum, Float3* Dst, NormalizeMode Mode)
+{
+	RunKernel(FaceNormalKernel{ VertexList, IndexList, Dst, Mode == NormalizeMode::Fast }, TriangleNum);
+}
+
+void NormalizeVertexNormals(DrawRawVertex* VertexList, size_t Num, NormalizeMode Mode)
+{
+	RunKernel(VertexNormalKernel{ VertexList, Mode == NormalizeMode::Fast }, Num);
+}
+
+
+bool MinMaxArray(const Float3* Src, size_t Num, Float3& OutMin, Float3& OutMax)
+{
+	if (Num == 0)
+		return false;
+
+	OutMin = Float3(FLT_MAX);
+	OutMax = Float3(-FLT_MAX);
+	RunKernel(MinMaxKernel{ (const Byte*)Src, sizeof(Float3), &OutMin, &OutMax }, Num);
+	return true;
+}
+
+bool MinMaxVertices(const DrawRawVertex* VertexList, size_t Num, Float3& OutMin, Float3& OutMax)
+{
+	if (Num == 0)
+		return false;
+
+	OutMin = Float3(FLT_MAX);
+	OutMax = Float3(-FLT_MAX);
+	RunKernel(MinMaxKernel{ (const Byte*)&VertexList->pos, sizeof(DrawRawVertex), &OutMin, &OutMax }, Num);
+	return true;
+}
+
+float MaxDistanceVertices(const DrawRawVertex* VertexList, size_t Num, const Float3& Center)
+{
+	if (Num == 0)
+		return 0.0f;
+
+	float DistanceSq = 0.0f;
+	RunKernel(MaxDistanceKernel{ (const Byte*)&VertexList->pos, sizeof(DrawRawVertex), Center, &DistanceSq }, Num);
+	return sqrtf(DistanceSq);
+}
+
+
+void PackFloatsToUintArray(const float* A, const float* B, uint* Dst, size_t Num)
+{
+	RunKernel(PackFloatsKernel{ A, B, Dst }, Num);
+}
+
+void UnpackUintToFloatsArray(const uint* Src, float* A, float* B, size_t Num)
+{
+	RunKernel(UnpackFloatsKernel{ Src, A, B }, Num);
+}
+
+void EncodeNormalsToUint3Array(const Float3* N1, const Float3* N2, Uint3* Dst, size_t Num)
+{
+	RunKernel(EncodeNormalPairKernel{ N1, N2, Dst }, Num);
+}
+
+void DecodeUint3ToNormalsArray(const Uint3* Src, Float3* N1, Float3* N2, size_t Num)
+{
+	RunKernel(DecodeNormalPairKernel{ Src, N1, N2 }, Num);
+}
+
+void EncodeOctahedralArray(const Float3* Src, std::int16_t* Dst, size_t Num, size_t SrcStride, size_t DstStride)
+{
+	if (Num == 0)
+		return;
+	RunKernel(EncodeOctahedralKernel{ (const Byte*)Src, SrcStride, (Byte*)Dst, DstStride }, Num);
+}
+
+void DecodeOctahedralArray(const std::int16_t* Src, Float3* Dst, size_t Num, size_t SrcStride, size_t DstStride)
+{
+	if (Num == 0)
+		return;
+	RunKernel(DecodeOctahedralKernel{ (const Byte*)Src, SrcStride, (Byte*)Dst, DstStride }, Num);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Utils.h"
+#include "DrawTypes.h"
+
+
+/*
+* Batch Float3 math over whole arrays, 8 wide with AVX2, 4 wide with SSE, scalar otherwise.
+* The widest level the cpu supports is picked at the first call.
+* Src and Dst may be the same array, other overlaps are not allowed.
+*/
+
+enum class SimdLevel
+{
+	Scalar,
+	SSE,
+	AVX2
+};
+
+SimdLevel GetSimdLevel();
+//Clamped to what the cpu supports, for comparing the paths
+void SetSimdLevel(SimdLevel Level);
+const char* GetSimdLevelName(SimdLevel Level);
+
+
+/*
+* Exact : sqrt and divide, same result as Normalize() up to rounding
+* Fast  : rsqrt plus one Newton step, relative error below 1e-6 on SIMD paths,
+*         so the length of the result is within 2e-6 of 1, DevChecks verifies it on every level
+* Zero vectors, and ones whose squared length overflows, stay zero in both modes instead of going NaN.
+*/
+enum class NormalizeMode
+{
+	Exact,
+	Fast
+};
+
+
+/****AoS, arrays of Float3****/
+void DotArray(const Float3* A, const Float3* B, float* Dst, size_t Num);
+void CrossArray(const Float3* A, const Float3* B, Float3* Dst, size_t Num);
+void LengthArray(const Float3* Src, float* Dst, size_t Num);
+void NormalizeArray(const Float3* Src, Float3* Dst, size_t Num, NormalizeMode Mode = NormalizeMode::Exact);
+
+/****SoA, one array per component****/
+void Float3ToSoA(const Float3* Src, float* X, float* Y, float* Z, size_t Num);
+void SoAToFloat3(const float* X, const float* Y, const float* Z, Float3* Dst, size_t Num);
+void NormalizeSoA(float* X, float* Y, float* Z, size_t Num, NormalizeMode Mode = NormalizeMode::Exact);
+
+/****Vertices****/
+//Unit normal of every triangle of IndexList, as CalculateNormal() does per triangle
+void CalculateFaceNormals(const DrawRawVertex* VertexList, const DrawRawIndex* IndexList, size_t TriangleNum, Float3* Dst, NormalizeMode Mode = NormalizeMode::Exact);
+//Normalize DrawRawVertex::normal in place
+void NormalizeVertexNormals(DrawRawVertex* VertexList, size_t Num, NormalizeMode Mode = NormalizeMode::Exact);
+
+/****Bounds****/
+//Component wise min and max of the points, false and untouched outputs if Num is 0
+bool MinMaxArray(const Float3* Src, size_t Num, Float3& OutMin, Float3& OutMax);
+bool MinMaxVertices(const DrawRawVertex* VertexList, size_t Num, Float3& OutMin, Float3& OutMax);
+//Largest distance from Center to a vertex, 0 if Num is 0
+float MaxDistanceVertices(const DrawRawVertex* VertexList, size_t Num, const Float3& Center);
+
+/****Normal packing****/
+//PackFloatsToUint()/UnpackUintToFloats() over arrays, A and B in 0~1
+void PackFloatsToUintArray(const float* A, const float* B, uint* Dst, size_t Num);
+void UnpackUintToFloatsArray(const uint* Src, float* A, float* B, size_t Num);
+//EncodeNormalsToUint3()/DecodeUint3ToNormals() over arrays, N1[i] and N2[i] share Dst[i]
+void EncodeNormalsToUint3Array(const Float3* N1, const Float3* N2, Uint3* Dst, size_t Num);
+void DecodeUint3ToNormalsArray(const Uint3* Src, Float3* N1, Float3* N2, size_t Num);
+/*
+* EncodeOctahedral()/DecodeOctahedral() over arrays, two int16 per normal.
+* Strides in bytes, so normals can be read from and written into vertex structs.
+* Same bits as the single normal functions on every path, zero, infinite and NaN normals encode as 0.
+*/
+void EncodeOctahedralArray(const Float3* Src, std::int16_t* Dst, size_t Num, size_t SrcStride = sizeof(Float3), size_t DstStride = sizeof(std::int16_t) * 2);
+void DecodeOctahedralArray(const std::int16_t* Src, Float3* Dst, size_t Num, size_t SrcStride = sizeof(std::int16_t) * 2, size_t DstStride = sizeof(Float3));
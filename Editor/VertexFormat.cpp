@@ -0,0 +1,198 @@
+#include "VertexFormat.h"
+#include "VectorMath.h"
+
+#include <cfloat>
+
+
+using namespace std;
+
+//Worst angle of a 16 bit octahedral normal, measured over a dense sphere sweep with some headroom
+#define OCTAHEDRAL_ERROR_BOUND 0.00007f
+
+
+static inline float Saturate(float Value)
+{
+	return Value < 0.0f ? 0.0f : (Value > 1.0f ? 1.0f : Value);
+}
+
+static inline float SignNotZero(float Value)
+{
+	return Value >= 0.0f ? 1.0f : -1.0f;
+}
+
+static inline std::uint16_t FloatToUnorm16(float Value)
+{
+	return (std::uint16_t)(Saturate(Value) * 65535.0f + 0.5f);
+}
+
+static inline std::int16_t FloatToSnorm16(float Value)
+{
+	Value = Value < -1.0f ? -1.0f : (Value > 1.0f ? 1.0f : Value);
+	return (std::int16_t)lroundf(Value * 32767.0f);
+}
+
+static inline float Snorm16ToFloat(std::int16_t Value)
+{
+	return MAX(Value / 32767.0f, -1.0f);
+}
+
+static inline std::uint8_t FloatToUnorm8(float Value)
+{
+	return (std::uint8_t)(Saturate(Value) * 255.0f + 0.5f);
+}
+
+
+
+VertexQuantization::VertexQuantization(const BoundingBox& Box) :
+	Offset(Box.Min), Pad0(0.0f), Scale(Box.Max - Box.Min), Pad1(0.0f)
+{
+	//Flat boxes still need a valid divisor
+	for (int i = 0; i < 3; i++)
+	{
+		if (!(Scale[i] > 0.0f))
+			Scale[i] = 1.0f;
+	}
+}
+
+
+void EncodeOctahedral(const Float3& Normal, std::int16_t* Out)
+{
+	//Zero, infinite and NaN normals have no direction, same as the batch paths
+	float Sum = fabsf(Normal.x) + fabsf(Normal.y) + fabsf(Normal.z);
+	if (!(Sum > 0.0f && Sum <= FLT_MAX))
+	{
+		Out[0] = 0;
+		Out[1] = 0;
+		return;
+	}
+
+	float X = Normal.x / Sum;
+	float Y = Normal.y / Sum;
+	if (Normal.z < 0.0f)
+	{
+		float FoldX = (1.0f - fabsf(Y)) * SignNotZero(X);
+		float FoldY = (1.0f - fabsf(X)) * SignNotZero(Y);
+		X = FoldX;
+		Y = FoldY;
+	}
+
+	Out[0] = FloatToSnorm16(X);
+	Out[1] = FloatToSnorm16(Y);
+}
+
+Float3 DecodeOctahedral(const std::int16_t* In)
+{
+	Float3 Normal(Snorm16ToFloat(In[0]), Snorm16ToFloat(In[1]), 0.0f);
+	Normal.z = 1.0f - fabsf(Normal.x) - fabsf(Normal.y);
+
+	float T = MAX(-Normal.z, 0.0f);
+	Normal.x += Normal.x >= 0.0f ? -T : T;
+	Normal.y += Normal.y >= 0.0f ? -T : T;
+
+	return Normalize(Normal);
+}
+
+
+//Everything but the normal, which the batch paths encode separately
+static void EncodePositionColor(const DrawRawVertex& Vertex, const VertexQuantization& Quantization, PackedVertex& Result)
+{
+	Result.pos[0] = FloatToUnorm16((Vertex.pos.x - Quantization.Offset.x) / Quantization.Scale.x);
+	Result.pos[1] = FloatToUnorm16((Vertex.pos.y - Quantization.Offset.y) / Quantization.Scale.y);
+	Result.pos[2] = FloatToUnorm16((Vertex.pos.z - Quantization.Offset.z) / Quantization.Scale.z);
+	Result.pos[3] = 0;
+
+	Result.color[0] = FloatToUnorm8(Vertex.color.x);
+	Result.color[1] = FloatToUnorm8(Vertex.color.y);
+	Result.color[2] = FloatToUnorm8(Vertex.color.z);
+	Result.color[3] = FloatToUnorm8(Vertex.alpha);
+}
+
+static void DecodePositionColor(const PackedVertex& Vertex, const VertexQuantization& Quantization, DrawRawVertex& Result)
+{
+	Result.pos.x = Quantization.Offset.x + (Vertex.pos[0] / 65535.0f) * Quantization.Scale.x;
+	Result.pos.y = Quantization.Offset.y + (Vertex.pos[1] / 65535.0f) * Quantization.Scale.y;
+	Result.pos.z = Quantization.Offset.z + (Vertex.pos[2] / 65535.0f) * Quantization.Scale.z;
+
+	Result.color.x = Vertex.color[0] / 255.0f;
+	Result.color.y = Vertex.color[1] / 255.0f;
+	Result.color.z = Vertex.color[2] / 255.0f;
+	Result.alpha = Vertex.color[3] / 255.0f;
+}
+
+
+PackedVertex EncodeVertex(const DrawRawVertex& Vertex, const VertexQuantization& Quantization)
+{
+	PackedVertex Result;
+	EncodePositionColor(Vertex, Quantization, Result);
+	EncodeOctahedral(Vertex.normal, Result.normal);
+	return Result;
+}
+
+DrawRawVertex DecodeVertex(const PackedVertex& Vertex, const VertexQuantization& Quantization)
+{
+	DrawRawVertex Result;
+	DecodePositionColor(Vertex, Quantization, Result);
+	Result.normal = DecodeOctahedral(Vertex.normal);
+	return Result;
+}
+
+
+void EncodeVertices(const DrawRawVertex* Src, PackedVertex* Dst, size_t Num, const VertexQuantization& Quantization)
+{
+	for (size_t i = 0; i < Num; i++)
+	{
+		EncodePositionColor(Src[i], Quantization, Dst[i]);
+	}
+	EncodeOctahedralArray(&Src->normal, Dst->normal, Num, sizeof(DrawRawVertex), sizeof(PackedVertex));
+}
+
+void DecodeVertices(const PackedVertex* Src, DrawRawVertex* Dst, size_t Num, const VertexQuantization& Quantization)
+{
+	for (size_t i = 0; i < Num; i++)
+	{
+		DecodePositionColor(Src[i], Quantization, Dst[i]);
+	}
+	DecodeOctahedralArray(Src->normal, &Dst->normal, Num, sizeof(PackedVertex), sizeof(DrawRawVertex));
+}
+
+
+VertexError GetErrorBound(const VertexQuantization& Quantization)
+{
+	//Half a step on every axis, plus float rounding of the decode
+	Float3 HalfStep = Quantization.Scale * (0.5 / 65535.0);
+	Float3 Magnitude(fabsf(Quantization.Offset.x) + Quantization.Scale.x, fabsf(Quantization.Offset.y) + Quantization.Scale.y, fabsf(Quantization.Offset.z) + Quantization.Scale.z);
+
+	VertexError Bound;
+	Bound.Position = sqrtf(Dot(HalfStep, HalfStep)) + sqrtf(Dot(Magnitude, Magnitude)) * FLT_EPSILON * 2.0f;
+	Bound.NormalAngle = OCTAHEDRAL_ERROR_BOUND;
+	Bound.Color = 0.5f / 255.0f + FLT_EPSILON * 4.0f;
+	return Bound;
+}
+
+VertexError MeasureError(const DrawRawVertex* Src, const PackedVertex* Packed, size_t Num, const VertexQuantization& Quantization)
+{
+	VertexError Error;
+	for (size_t i = 0; i < Num; i++)
+	{
+		DrawRawVertex Decoded = DecodeVertex(Packed[i], Quantization);
+
+		Float3 Delta = Decoded.pos - Src[i].pos;
+		Error.Position = MAX(Error.Position, sqrtf(Dot(Delta, Delta)));
+
+		//Zero and non-finite normals have no direction to keep
+		//atan2 keeps small angles that acos would round to 0
+		float LengthSquared = Dot(Src[i].normal, Src[i].normal);
+		if (LengthSquared > 0.0f && LengthSquared <= FLT_MAX)
+		{
+			Float3 Sine = Cross(Src[i].normal, Decoded.normal);
+			float Angle = atan2f(sqrtf(Dot(Sine, Sine)), Dot(Src[i].normal, Decoded.normal));
+			Error.NormalAngle = MAX(Error.NormalAngle, Angle);
+		}
+
+		Error.Color = MAX(Error.Color, fabsf(Decoded.color.x - Saturate(Src[i].color.x)));
+		Error.Color = MAX(Error.Color, fabsf(Decoded.color.y - Saturate(Src[i].color.y)));
+		Error.Color = MAX(Error.Color, fabsf(Decoded.color.z - Saturate(Src[i].color.z)));
+		Error.Color = MAX(Error.Color, fabsf(Decoded.alpha - Saturate(Src[i].alpha)));
+	}
+	return Error;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Utils.h"
+#include "Processer.h"
+
+
+/*
+* Compact vertex for upload and storage, 16 bytes instead of the 40 of DrawRawVertex
+* position : R16G16B16A16_UNORM, relative to the mesh BoundingBox, w unused
+* normal   : R16G16_SNORM, octahedral
+* color    : R8G8B8A8_UNORM
+*/
+struct PackedVertex
+{
+	PackedVertex() :
+		pos{ 0, 0, 0, 0 }, normal{ 0, 0 }, color{ 0, 0, 0, 0 }
+	{}
+
+	std::uint16_t pos[4];
+	std::int16_t normal[2];
+	std::uint8_t color[4];
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+
+/*
+* Position = Offset + Unorm * Scale
+* Laid out as the 8 root constants the shader reads
+*/
+struct VertexQuantization
+{
+	VertexQuantization() :
+		Offset(0.0f), Pad0(0.0f), Scale(1.0f), Pad1(0.0f)
+	{}
+	VertexQuantization(const BoundingBox& Box);
+
+	Float3 Offset;
+	float Pad0;
+	Float3 Scale;
+	float Pad1;
+};
+
+
+/*
+* Position : world units, distance to the source position
+* NormalAngle : radians
+* Color : per channel, 0~1
+*/
+struct VertexError
+{
+	VertexError() :
+		Position(0.0f), NormalAngle(0.0f), Color(0.0f)
+	{}
+
+	float Position;
+	float NormalAngle;
+	float Color;
+};
+
+
+/*
+* Precision : 0.00007 radians
+*/
+void EncodeOctahedral(const Float3& Normal, std::int16_t* Out);
+Float3 DecodeOctahedral(const std::int16_t* In);
+
+PackedVertex EncodeVertex(const DrawRawVertex& Vertex, const VertexQuantization& Quantization);
+DrawRawVertex DecodeVertex(const PackedVertex& Vertex, const VertexQuantization& Quantization);
+
+void EncodeVertices(const DrawRawVertex* Src, PackedVertex* Dst, size_t Num, const VertexQuantization& Quantization);
+void DecodeVertices(const PackedVertex* Src, DrawRawVertex* Dst, size_t Num, const VertexQuantization& Quantization);
+
+//Worst case of the format for this quantization, any input inside the box stays within it
+VertexError GetErrorBound(const VertexQuantization& Quantization);
+//Largest error actually seen on a batch
+VertexError MeasureError(const DrawRawVertex* Src, const PackedVertex* Packed, size_t Num, const VertexQuantization& Quantization);
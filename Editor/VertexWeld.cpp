@@ -0,0 +1,246 @@
+#include "VertexWeld.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+
+using namespace std;
+
+static PlatformCriticalSection PrintLock;
+
+
+static inline std::int64_t Snap64(float Value, float InvTolerance)
+{
+	return (std::int64_t)floor((double)Value * InvTolerance + 0.5);
+}
+
+static inline std::int32_t Snap32(float Value, float InvTolerance)
+{
+	return (std::int32_t)floorf(Value * InvTolerance + 0.5f);
+}
+
+
+
+VertexWelder::VertexWelder(SourceContext* InContext, const WeldOptions& InOptions) :
+	Context(InContext),
+	Options(InOptions),
+	VertexNum(0),
+	TableMask(0),
+	RemainingChunks(0)
+{
+	Options.ChunkSize = MAX(Options.ChunkSize, 1);
+	if (Context == nullptr || Context->DrawVertexList == nullptr || Context->DrawIndexList == nullptr)
+		return;
+
+	VertexNum = MAX(Context->GetVertexNum(), 0);
+
+	//Load factor at most one half
+	size_t TableSize = 16;
+	while (TableSize < (size_t)VertexNum * 2)
+	{
+		TableSize <<= 1;
+	}
+	TableMask = TableSize - 1;
+	Table.reset(new std::atomic<int>[TableSize]);
+	for (size_t i = 0; i < TableSize; i++)
+	{
+		Table[i].store(-1, std::memory_order_relaxed);
+	}
+
+	Keys.resize(VertexNum);
+	Hashes.resize(VertexNum);
+	Slots.resize(VertexNum);
+	RemainingChunks.store(GetChunkNum());
+}
+
+
+WeldKey VertexWelder::MakeKey(const DrawRawVertex& Vertex) const
+{
+	WeldKey Key;
+	memset(&Key, 0, sizeof(WeldKey));
+
+	float InvPosition = 1.0f / MAX(Options.PositionTolerance, 1e-30f);
+	Key.Position[0] = Snap64(Vertex.pos.x, InvPosition);
+	Key.Position[1] = Snap64(Vertex.pos.y, InvPosition);
+	Key.Position[2] = Snap64(Vertex.pos.z, InvPosition);
+
+	if (Options.WeldNormal)
+	{
+		float InvNormal = 1.0f / MAX(Options.NormalTolerance, 1e-6f);
+		Key.Attribute[0] = Snap32(Vertex.normal.x, InvNormal);
+		Key.Attribute[1] = Snap32(Vertex.normal.y, InvNormal);
+		Key.Attribute[2] = Snap32(Vertex.normal.z, InvNormal);
+	}
+	if (Options.WeldColor)
+	{
+		float InvColor = 1.0f / MAX(Options.ColorTolerance, 1e-6f);
+		Key.Attribute[3] = Snap32(Vertex.color.x, InvColor);
+		Key.Attribute[4] = Snap32(Vertex.color.y, InvColor);
+		Key.Attribute[5] = Snap32(Vertex.color.z, InvColor);
+		Key.Attribute[6] = Snap32(Vertex.alpha, InvColor);
+	}
+
+	return Key;
+}
+
+
+void VertexWelder::InsertRange(int Begin, int End)
+{
+	End = MIN(End, VertexNum);
+	for (int i = Begin; i < End; i++)
+	{
+		Keys[i] = MakeKey(Context->DrawVertexList[i]);
+		Hashes[i] = HashFinalize(HashBytes(&Keys[i], sizeof(WeldKey)));
+
+		//Keys and Hashes of a vertex are published by the exchange that puts it in a slot
+		size_t Slot = Hashes[i] & TableMask;
+		while (true)
+		{
+			int Current = Table[Slot].load(std::memory_order_acquire);
+			if (Current < 0)
+			{
+				if (Table[Slot].compare_exchange_strong(Current, i, std::memory_order_acq_rel))
+					break;
+				//Lost the race, look at the winner
+			}
+
+			if (Current >= 0 && Hashes[Current] == Hashes[i] && Keys[Current] == Keys[i])
+			{
+				//Only vertices of this cell ever replace the one in the slot, keep the lowest
+				while (i < Current && !Table[Slot].compare_exchange_weak(Current, i, std::memory_order_acq_rel))
+				{
+				}
+				break;
+			}
+
+			if (Current >= 0)
+				Slot = (Slot + 1) & TableMask;
+		}
+		Slots[i] = Slot;
+	}
+}
+
+
+int VertexWelder::Finish()
+{
+	if (VertexNum == 0)
+		return 0;
+
+	std::vector<DrawRawIndex> Canonical(VertexNum);
+	for (int i = 0; i < VertexNum; i++)
+	{
+		Canonical[i] = (DrawRawIndex)Table[Slots[i]].load(std::memory_order_acquire);
+	}
+
+	size_t IndexNum = (size_t)Context->GetTriangleNum() * 3;
+	for (size_t i = 0; i < IndexNum; i++)
+	{
+		Context->DrawIndexList[i] = Canonical[Context->DrawIndexList[i]];
+	}
+
+	//Merged vertices are no longer referenced and end up behind the kept ones
+	int WeldedNum = OptimizeVertexFetch(Context->DrawVertexList, Context->DrawIndexList, IndexNum, VertexNum);
+	if (!Context->SetVertexNum(WeldedNum))
+	{
+		LockGuard<PlatformCriticalSection> Lock(PrintLock);
+		std::cout << "Weld : " << Context->Name << " can't shrink, " << VertexNum - WeldedNum << " unused vertices left at the end" << std::endl;
+	}
+
+	Keys.clear();
+	Keys.shrink_to_fit();
+	Hashes.clear();
+	Hashes.shrink_to_fit();
+	Slots.clear();
+	Slots.shrink_to_fit();
+	Table.reset();
+
+	return WeldedNum;
+}
+
+
+int WeldVertices(SourceContext* Context, const WeldOptions& Options)
+{
+	VertexWelder Welder(Context, Options);
+	Welder.InsertRange(0, Welder.GetSourceVertexNum());
+	return Welder.Finish();
+}
+
+
+//Bump the tag whenever the result of the pass changes, ChunkSize doesn't change it
+static size_t GetWeldParamHash(const WeldOptions& Options)
+{
+	size_t Hash = HashBytes("Weld1", 5);
+	Hash = HashBytes(&Options.PositionTolerance, sizeof(float), Hash);
+	Hash = HashBytes(&Options.NormalTolerance, sizeof(float), Hash);
+	Hash = HashBytes(&Options.ColorTolerance, sizeof(float), Hash);
+	Hash = HashCombine2(Hash, (Options.WeldNormal ? 1 : 0) + (Options.WeldColor ? 2 : 0));
+	return HashFinalize(Hash);
+}
+
+
+PassType MakeWeldPass(const WeldOptions& Options)
+{
+	return [Options](Processer* InProcesser, std::string& State) -> bool
+	{
+		State = "Welding Vertices";
+
+		std::vector<SourceContext*> Contexts;
+		std::vector<ResultKey> ContextKeys;
+		InProcesser->FindUncachedContexts(GetWeldParamHash(Options), [](SourceContext* Context, const std::vector<Byte>& Data)
+			{
+				if (!ReadGeometry(Context, Data))
+					return false;
+				LockGuard<PlatformCriticalSection> Lock(PrintLock);
+				std::cout << "Weld : " << Context->Name << " cached" << std::endl;
+				return true;
+			}, Contexts, ContextKeys);
+
+		std::shared_ptr<std::vector<std::unique_ptr<VertexWelder>>> Welders = std::make_shared<std::vector<std::unique_ptr<VertexWelder>>>();
+		//Result cache key of every welder
+		std::vector<ResultKey> Keys;
+		//First chunk of every welder, plus the total at the end
+		std::vector<int> ChunkOffset(1, 0);
+
+		for (int i = 0; i < Contexts.size(); i++)
+		{
+			std::unique_ptr<VertexWelder> Welder(new VertexWelder(Contexts[i], Options));
+			if (Welder->GetChunkNum() == 0)
+				continue;
+
+			ChunkOffset.push_back(ChunkOffset.back() + Welder->GetChunkNum());
+			Welders->push_back(std::move(Welder));
+			Keys.push_back(ContextKeys[i]);
+		}
+
+		int ChunkSize = MAX(Options.ChunkSize, 1);
+		return InProcesser->KickRange(ChunkOffset.back(), [InProcesser, Welders, Keys, ChunkOffset, ChunkSize](int Begin, int End)
+			{
+				for (int Chunk = Begin; Chunk < End; Chunk++)
+				{
+					int Index = (int)(std::upper_bound(ChunkOffset.begin(), ChunkOffset.end(), Chunk) - ChunkOffset.begin()) - 1;
+					VertexWelder* Welder = (*Welders)[Index].get();
+
+					int First = (Chunk - ChunkOffset[Index]) * ChunkSize;
+					Welder->InsertRange(First, First + ChunkSize);
+					if (!Welder->FinishChunk())
+						continue;
+
+					int WeldedNum = Welder->Finish();
+
+					SourceContext* Context = Welder->GetContext();
+					if (Keys[Index].IsValid())
+					{
+						std::vector<Byte> Data;
+						WriteGeometry(Context, Data);
+						InProcesser->StorePassResult(Keys[Index], Data);
+					}
+
+					char Line[512];
+					snprintf(Line, sizeof(Line), "Weld : %s %d -> %d vertices", Welder->GetContext()->Name.c_str(), Welder->GetSourceVertexNum(), WeldedNum);
+					LockGuard<PlatformCriticalSection> Lock(PrintLock);
+					std::cout << Line << std::endl;
+				}
+			}, 1);
+	};
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <memory>
+
+#include "Utils.h"
+#include "Processer.h"
+
+
+/*
+* Vertices weld when position, normal and color snap to the same cell.
+* Cells are Tolerance wide, two vertices closer than Tolerance can still fall
+* into neighbouring cells, so keep the tolerances well above the noise to merge.
+*/
+struct WeldOptions
+{
+	WeldOptions() :
+		PositionTolerance(1e-5f),
+		NormalTolerance(1e-3f),
+		ColorTolerance(1.0f / 255.0f),
+		WeldNormal(true),
+		WeldColor(true),
+		ChunkSize(65536)
+	{}
+
+	float PositionTolerance;
+	float NormalTolerance;
+	float ColorTolerance;
+	//Ignore normals/colors and keep the first vertex of a cell
+	bool WeldNormal;
+	bool WeldColor;
+	//Vertices per work item
+	int ChunkSize;
+};
+
+
+//Snapped vertex, no padding so it can be hashed and compared as bytes
+struct WeldKey
+{
+	std::int64_t Position[3];
+	//Normal xyz, color rgba, 0
+	std::int32_t Attribute[8];
+
+	bool operator==(const WeldKey& Other) const
+	{
+		return memcmp(this, &Other, sizeof(WeldKey)) == 0;
+	}
+};
+static_assert(sizeof(WeldKey) == 56, "WeldKey must not have padding");
+
+
+/*
+* Welding of one context, split in two steps so InsertRange can run on many threads:
+* InsertRange() snaps vertices into a lock-free open addressing table, the lowest index of a cell wins.
+* Finish() rewrites DrawIndexList, packs the surviving vertices to the front of DrawVertexList
+* in first-use order and calls SourceContext::SetVertexNum().
+*/
+class VertexWelder
+{
+public:
+	VertexWelder(SourceContext* InContext, const WeldOptions& InOptions);
+
+	/****Call in Any Thread****/
+	void InsertRange(int Begin, int End);
+
+	/****Call once every InsertRange is done****/
+	//Return the vertex number after welding
+	int Finish();
+
+	int GetChunkNum() const
+	{
+		return (VertexNum + Options.ChunkSize - 1) / Options.ChunkSize;
+	}
+	//True for the caller that finished the last chunk
+	bool FinishChunk()
+	{
+		return RemainingChunks.fetch_sub(1) == 1;
+	}
+
+	SourceContext* GetContext()
+	{
+		return Context;
+	}
+	int GetSourceVertexNum() const
+	{
+		return VertexNum;
+	}
+
+private:
+	WeldKey MakeKey(const DrawRawVertex& Vertex) const;
+
+private:
+	SourceContext* Context;
+	WeldOptions Options;
+	int VertexNum;
+
+	std::vector<WeldKey> Keys;
+	std::vector<size_t> Hashes;
+	std::unique_ptr<std::atomic<int>[]> Table;
+	size_t TableMask;
+	//Table slot every vertex ended in
+	std::vector<size_t> Slots;
+	std::atomic<int> RemainingChunks;
+};
+
+
+//Synchronous welding of one context, return the vertex number after welding
+int WeldVertices(SourceContext* Context, const WeldOptions& Options = WeldOptions());
+
+/*
+* Pass that welds every dirty context, chunks of all contexts go through the lane together,
+* the thread finishing the last chunk of a context rewrites it.
+*/
+PassType MakeWeldPass(const WeldOptions& Options = WeldOptions());
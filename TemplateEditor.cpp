@@ -3,15 +3,28 @@
 
 #include <iostream>
 
-#include "Editor\Processer.h"
-#include "Editor\Editor.h"
+#include "Editor/Processer.h"
+#include "Editor/BatchRunner.h"
+#if defined(_WIN32)
+#include "Editor/Editor.h"
 
 static Editor* gEditor = nullptr;
+#endif
 static Processer* gProcesser = nullptr;
 
-int main()
+int main(int argc, char** argv)
 {
     gProcesser = new Processer();
+
+    // Headless: TemplateEditor -batch [-o Dir] [-ext .Ext] InputFile...
+    if (BatchRunner::IsBatchCommandLine(argc, argv))
+    {
+        int ExitCode = BatchRunner::Main(gProcesser, argc, argv);
+        delete gProcesser;
+        return ExitCode;
+    }
+
+#if defined(_WIN32)
     gEditor = new Editor(gProcesser);
     
     if (gEditor->Init(L"Template Editor", 100, 100, 1690, 960))
@@ -25,6 +38,9 @@ int main()
 
     gEditor->Close();
     delete gEditor;
+#else
+    BatchRunner::PrintUsage();
+#endif
 
     delete gProcesser;
 }